@@ -42,6 +42,7 @@ check_include_file("portaudio.h"         HAVE_PORTAUDIO_H)
 check_include_file("pwd.h"               HAVE_PWD_H)
 check_include_file("stdint.h"            HAVE_STDINT_H)
 check_include_file("sys/ioctl.h"         HAVE_SYS_IOCTL_H)
+check_include_file("sys/mman.h"          HAVE_SYS_MMAN_H)
 check_include_file("sys/param.h"         HAVE_SYS_PARAM_H)
 check_include_file("sys/socket.h"        HAVE_SYS_SOCKET_H)
 check_include_file("sys/sockio.h"        HAVE_SYS_SOCKIO_H)
@@ -81,6 +82,21 @@ if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
 		}"
 		HAVE_LINUX_IF_BONDING_H
 	)
+	#
+	# Check whether we can capture through a TPACKET_V3 ring.
+	#
+	check_c_source_compiles(
+		"#include <sys/socket.h>
+		#include <linux/if_packet.h>
+		int main(void)
+		{
+			struct tpacket_req3 req;
+			int version = TPACKET_V3;
+			(void)req;
+			return version;
+		}"
+		HAVE_LINUX_TPACKET_V3
+	)
 endif()
 
 #Functions
@@ -120,6 +136,7 @@ check_function_exists("inet_pton"        HAVE_INET_PTON)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("mkdtemp"          HAVE_MKDTEMP)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
+check_function_exists("mmap"             HAVE_MMAP)
 check_function_exists("popcount"         HAVE_POPCOUNT)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
@@ -171,6 +171,8 @@ static gchar file_md5[HASH_STR_SIZE];
 #define FILE_HASH_OPT ""
 #endif /* HAVE_LIBGCRYPT */
 
+#define CAPINFOS_BATCH_SIZE 256  /* records read per wtap_read_batch() call */
+
 /*
  * If we have at least two packets with time stamps, and they're not in
  * order - i.e., the later packet has a time stamp older than the earlier
@@ -1061,7 +1063,8 @@ process_cap_file(wtap *wth, const char *filename)
   int                   err;
   gchar                *err_info;
   gint64                size;
-  gint64                data_offset;
+  wtap_batch           *batch;
+  guint                 rec_idx;
 
   guint32               packet = 0;
   gint64                bytes  = 0;
@@ -1108,94 +1111,101 @@ process_cap_file(wtap *wth, const char *filename)
   idb_info = NULL;
 
   /* Tally up data that we need to parse through the file to find */
-  while (wtap_read(wth, &err, &err_info, &data_offset))  {
-    phdr = wtap_phdr(wth);
-    if (phdr->presence_flags & WTAP_HAS_TS) {
-      prev_time = cur_time;
-      cur_time = phdr->ts;
-      if (packet == 0) {
-        start_time = phdr->ts;
-        start_time_tsprec = phdr->pkt_tsprec;
-        stop_time  = phdr->ts;
-        stop_time_tsprec = phdr->pkt_tsprec;
-        prev_time  = phdr->ts;
-      }
-      if (nstime_cmp(&cur_time, &prev_time) < 0) {
-        order = NOT_IN_ORDER;
-      }
-      if (nstime_cmp(&cur_time, &start_time) < 0) {
-        start_time = cur_time;
-        start_time_tsprec = phdr->pkt_tsprec;
-      }
-      if (nstime_cmp(&cur_time, &stop_time) > 0) {
-        stop_time = cur_time;
-        stop_time_tsprec = phdr->pkt_tsprec;
-      }
-    } else {
-      have_times = FALSE; /* at least one packet has no time stamp */
-      if (order != NOT_IN_ORDER)
-        order = ORDER_UNKNOWN;
-    }
-
-    if (phdr->rec_type == REC_TYPE_PACKET) {
-      bytes+=phdr->len;
-      packet++;
-
-      /* If caplen < len for a rcd, then presumably           */
-      /* 'Limit packet capture length' was done for this rcd. */
-      /* Keep track as to the min/max actual snapshot lengths */
-      /*  seen for this file.                                 */
-      if (phdr->caplen < phdr->len) {
-        if (phdr->caplen < snaplen_min_inferred)
-          snaplen_min_inferred = phdr->caplen;
-        if (phdr->caplen > snaplen_max_inferred)
-          snaplen_max_inferred = phdr->caplen;
-      }
-
-      if ((phdr->pkt_encap > 0) && (phdr->pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[phdr->pkt_encap] += 1;
+  batch = wtap_batch_new(CAPINFOS_BATCH_SIZE);
+  while (wtap_read_batch(wth, batch, &err, &err_info) != 0) {
+    for (rec_idx = 0; rec_idx < batch->count; rec_idx++) {
+      phdr = &batch->recs[rec_idx].phdr;
+      if (phdr->presence_flags & WTAP_HAS_TS) {
+        prev_time = cur_time;
+        cur_time = phdr->ts;
+        if (packet == 0) {
+          start_time = phdr->ts;
+          start_time_tsprec = phdr->pkt_tsprec;
+          stop_time  = phdr->ts;
+          stop_time_tsprec = phdr->pkt_tsprec;
+          prev_time  = phdr->ts;
+        }
+        if (nstime_cmp(&cur_time, &prev_time) < 0) {
+          order = NOT_IN_ORDER;
+        }
+        if (nstime_cmp(&cur_time, &start_time) < 0) {
+          start_time = cur_time;
+          start_time_tsprec = phdr->pkt_tsprec;
+        }
+        if (nstime_cmp(&cur_time, &stop_time) > 0) {
+          stop_time = cur_time;
+          stop_time_tsprec = phdr->pkt_tsprec;
+        }
       } else {
-        fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                phdr->pkt_encap, packet, filename);
+        have_times = FALSE; /* at least one packet has no time stamp */
+        if (order != NOT_IN_ORDER)
+          order = ORDER_UNKNOWN;
       }
 
-      /* Packet interface_id info */
-      if (phdr->presence_flags & WTAP_HAS_INTERFACE_ID) {
-        /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (phdr->interface_id >= cf_info.num_interfaces) {
-          /*
-           * OK, re-fetch the number of interfaces, as there might have
-           * been an interface that was in the middle of packets, and
-           * grow the array to be big enough for the new number of
-           * interfaces.
-           */
-          idb_info = wtap_file_get_idb_info(wth);
-
-          cf_info.num_interfaces = idb_info->interface_data->len;
-          g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-
-          g_free(idb_info);
-          idb_info = NULL;
+      if (phdr->rec_type == REC_TYPE_PACKET) {
+        bytes+=phdr->len;
+        packet++;
+
+        /* If caplen < len for a rcd, then presumably           */
+        /* 'Limit packet capture length' was done for this rcd. */
+        /* Keep track as to the min/max actual snapshot lengths */
+        /*  seen for this file.                                 */
+        if (phdr->caplen < phdr->len) {
+          if (phdr->caplen < snaplen_min_inferred)
+            snaplen_min_inferred = phdr->caplen;
+          if (phdr->caplen > snaplen_max_inferred)
+            snaplen_max_inferred = phdr->caplen;
         }
-        if (phdr->interface_id < cf_info.num_interfaces) {
-          g_array_index(cf_info.interface_packet_counts, guint32, phdr->interface_id) += 1;
-        }
-        else {
-          cf_info.pkt_interface_id_unknown += 1;
+
+        if ((phdr->pkt_encap > 0) && (phdr->pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+          cf_info.encap_counts[phdr->pkt_encap] += 1;
+        } else {
+          fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
+                  phdr->pkt_encap, packet, filename);
         }
-      }
-      else {
-        /* it's for interface_id 0 */
-        if (cf_info.num_interfaces != 0) {
-          g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+
+        /* Packet interface_id info */
+        if (phdr->presence_flags & WTAP_HAS_INTERFACE_ID) {
+          /* cf_info.num_interfaces is size, not index, so it's one more than max index */
+          if (phdr->interface_id >= cf_info.num_interfaces) {
+            /*
+             * OK, re-fetch the number of interfaces, as there might have
+             * been an interface that was in the middle of packets, and
+             * grow the array to be big enough for the new number of
+             * interfaces.
+             */
+            idb_info = wtap_file_get_idb_info(wth);
+
+            cf_info.num_interfaces = idb_info->interface_data->len;
+            g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
+
+            g_free(idb_info);
+            idb_info = NULL;
+          }
+          if (phdr->interface_id < cf_info.num_interfaces) {
+            g_array_index(cf_info.interface_packet_counts, guint32, phdr->interface_id) += 1;
+          }
+          else {
+            cf_info.pkt_interface_id_unknown += 1;
+          }
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          /* it's for interface_id 0 */
+          if (cf_info.num_interfaces != 0) {
+            g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+          }
+          else {
+            cf_info.pkt_interface_id_unknown += 1;
+          }
         }
       }
-    }
 
+    } /* for */
+
+    if (err != 0)
+      break;
   } /* while */
+  wtap_batch_free(batch);
 
   /*
    * Get IDB info strings.
@@ -1702,6 +1712,8 @@ main(int argc, char *argv[])
     }
 #endif /* HAVE_LIBGCRYPT */
 
+    /* Decompress compressed files, in parallel if we can, while we count. */
+    wtap_set_readahead(TRUE);
     wth = wtap_open_offline(argv[opt], WTAP_TYPE_AUTO, &err, &err_info, FALSE);
 
     if (!wth) {
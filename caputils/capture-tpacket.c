@@ -0,0 +1,357 @@
+/* capture-tpacket.c
+ * Capturing through a Linux TPACKET_V3 memory-mapped ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_LINUX_TPACKET_V3)
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+#include <pcap.h>
+
+#include "caputils/capture-tpacket.h"
+
+/*
+ * Each block is handed to us when it's full, or when it has been
+ * partially filled for TPACKET_V3_BLOCK_TIMEOUT milliseconds.
+ */
+#define TPACKET_V3_BLOCK_SIZE       (1 << 20)
+#define TPACKET_V3_FRAME_SIZE       (TPACKET_ALIGNMENT << 7)
+#define TPACKET_V3_MIN_BLOCKS       2
+#define TPACKET_V3_BLOCK_TIMEOUT    50
+
+#define VLAN_TAG_LEN                4
+
+struct tpacket_v3_ring {
+    int                 fd;
+    guint8             *map;
+    size_t              map_len;
+    unsigned int        block_nr;
+    unsigned int        cur_block;
+    int                 snaplen;
+    guint8             *vlan_buf;   /* packet with the VLAN tag put back */
+    guint64             packets;    /* accumulated PACKET_STATISTICS */
+    guint64             drops;
+};
+
+/*
+ * Attach a filter that rejects all packets.  An AF_PACKET socket starts
+ * receiving packets as soon as it's created, and, once it's bound, gets
+ * every packet on the interface, so this keeps anything from getting into
+ * the ring before the capture filter is attached.
+ */
+static gboolean
+tpacket_v3_reject_all(tpacket_v3_ring *ring)
+{
+    struct sock_filter reject_all[] = { { BPF_RET | BPF_K, 0, 0, 0 } };
+    struct sock_fprog  prog;
+
+    prog.len = 1;
+    prog.filter = reject_all;
+    return setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog) != -1;
+}
+
+/*
+ * Hand all the blocks the kernel has filled back to it without looking
+ * at them.
+ */
+static void
+tpacket_v3_drain(tpacket_v3_ring *ring)
+{
+    struct tpacket_block_desc *block;
+
+    for (;;) {
+        block = (struct tpacket_block_desc *)(void *)(ring->map + (size_t)ring->cur_block * TPACKET_V3_BLOCK_SIZE);
+        if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+            break;
+        __sync_synchronize();
+        block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        ring->cur_block = (ring->cur_block + 1) % ring->block_nr;
+    }
+}
+
+static void
+tpacket_v3_free(tpacket_v3_ring *ring)
+{
+    if (ring->map != NULL && ring->map != MAP_FAILED)
+        munmap(ring->map, ring->map_len);
+    if (ring->fd != -1)
+        close(ring->fd);
+    g_free(ring->vlan_buf);
+    g_free(ring);
+}
+
+tpacket_v3_ring *
+tpacket_v3_open(const char *iface, int snaplen, int buffer_size,
+                gboolean promisc, char *errmsg, size_t errmsg_len)
+{
+    tpacket_v3_ring    *ring;
+    int                 version = TPACKET_V3;
+    struct tpacket_req3 req;
+    struct sockaddr_ll  sll;
+    struct packet_mreq  mreq;
+    unsigned int        ifindex;
+
+    ifindex = if_nametoindex(iface);
+    if (ifindex == 0) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't get the index of interface %s: %s", iface, g_strerror(errno));
+        return NULL;
+    }
+
+    ring = g_new0(tpacket_v3_ring, 1);
+    ring->map = NULL;
+    ring->snaplen = snaplen;
+    ring->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (ring->fd == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't open a packet socket: %s", g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    if (!tpacket_v3_reject_all(ring)) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't attach a filter to the packet socket: %s", g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't use TPACKET_V3 on %s: %s", iface, g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    ring->block_nr = (unsigned int)buffer_size * (1024 * 1024 / TPACKET_V3_BLOCK_SIZE);
+    if (ring->block_nr < TPACKET_V3_MIN_BLOCKS)
+        ring->block_nr = TPACKET_V3_MIN_BLOCKS;
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = TPACKET_V3_BLOCK_SIZE;
+    req.tp_block_nr = ring->block_nr;
+    req.tp_frame_size = TPACKET_V3_FRAME_SIZE;
+    req.tp_frame_nr = (TPACKET_V3_BLOCK_SIZE / TPACKET_V3_FRAME_SIZE) * ring->block_nr;
+    req.tp_retire_blk_tov = TPACKET_V3_BLOCK_TIMEOUT;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't set up a %u MB receive ring on %s: %s",
+                   ring->block_nr * (TPACKET_V3_BLOCK_SIZE / (1024 * 1024)), iface,
+                   g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    ring->map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+    ring->map = (guint8 *)mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't map the receive ring of %s: %s", iface, g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = (int)ifindex;
+    if (bind(ring->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't bind to interface %s: %s", iface, g_strerror(errno));
+        tpacket_v3_free(ring);
+        return NULL;
+    }
+
+    if (promisc) {
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = (int)ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof mreq) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't put interface %s into promiscuous mode: %s", iface,
+                       g_strerror(errno));
+            tpacket_v3_free(ring);
+            return NULL;
+        }
+    }
+
+    ring->vlan_buf = (guint8 *)g_malloc((gsize)snaplen + VLAN_TAG_LEN);
+    return ring;
+}
+
+gboolean
+tpacket_v3_setfilter(tpacket_v3_ring *ring, const struct bpf_program *fcode,
+                     char *errmsg, size_t errmsg_len)
+{
+    struct sock_fprog prog;
+
+    /*
+     * As libpcap does, swap in a filter that rejects everything first,
+     * and throw away whatever got into the ring under the old one, so
+     * that nothing captured before the new filter is in place reaches
+     * the capture file.
+     */
+    if (!tpacket_v3_reject_all(ring)) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't attach the capture filter: %s", g_strerror(errno));
+        return FALSE;
+    }
+    tpacket_v3_drain(ring);
+
+    /* struct bpf_insn and struct sock_filter have the same layout */
+    prog.len = (unsigned short)fcode->bf_len;
+    prog.filter = (struct sock_filter *)(void *)fcode->bf_insns;
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't attach the capture filter: %s", g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int
+tpacket_v3_dispatch(tpacket_v3_ring *ring, int timeout, gboolean ts_nsec,
+                    pcap_handler callback, u_char *user,
+                    char *errmsg, size_t errmsg_len)
+{
+    struct tpacket_block_desc *block;
+    struct tpacket3_hdr       *ppd;
+    struct pcap_pkthdr         phdr;
+    const guint8              *pd;
+    guint8                    *tag;
+    struct pollfd              pfd;
+    guint32                    i, num_pkts;
+
+    block = (struct tpacket_block_desc *)(void *)(ring->map + (size_t)ring->cur_block * TPACKET_V3_BLOCK_SIZE);
+    if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) == -1 && errno != EINTR) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Unexpected error from poll: %s", g_strerror(errno));
+            return -1;
+        }
+        if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+            return 0;
+    }
+
+    num_pkts = block->hdr.bh1.num_pkts;
+    ppd = (struct tpacket3_hdr *)(void *)((guint8 *)block + block->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < num_pkts; i++) {
+        phdr.ts.tv_sec = ppd->tp_sec;
+        phdr.ts.tv_usec = ts_nsec ? ppd->tp_nsec : ppd->tp_nsec / 1000;
+        phdr.len = ppd->tp_len;
+        phdr.caplen = MIN(ppd->tp_snaplen, (guint32)ring->snaplen);
+        pd = (const guint8 *)ppd + ppd->tp_mac;
+
+        if ((ppd->tp_status & TP_STATUS_VLAN_VALID) && phdr.caplen >= 2 * ETH_ALEN) {
+            /* The kernel stripped the VLAN tag; put it back, as libpcap does */
+            memcpy(ring->vlan_buf, pd, 2 * ETH_ALEN);
+            tag = ring->vlan_buf + 2 * ETH_ALEN;
+#ifdef TP_STATUS_VLAN_TPID_VALID
+            if (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID) {
+                tag[0] = ppd->hv1.tp_vlan_tpid >> 8;
+                tag[1] = ppd->hv1.tp_vlan_tpid & 0xff;
+            } else
+#endif
+            {
+                tag[0] = ETH_P_8021Q >> 8;
+                tag[1] = ETH_P_8021Q & 0xff;
+            }
+            tag[2] = ppd->hv1.tp_vlan_tci >> 8;
+            tag[3] = ppd->hv1.tp_vlan_tci & 0xff;
+            memcpy(tag + VLAN_TAG_LEN, pd + 2 * ETH_ALEN, phdr.caplen - 2 * ETH_ALEN);
+            phdr.len += VLAN_TAG_LEN;
+            phdr.caplen = MIN(phdr.caplen + VLAN_TAG_LEN, (guint32)ring->snaplen);
+            pd = ring->vlan_buf;
+        }
+
+        callback(user, &phdr, pd);
+        ppd = (struct tpacket3_hdr *)(void *)((guint8 *)ppd + ppd->tp_next_offset);
+    }
+
+    /* Make sure we're done with the block before the kernel gets it back */
+    __sync_synchronize();
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    ring->cur_block = (ring->cur_block + 1) % ring->block_nr;
+
+    return (int)num_pkts;
+}
+
+gboolean
+tpacket_v3_stats(tpacket_v3_ring *ring, struct pcap_stat *stats,
+                 char *errmsg, size_t errmsg_len)
+{
+    struct tpacket_stats_v3 st;
+    socklen_t               len = sizeof st;
+
+    /* The kernel resets its counters on every read */
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't get the statistics of the receive ring: %s", g_strerror(errno));
+        return FALSE;
+    }
+    ring->packets += st.tp_packets;
+    ring->drops += st.tp_drops;
+
+    stats->ps_recv = (u_int)ring->packets;
+    stats->ps_drop = (u_int)ring->drops;
+    stats->ps_ifdrop = 0;
+    return TRUE;
+}
+
+void
+tpacket_v3_close(tpacket_v3_ring *ring)
+{
+    tpacket_v3_free(ring);
+}
+
+#endif /* HAVE_LIBPCAP && HAVE_LINUX_TPACKET_V3 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
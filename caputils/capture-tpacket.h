@@ -0,0 +1,85 @@
+/* capture-tpacket.h
+ * Declarations for capturing through a Linux TPACKET_V3 memory-mapped ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CAPTURE_TPACKET_H__
+#define __CAPTURE_TPACKET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_LINUX_TPACKET_V3)
+
+#include <pcap.h>
+
+/*
+ * An AF_PACKET socket with a TPACKET_V3 receive ring mapped into our
+ * address space.  The kernel fills whole blocks of packets and hands them
+ * to us at once, so packets can be written out straight from the ring
+ * without a system call or a copy per packet.
+ *
+ * This only delivers Ethernet (DLT_EN10MB) frames.
+ */
+typedef struct tpacket_v3_ring tpacket_v3_ring;
+
+/*
+ * Open a TPACKET_V3 ring on the interface.  buffer_size is the size of
+ * the ring in megabytes.  No packets are captured until a filter is
+ * attached with tpacket_v3_setfilter().  Returns NULL and fills in errmsg
+ * on failure.
+ */
+tpacket_v3_ring *tpacket_v3_open(const char *iface, int snaplen,
+    int buffer_size, gboolean promisc, char *errmsg, size_t errmsg_len);
+
+/*
+ * Attach a compiled capture filter to the ring's socket, throwing away
+ * the packets captured with the filter it replaces.
+ */
+gboolean tpacket_v3_setfilter(tpacket_v3_ring *ring,
+    const struct bpf_program *fcode, char *errmsg, size_t errmsg_len);
+
+/*
+ * Wait at most timeout milliseconds for the kernel to hand over a block
+ * and call the callback for each packet in it.  Time stamps are given
+ * in nanoseconds in the tv_usec field if ts_nsec is TRUE.  Returns the
+ * number of packets processed, or -1 and fills in errmsg on error.
+ */
+int tpacket_v3_dispatch(tpacket_v3_ring *ring, int timeout,
+    gboolean ts_nsec, pcap_handler callback, u_char *user,
+    char *errmsg, size_t errmsg_len);
+
+/*
+ * Get the packet counts since the ring was opened, in the same way
+ * pcap_stats() does.
+ */
+gboolean tpacket_v3_stats(tpacket_v3_ring *ring, struct pcap_stat *stats,
+    char *errmsg, size_t errmsg_len);
+
+void tpacket_v3_close(tpacket_v3_ring *ring);
+
+#endif /* HAVE_LIBPCAP && HAVE_LINUX_TPACKET_V3 */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_TPACKET_H__ */
@@ -0,0 +1,35 @@
+# Find the Zstandard compression library
+#
+#  ZSTD_INCLUDE_DIRS - where to find zstd.h
+#  ZSTD_LIBRARIES    - List of libraries when using Zstandard
+#  ZSTD_FOUND        - True if Zstandard found
+
+include( FindWSWinLibs )
+FindWSWinLibs( "zstd" "ZSTD_HINTS" )
+
+find_path( ZSTD_INCLUDE_DIR
+  NAMES
+  zstd.h
+  HINTS
+    "${ZSTD_HINTS}/include"
+)
+
+find_library( ZSTD_LIBRARY
+  NAMES
+    zstd
+  HINTS
+    "${ZSTD_HINTS}/lib"
+)
+
+include( FindPackageHandleStandardArgs )
+find_package_handle_standard_args( ZSTD DEFAULT_MSG ZSTD_INCLUDE_DIR ZSTD_LIBRARY )
+
+if( ZSTD_FOUND )
+  set( ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR} )
+  set( ZSTD_LIBRARIES ${ZSTD_LIBRARY} )
+else()
+  set( ZSTD_INCLUDE_DIRS )
+  set( ZSTD_LIBRARIES )
+endif()
+
+mark_as_advanced( ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS )
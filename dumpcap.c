@@ -55,6 +55,7 @@
 #include <errno.h>
 
 #include <wsutil/cmdarg_err.h>
+#include <wsutil/pint.h>
 #include <wsutil/crash_info.h>
 #include <ws_version_info.h>
 
@@ -76,6 +77,7 @@
 #include "caputils/capture_ifinfo.h"
 #include "caputils/capture-pcap-util.h"
 #include "caputils/capture-pcap-util-int.h"
+#include "caputils/capture-tpacket.h"
 #ifdef _WIN32
 #include "caputils/capture-wpcap.h"
 #endif /* _WIN32 */
@@ -138,9 +140,14 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
+/*
+ * Packets captured by the per-interface reader threads are handed to the
+ * writer thread through one pcap_ring per interface.  pcap_queue_bytes
+ * and pcap_queue_packets count what is queued over all rings; they are
+ * only accessed with the g_atomic_int_* functions.
+ */
+static gint pcap_queue_bytes;
+static gint pcap_queue_packets;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
@@ -303,6 +310,10 @@ typedef struct _pcap_options {
 #if defined(_WIN32)
     GMutex                      *cap_pipe_read_mtx;
     GAsyncQueue                 *cap_pipe_pending_q, *cap_pipe_done_q;
+#endif
+    struct _pcap_ring           *ring;                   /**< Packets queued for the writer thread */
+#ifdef HAVE_LINUX_TPACKET_V3
+    tpacket_v3_ring             *tpacket;                /**< TPACKET_V3 ring we capture from instead of pcap_h */
 #endif
 } pcap_options;
 
@@ -324,11 +335,47 @@ typedef struct _loop_data {
     guint32   autostop_files;
 } loop_data;
 
-typedef struct _pcap_queue_element {
+/*
+ * Single-producer/single-consumer ring of captured packets.
+ *
+ * The producing thread (the reader thread of an interface, or the writer
+ * thread handing packets to a flow shard) is the only one advancing head
+ * and the consuming thread is the only one advancing tail, so no lock is
+ * needed; both are free-running byte counters, taken modulo size (a power
+ * of two) to get an offset into buf.  Each packet is stored as a pcap_ring_record
+ * followed by the packet data, padded to PCAP_RING_ALIGN bytes.  A record
+ * that doesn't fit before the end of buf is preceded by a record with a
+ * length of 0, which tells the writer to continue at the start of buf.
+ */
+typedef struct _pcap_ring {
+    guint8             *buf;
+    guint32             size;
+    gint                head;   /**< Bytes produced, updated by the producer */
+    gint                tail;   /**< Bytes consumed, updated by the consumer */
+} pcap_ring;
+
+typedef struct _pcap_ring_record {
+    guint32             len;    /**< Length of the record including padding, 0 if wrapped */
     pcap_options       *pcap_opts;
     struct pcap_pkthdr  phdr;
-    u_char             *pd;
-} pcap_queue_element;
+} pcap_ring_record;
+
+/*
+ * Lets the consumer of one or more rings sleep while they're empty.
+ * Producers only take the mutex if the consumer is waiting.
+ */
+typedef struct _pcap_ring_waiter {
+    GMutex             *mtx;
+    GCond              *cond;
+    gint                waiting;
+} pcap_ring_waiter;
+
+typedef void (*pcap_ring_write_func)(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                                     const u_char *pd, void *user_data);
+
+#define PCAP_RING_ALIGN         8
+#define PCAP_RING_RECORD_LEN(caplen) \
+    ((guint32)((sizeof(pcap_ring_record) + (caplen) + PCAP_RING_ALIGN - 1) & ~(PCAP_RING_ALIGN - 1)))
 
 /*
  * Standard secondary message for unexpected errors.
@@ -379,6 +426,36 @@ static gboolean need_timeout_workaround;
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
 
+/* Used to wake up the writer thread when it has nothing to write. */
+static pcap_ring_waiter pcap_ring_writer;
+
+/*
+ * With --flow-shards, every packet is written to one of several output
+ * files, chosen by a hash of its addresses and ports that's the same in
+ * both directions, so that each file holds complete conversations.
+ * Each shard file is written by its own thread, which gets the packets
+ * from the writer thread through a pcap_ring.
+ */
+#define MAX_FLOW_SHARDS         64
+#define SHARD_FULL_WAIT         1000 /* usecs */
+
+typedef struct _capture_shard {
+    guint               num;
+    gchar              *filename;
+    FILE               *pdh;
+    guint64             bytes_written;
+    gint                err;        /**< write error; set by the shard thread */
+    gint                stop;       /**< TRUE when no more packets will be put */
+    pcap_ring          *ring;
+    pcap_ring_waiter    waiter;
+    GThread            *tid;
+} capture_shard;
+
+static guint          num_shards = 0;
+static capture_shard *shards = NULL;
+
+static void capture_loop_free_shards(gboolean unlink_files);
+
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
                     const char *message, gpointer user_data _U_);
@@ -387,6 +464,13 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+#ifdef HAVE_LINUX_TPACKET_V3
+static gboolean use_tpacket_v3 = FALSE;
+
+/* dumpcap-only long option; see the comments in capture_opts.h */
+#define LONGOPT_TPACKET_V3 (LONGOPT_DISABLE_HEURISTIC + 1)
+#endif
+#define LONGOPT_FLOW_SHARDS (LONGOPT_DISABLE_HEURISTIC + 2)
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
@@ -516,12 +600,18 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --flow-shards <count>    split the packets over <count> output files by\n");
+    fprintf(output, "                           conversation, each written by its own thread\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+#ifdef HAVE_LINUX_TPACKET_V3
+    fprintf(output, "  --tpacket-v3             capture from Ethernet interfaces through a\n");
+    fprintf(output, "                           memory-mapped TPACKET_V3 ring\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v                       print version information and exit\n");
     fprintf(output, "  -h                       display this help and exit\n");
@@ -2044,6 +2134,74 @@ cap_pipe_dispatch(loop_data *ld, pcap_options *pcap_opts, guchar *data, char *er
 }
 
 
+#ifdef HAVE_LINUX_TPACKET_V3
+/*
+ * Capture from an Ethernet interface through a TPACKET_V3 ring rather
+ * than through libpcap.  Creating the AF_PACKET socket needs the same
+ * privileges as opening the interface with libpcap, so this has to be
+ * done before capture_loop_open_input() gives them up.
+ */
+static gboolean
+capture_loop_open_tpacket(pcap_options *pcap_opts, interface_options *interface_opts,
+                          char *errmsg, size_t errmsg_len)
+{
+    int                buffer_size = DEFAULT_CAPTURE_BUFFER_SIZE;
+
+#ifdef CAN_SET_CAPTURE_BUFFER_SIZE
+    buffer_size = interface_opts->buffer_size;
+#endif
+    pcap_opts->tpacket = tpacket_v3_open(interface_opts->name,
+                                         pcap_snapshot(pcap_opts->pcap_h),
+                                         buffer_size, interface_opts->promisc_mode,
+                                         errmsg, errmsg_len);
+    if (pcap_opts->tpacket == NULL) {
+        return FALSE;
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Capturing on %s through a TPACKET_V3 ring.", interface_opts->name);
+    return TRUE;
+}
+
+/*
+ * Put the capture filter on the TPACKET_V3 ring.  The pcap_t stays open,
+ * as it's what we use to compile the capture filter, but gets a filter
+ * that rejects all packets so that the kernel doesn't copy every packet
+ * to it as well.
+ */
+static gboolean
+capture_loop_init_tpacket_filter(pcap_options *pcap_opts, interface_options *interface_opts,
+                                 char *errmsg, size_t errmsg_len)
+{
+    struct bpf_program fcode;
+    struct bpf_insn    reject_all[] = { BPF_STMT(BPF_RET|BPF_K, 0) };
+
+    /* capture_loop_init_filter() has already checked that this compiles */
+    if (!compile_capture_filter(interface_opts->name, pcap_opts->pcap_h, &fcode,
+                                interface_opts->cfilter?interface_opts->cfilter:"")) {
+        g_snprintf(errmsg, (gulong)errmsg_len, "%s", pcap_geterr(pcap_opts->pcap_h));
+        return FALSE;
+    }
+    if (!tpacket_v3_setfilter(pcap_opts->tpacket, &fcode, errmsg, errmsg_len)) {
+#ifdef HAVE_PCAP_FREECODE
+        pcap_freecode(&fcode);
+#endif
+        return FALSE;
+    }
+#ifdef HAVE_PCAP_FREECODE
+    pcap_freecode(&fcode);
+#endif
+
+    fcode.bf_len = 1;
+    fcode.bf_insns = reject_all;
+    if (pcap_setfilter(pcap_opts->pcap_h, &fcode) < 0) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Can't stop libpcap from capturing on %s: %s",
+              interface_opts->name, pcap_geterr(pcap_opts->pcap_h));
+    }
+    return TRUE;
+}
+#endif
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2163,6 +2321,10 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
 #endif
         pcap_opts->cap_pipe_pending_q = g_async_queue_new();
         pcap_opts->cap_pipe_done_q = g_async_queue_new();
+#endif
+        pcap_opts->ring = NULL;
+#ifdef HAVE_LINUX_TPACKET_V3
+        pcap_opts->tpacket = NULL;
 #endif
         g_array_append_val(ld->pcaps, pcap_opts);
 
@@ -2217,6 +2379,21 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
                 return FALSE;
             }
             pcap_opts->linktype = get_pcap_datalink(pcap_opts->pcap_h, interface_opts.name);
+
+#ifdef HAVE_LINUX_TPACKET_V3
+            if (use_tpacket_v3) {
+                if (pcap_opts->linktype != DLT_EN10MB) {
+                    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+                          "%s isn't an Ethernet interface; capturing through libpcap.",
+                          interface_opts.name);
+                } else if (!capture_loop_open_tpacket(pcap_opts, &interface_opts,
+                                                      errmsg, errmsg_len)) {
+                    g_snprintf(secondary_errmsg, (gulong) secondary_errmsg_len,
+                               "Try capturing without --tpacket-v3.");
+                    return FALSE;
+                }
+            }
+#endif
         } else {
             /* We couldn't open "iface" as a network device. */
             /* Try to open it as a pipe */
@@ -2309,6 +2486,12 @@ static void capture_loop_close_input(loop_data *ld)
             CloseHandle(pcap_opts->cap_pipe_h);
             pcap_opts->cap_pipe_h = INVALID_HANDLE_VALUE;
         }
+#endif
+#ifdef HAVE_LINUX_TPACKET_V3
+        if (pcap_opts->tpacket != NULL) {
+            tpacket_v3_close(pcap_opts->tpacket);
+            pcap_opts->tpacket = NULL;
+        }
 #endif
         /* if open, close the pcap "input file" */
         if (pcap_opts->pcap_h != NULL) {
@@ -2359,17 +2542,96 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
     return INITFILTER_NO_ERROR;
 }
 
+/* Get the capture statistics of an interface, from pcap or the TPACKET_V3 ring */
+static gboolean
+capture_loop_get_stats(pcap_options *pcap_opts, struct pcap_stat *stats,
+                       char *errmsg, size_t errmsg_len)
+{
+#ifdef HAVE_LINUX_TPACKET_V3
+    if (pcap_opts->tpacket != NULL) {
+        return tpacket_v3_stats(pcap_opts->tpacket, stats, errmsg, errmsg_len);
+    }
+#endif
+    if (pcap_stats(pcap_opts->pcap_h, stats) < 0) {
+        g_snprintf(errmsg, (gulong)errmsg_len, "%s", pcap_geterr(pcap_opts->pcap_h));
+        return FALSE;
+    }
+    return TRUE;
+}
 
-/* set up to write to the already-opened capture output file/files */
+
+/* write the file header (and the interface descriptions) to an output file */
 static gboolean
-capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
+capture_loop_write_file_header(capture_options *capture_opts, loop_data *ld, FILE *pdh,
+                               guint64 *bytes_written, int *err)
 {
-    int                err;
     guint              i;
     pcap_options      *pcap_opts;
     interface_options  interface_opts;
     gboolean           successful;
 
+    if (capture_opts->use_pcapng) {
+        char    *appname;
+        GString *os_info_str;
+
+        os_info_str = g_string_new("");
+        get_os_version_info(os_info_str);
+
+        appname = g_strdup_printf("Dumpcap (Wireshark) %s", get_ws_vcs_version_info());
+        successful = pcapng_write_session_header_block(pdh,
+                            (const char *)capture_opts->capture_comment,   /* Comment*/
+                            NULL,                        /* HW*/
+                            os_info_str->str,            /* OS*/
+                            appname,
+                            -1,                          /* section_length */
+                            bytes_written,
+                            err);
+        g_free(appname);
+
+        for (i = 0; successful && (i < capture_opts->ifaces->len); i++) {
+            interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
+            pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+            if (pcap_opts->from_cap_pipe) {
+                pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
+            } else {
+                pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
+            }
+            successful = pcapng_write_interface_description_block(pdh,
+                                                                  NULL,                       /* OPT_COMMENT       1 */
+                                                                  interface_opts.name,        /* IDB_NAME          2 */
+                                                                  interface_opts.descr,       /* IDB_DESCRIPTION   3 */
+                                                                  interface_opts.cfilter,     /* IDB_FILTER       11 */
+                                                                  os_info_str->str,           /* IDB_OS           12 */
+                                                                  pcap_opts->linktype,
+                                                                  pcap_opts->snaplen,
+                                                                  bytes_written,
+                                                                  0,                          /* IDB_IF_SPEED      8 */
+                                                                  pcap_opts->ts_nsec ? 9 : 6, /* IDB_TSRESOL       9 */
+                                                                  err);
+        }
+
+        g_string_free(os_info_str, TRUE);
+
+    } else {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, 0);
+        if (pcap_opts->from_cap_pipe) {
+            pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
+        } else {
+            pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
+        }
+        successful = libpcap_write_file_header(pdh, pcap_opts->linktype, pcap_opts->snaplen,
+                                               pcap_opts->ts_nsec, bytes_written, err);
+    }
+    return successful;
+}
+
+/* set up to write to the already-opened capture output file/files */
+static gboolean
+capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
+{
+    int                err;
+    gboolean           successful;
+
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_output");
 
     if ((capture_opts->use_pcapng == FALSE) &&
@@ -2389,58 +2651,8 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         }
     }
     if (ld->pdh) {
-        if (capture_opts->use_pcapng) {
-            char    *appname;
-            GString *os_info_str;
-
-            os_info_str = g_string_new("");
-            get_os_version_info(os_info_str);
-
-            appname = g_strdup_printf("Dumpcap (Wireshark) %s", get_ws_vcs_version_info());
-            successful = pcapng_write_session_header_block(ld->pdh,
-                                (const char *)capture_opts->capture_comment,   /* Comment*/
-                                NULL,                        /* HW*/
-                                os_info_str->str,            /* OS*/
-                                appname,
-                                -1,                          /* section_length */
-                                &ld->bytes_written,
-                                &err);
-            g_free(appname);
-
-            for (i = 0; successful && (i < capture_opts->ifaces->len); i++) {
-                interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
-                pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
-                if (pcap_opts->from_cap_pipe) {
-                    pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
-                } else {
-                    pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
-                }
-                successful = pcapng_write_interface_description_block(global_ld.pdh,
-                                                                      NULL,                       /* OPT_COMMENT       1 */
-                                                                      interface_opts.name,        /* IDB_NAME          2 */
-                                                                      interface_opts.descr,       /* IDB_DESCRIPTION   3 */
-                                                                      interface_opts.cfilter,     /* IDB_FILTER       11 */
-                                                                      os_info_str->str,           /* IDB_OS           12 */
-                                                                      pcap_opts->linktype,
-                                                                      pcap_opts->snaplen,
-                                                                      &(global_ld.bytes_written),
-                                                                      0,                          /* IDB_IF_SPEED      8 */
-                                                                      pcap_opts->ts_nsec ? 9 : 6, /* IDB_TSRESOL       9 */
-                                                                      &global_ld.err);
-            }
-
-            g_string_free(os_info_str, TRUE);
-
-        } else {
-            pcap_opts = g_array_index(ld->pcaps, pcap_options *, 0);
-            if (pcap_opts->from_cap_pipe) {
-                pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
-            } else {
-                pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
-            }
-            successful = libpcap_write_file_header(ld->pdh, pcap_opts->linktype, pcap_opts->snaplen,
-                                                   pcap_opts->ts_nsec, &ld->bytes_written, &err);
-        }
+        successful = capture_loop_write_file_header(capture_opts, ld, ld->pdh,
+                                                    &ld->bytes_written, &err);
         if (!successful) {
             fclose(ld->pdh);
             ld->pdh = NULL;
@@ -2473,53 +2685,79 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     return TRUE;
 }
 
+/* write the interface statistics to an output file and close it */
 static gboolean
-capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
+capture_loop_close_file(capture_options *capture_opts, FILE *pdh, guint64 *bytes_written,
+                        guint64 end_time, int *err_close)
 {
-
     unsigned int  i;
     pcap_options *pcap_opts;
+
+    if (capture_opts->use_pcapng) {
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            if (!pcap_opts->from_cap_pipe) {
+                guint64 isb_ifrecv, isb_ifdrop;
+                struct pcap_stat stats;
+                char stats_errmsg[MSG_MAX_LENGTH+1];
+
+                if (capture_loop_get_stats(pcap_opts, &stats, stats_errmsg, sizeof(stats_errmsg))) {
+                    isb_ifrecv = pcap_opts->received;
+                    isb_ifdrop = stats.ps_drop + pcap_opts->dropped + pcap_opts->flushed;
+               } else {
+                    isb_ifrecv = G_MAXUINT64;
+                    isb_ifdrop = G_MAXUINT64;
+                }
+                pcapng_write_interface_statistics_block(pdh,
+                                                        i,
+                                                        bytes_written,
+                                                        "Counters provided by dumpcap",
+                                                        start_time,
+                                                        end_time,
+                                                        isb_ifrecv,
+                                                        isb_ifdrop,
+                                                        err_close);
+            }
+        }
+    }
+    if (fclose(pdh) == EOF) {
+        if (err_close != NULL) {
+            *err_close = errno;
+        }
+        return (FALSE);
+    } else {
+        return (TRUE);
+    }
+}
+
+static gboolean
+capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
+{
     guint64       end_time = create_timestamp();
+    guint         i;
+    gboolean      close_ok;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_output");
 
     if (capture_opts->multi_files_on) {
         return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
-    } else {
-        if (capture_opts->use_pcapng) {
-            for (i = 0; i < global_ld.pcaps->len; i++) {
-                pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
-                if (!pcap_opts->from_cap_pipe) {
-                    guint64 isb_ifrecv, isb_ifdrop;
-                    struct pcap_stat stats;
-
-                    if (pcap_stats(pcap_opts->pcap_h, &stats) >= 0) {
-                        isb_ifrecv = pcap_opts->received;
-                        isb_ifdrop = stats.ps_drop + pcap_opts->dropped + pcap_opts->flushed;
-                   } else {
-                        isb_ifrecv = G_MAXUINT64;
-                        isb_ifdrop = G_MAXUINT64;
-                    }
-                    pcapng_write_interface_statistics_block(ld->pdh,
-                                                            i,
-                                                            &ld->bytes_written,
-                                                            "Counters provided by dumpcap",
-                                                            start_time,
-                                                            end_time,
-                                                            isb_ifrecv,
-                                                            isb_ifdrop,
-                                                            err_close);
+    } else if (num_shards > 0) {
+        /* The shard writer threads have already been stopped */
+        close_ok = TRUE;
+        for (i = 0; i < num_shards; i++) {
+            if (shards[i].pdh != NULL) {
+                if (!capture_loop_close_file(capture_opts, shards[i].pdh, &shards[i].bytes_written,
+                                             end_time, err_close)) {
+                    close_ok = FALSE;
                 }
+                shards[i].pdh = NULL;
             }
         }
-        if (fclose(ld->pdh) == EOF) {
-            if (err_close != NULL) {
-                *err_close = errno;
-            }
-            return (FALSE);
-        } else {
-            return (TRUE);
-        }
+        capture_loop_free_shards(FALSE);
+        return close_ok;
+    } else {
+        return capture_loop_close_file(capture_opts, ld->pdh, &ld->bytes_written,
+                                       end_time, err_close);
     }
 }
 
@@ -2576,6 +2814,22 @@ capture_loop_dispatch(loop_data *ld,
     else
     {
         /* dispatch from pcap */
+#ifdef HAVE_LINUX_TPACKET_V3
+        if (pcap_opts->tpacket != NULL) {
+#ifdef LOG_CAPTURE_VERBOSE
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_dispatch: from TPACKET_V3 ring");
+#endif
+            /* Hand over a whole block of packets at once */
+            inpkts = tpacket_v3_dispatch(pcap_opts->tpacket, CAP_READ_TIMEOUT, pcap_opts->ts_nsec,
+                                         use_threads ? capture_loop_queue_packet_cb : capture_loop_write_packet_cb,
+                                         (u_char *)pcap_opts, errmsg, errmsg_len);
+            if (inpkts < 0) {
+                report_capture_error(errmsg, please_report);
+                ld->go = FALSE;
+            }
+        }
+        else
+#endif /* HAVE_LINUX_TPACKET_V3 */
 #ifdef MUST_DO_SELECT
         /*
          * If we have "pcap_get_selectable_fd()", we use it to get the
@@ -2958,6 +3212,633 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+/*
+ * Allocate a ring for packets with the given snapshot length.
+ * It's sized so that it can hold the bytes allowed by the queue byte
+ * limit, plus the per-record overhead of the packets allowed by the queue
+ * packet limit.  With only a byte limit, the packet count is the number
+ * of packets of the snapshot length that fit in it; with neither,
+ * PCAP_RING_DEFAULT_BYTES and PCAP_RING_DEFAULT_PACKETS are used.  The
+ * snapshot length also makes sure that one packet of the largest size
+ * fits.
+ */
+#define PCAP_RING_DEFAULT_BYTES     (1000 * 1000)
+#define PCAP_RING_DEFAULT_PACKETS   1000
+#define PCAP_RING_MAX_SIZE          (1U << 30)
+
+static pcap_ring *
+pcap_ring_new(int snaplen)
+{
+    pcap_ring *ring;
+    guint64    max_rec_len, bytes, packets, want, size;
+
+    if ((snaplen <= 0) || (snaplen > WTAP_MAX_PACKET_SIZE)) {
+        snaplen = WTAP_MAX_PACKET_SIZE;
+    }
+    max_rec_len = PCAP_RING_RECORD_LEN(snaplen);
+    bytes = (pcap_queue_byte_limit > 0) ? (guint64)pcap_queue_byte_limit : PCAP_RING_DEFAULT_BYTES;
+    if (pcap_queue_packet_limit > 0) {
+        packets = (guint64)pcap_queue_packet_limit;
+    } else if (pcap_queue_byte_limit > 0) {
+        packets = (bytes + snaplen - 1) / snaplen;
+    } else {
+        packets = PCAP_RING_DEFAULT_PACKETS;
+    }
+    want = bytes + packets * PCAP_RING_RECORD_LEN(0);
+    /* Leave room for the padding when a record wraps around */
+    want += 2 * max_rec_len;
+    for (size = PCAP_RING_ALIGN; (size < want) && (size < PCAP_RING_MAX_SIZE); size <<= 1)
+        ;
+
+    ring = (pcap_ring *)g_malloc(sizeof(pcap_ring));
+    ring->buf = (guint8 *)g_malloc((gsize)size);
+    ring->size = (guint32)size;
+    ring->head = 0;
+    ring->tail = 0;
+    return ring;
+}
+
+static void
+pcap_ring_free(pcap_ring *ring)
+{
+    if (ring != NULL) {
+        g_free(ring->buf);
+        g_free(ring);
+    }
+}
+
+/*
+ * Append a packet to a ring; called from the producing thread only.
+ * Returns FALSE if there's no room for it.
+ */
+static gboolean
+pcap_ring_put(pcap_ring *ring, pcap_options *pcap_opts,
+              const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    pcap_ring_record *rec;
+    guint32           rec_len, head, tail, offset, contig, needed;
+
+    /* We're the only thread advancing head, so we don't need an atomic
+       read for it; the consumer may advance tail at any time. */
+    rec_len = PCAP_RING_RECORD_LEN(phdr->caplen);
+    head = (guint32)ring->head;
+    tail = (guint32)g_atomic_int_get(&ring->tail);
+    offset = head & (ring->size - 1);
+    contig = ring->size - offset;
+    needed = (rec_len <= contig) ? rec_len : contig + rec_len;
+    if ((rec_len > ring->size) || (needed > ring->size - (head - tail))) {
+        return FALSE;
+    }
+    if (rec_len > contig) {
+        /* Doesn't fit before the end of the buffer; skip to the start */
+        ((pcap_ring_record *)(void *)(ring->buf + offset))->len = 0;
+        head += contig;
+        offset = 0;
+    }
+    rec = (pcap_ring_record *)(void *)(ring->buf + offset);
+    rec->len = rec_len;
+    rec->pcap_opts = pcap_opts;
+    rec->phdr = *phdr;
+    memcpy(rec + 1, pd, phdr->caplen);
+    /* Publish the record; this is a full memory barrier, so the
+       consumer sees the data before it sees the new head. */
+    g_atomic_int_set(&ring->head, (gint)(head + rec_len));
+    return TRUE;
+}
+
+static gboolean
+pcap_ring_is_empty(pcap_ring *ring)
+{
+    return g_atomic_int_get(&ring->head) == g_atomic_int_get(&ring->tail);
+}
+
+/*
+ * Hand all the packets queued in a ring to write_func; called from the
+ * consuming thread only.  Returns the number of packets written.
+ */
+static int
+pcap_ring_drain(pcap_ring *ring, pcap_ring_write_func write_func, void *user_data)
+{
+    pcap_ring_record *rec;
+    guint32           head, tail, offset;
+    int               count = 0;
+
+    tail = (guint32)ring->tail;
+    head = (guint32)g_atomic_int_get(&ring->head);
+    while (tail != head) {
+        offset = tail & (ring->size - 1);
+        rec = (pcap_ring_record *)(void *)(ring->buf + offset);
+        if (rec->len == 0) {
+            /* The next record is at the start of the buffer */
+            tail += ring->size - offset;
+        } else {
+            (*write_func)(rec->pcap_opts, &rec->phdr, (const u_char *)(rec + 1), user_data);
+            tail += rec->len;
+            count++;
+        }
+        /* Hand the space back to the producer */
+        g_atomic_int_set(&ring->tail, (gint)tail);
+    }
+    return count;
+}
+
+static void
+pcap_ring_waiter_init(pcap_ring_waiter *waiter)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+    waiter->mtx = (GMutex *)g_malloc(sizeof(GMutex));
+    g_mutex_init(waiter->mtx);
+    waiter->cond = (GCond *)g_malloc(sizeof(GCond));
+    g_cond_init(waiter->cond);
+#else
+    waiter->mtx = g_mutex_new();
+    waiter->cond = g_cond_new();
+#endif
+    waiter->waiting = 0;
+}
+
+static void
+pcap_ring_waiter_clear(pcap_ring_waiter *waiter)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+    g_cond_clear(waiter->cond);
+    g_free(waiter->cond);
+    g_mutex_clear(waiter->mtx);
+    g_free(waiter->mtx);
+#else
+    g_cond_free(waiter->cond);
+    g_mutex_free(waiter->mtx);
+#endif
+    waiter->cond = NULL;
+    waiter->mtx = NULL;
+}
+
+/* Wake up the consumer if it's waiting; called by producers after a put */
+static void
+pcap_ring_wake(pcap_ring_waiter *waiter)
+{
+    if (g_atomic_int_get(&waiter->waiting)) {
+        g_mutex_lock(waiter->mtx);
+        g_cond_signal(waiter->cond);
+        g_mutex_unlock(waiter->mtx);
+    }
+}
+
+/*
+ * Wait until a producer puts a packet into one of the consumer's rings,
+ * but at most WRITER_THREAD_TIMEOUT.  pending is called once the
+ * producers know we're waiting, to see whether a packet was put before.
+ */
+static void
+pcap_ring_wait(pcap_ring_waiter *waiter, gboolean (*pending)(void *), void *data)
+{
+#if GLIB_CHECK_VERSION(2,31,18)
+    gint64        end_time;
+
+    end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+#else
+    GTimeVal      write_thread_time;
+
+    g_get_current_time(&write_thread_time);
+    g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
+#endif
+    g_mutex_lock(waiter->mtx);
+    g_atomic_int_set(&waiter->waiting, 1);
+    if (!(*pending)(data)) {
+#if GLIB_CHECK_VERSION(2,31,18)
+        g_cond_wait_until(waiter->cond, waiter->mtx, end_time);
+#else
+        g_cond_timed_wait(waiter->cond, waiter->mtx, &write_thread_time);
+#endif
+    }
+    g_atomic_int_set(&waiter->waiting, 0);
+    g_mutex_unlock(waiter->mtx);
+}
+
+/* Write out a packet the reader thread of an interface queued */
+static void
+capture_loop_dequeue_packet_cb(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                               const u_char *pd, void *user_data _U_)
+{
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Dequeued a packet of length %d captured on interface %d.",
+          phdr->caplen, pcap_opts->interface_id);
+
+    capture_loop_write_packet_cb((u_char *) pcap_opts, phdr, pd);
+    g_atomic_int_add(&pcap_queue_bytes, -(gint)phdr->caplen);
+    g_atomic_int_add(&pcap_queue_packets, -1);
+}
+
+/* Did the reader thread of any interface queue a packet? */
+static gboolean
+capture_loop_queue_pending(void *data _U_)
+{
+    pcap_options *pcap_opts;
+    guint         i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+        if (!pcap_ring_is_empty(pcap_opts->ring)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* write one packet to an output file */
+static gboolean
+capture_loop_write_packet(FILE *pdh, guint64 *bytes_written, pcap_options *pcap_opts,
+                          const struct pcap_pkthdr *phdr, const u_char *pd, int *err)
+{
+    guint ts_mul = pcap_opts->ts_nsec ? 1000000000 : 1000000;
+
+    if (global_capture_opts.use_pcapng) {
+        return pcapng_write_enhanced_packet_block(pdh,
+                                                  NULL,
+                                                  phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
+                                                  phdr->caplen, phdr->len,
+                                                  pcap_opts->interface_id,
+                                                  ts_mul,
+                                                  pd, 0,
+                                                  bytes_written, err);
+    } else {
+        return libpcap_write_packet(pdh,
+                                    phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
+                                    phdr->caplen, phdr->len,
+                                    pd,
+                                    bytes_written, err);
+    }
+}
+
+/*
+ * Hash of one end of a conversation; the hashes of both ends are added,
+ * so the result is the same in both directions.
+ */
+static guint32
+capture_flow_hash_endpoint(const guint8 *addr, guint addr_len, guint16 port)
+{
+    guint32 h = 2166136261U;    /* FNV-1a */
+    guint   i;
+
+    for (i = 0; i < addr_len; i++) {
+        h = (h ^ addr[i]) * 16777619U;
+    }
+    h = (h ^ (port >> 8)) * 16777619U;
+    h = (h ^ (port & 0xff)) * 16777619U;
+    return h;
+}
+
+/*
+ * Symmetric hash of the addresses, protocol and, if present, ports of an
+ * IPv4 or IPv6 packet.  Fragments only use the addresses, as only the
+ * first one has the ports, and all fragments of a packet have to end up
+ * in the same file.
+ */
+static guint32
+capture_flow_hash_ip(guint16 ethertype, const guint8 *p, guint32 len)
+{
+    const guint8 *src, *dst;
+    guint         addr_len, hdr_len;
+    guint8        proto;
+    gboolean      fragment;
+    guint16       sport = 0, dport = 0;
+    guint32       h;
+
+    switch (ethertype) {
+
+    case 0x0800:    /* IPv4 */
+        if (len < 20 || (p[0] >> 4) != 4) {
+            return 0;
+        }
+        hdr_len = (p[0] & 0x0f) * 4;
+        proto = p[9];
+        fragment = (pntoh16(p + 6) & 0x3fff) != 0;  /* MF or offset */
+        src = p + 12;
+        dst = p + 16;
+        addr_len = 4;
+        break;
+
+    case 0x86dd:    /* IPv6 */
+        if (len < 40 || (p[0] >> 4) != 6) {
+            return 0;
+        }
+        hdr_len = 40;
+        proto = p[6];
+        fragment = FALSE;
+        /* Skip the extension headers that come before the ports */
+        while ((proto == 0 || proto == 43 || proto == 60 || proto == 44) &&
+               len >= hdr_len + 8) {
+            if (proto == 44) {
+                /* A fragment header without an offset or M flag is
+                 * an atomic fragment, i.e. the whole packet */
+                if ((pntoh16(p + hdr_len + 2) & 0xfff9) != 0) {
+                    fragment = TRUE;
+                    break;
+                }
+                proto = p[hdr_len];
+                hdr_len += 8;
+            } else {
+                proto = p[hdr_len];
+                hdr_len += (p[hdr_len + 1] + 1) * 8;
+            }
+        }
+        src = p + 8;
+        dst = p + 24;
+        addr_len = 16;
+        break;
+
+    default:
+        return 0;
+    }
+
+    if (fragment) {
+        h = capture_flow_hash_endpoint(src, addr_len, 0) +
+            capture_flow_hash_endpoint(dst, addr_len, 0);
+    } else {
+        if (len >= hdr_len + 4 &&
+            (proto == 6 || proto == 17 || proto == 33 || proto == 132 || proto == 136)) {
+            /* TCP, UDP, DCCP, SCTP and UDP-Lite all start with the ports */
+            sport = pntoh16(p + hdr_len);
+            dport = pntoh16(p + hdr_len + 2);
+        }
+        h = capture_flow_hash_endpoint(src, addr_len, sport) +
+            capture_flow_hash_endpoint(dst, addr_len, dport);
+        h ^= proto;
+    }
+    /* Mix the bits, so that taking the remainder works well */
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    return h;
+}
+
+/*
+ * Flow hash of a packet, for the link-layer types that we know how to
+ * find the IP header in.  Everything else hashes to 0, i.e. goes to the
+ * first shard.
+ */
+static guint32
+capture_flow_hash(int linktype, const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    guint32 len = phdr->caplen;
+    guint32 off;
+    guint16 ethertype;
+
+    switch (linktype) {
+
+    case DLT_EN10MB:
+        if (len < 14) {
+            return 0;
+        }
+        ethertype = pntoh16(pd + 12);
+        off = 14;
+        /* Skip VLAN tags */
+        while ((ethertype == 0x8100 || ethertype == 0x88a8 || ethertype == 0x9100) &&
+               len >= off + 4) {
+            ethertype = pntoh16(pd + off + 2);
+            off += 4;
+        }
+        break;
+
+#ifdef DLT_LINUX_SLL
+    case DLT_LINUX_SLL:
+        if (len < 16) {
+            return 0;
+        }
+        ethertype = pntoh16(pd + 14);
+        off = 16;
+        break;
+#endif
+
+#ifdef DLT_RAW
+    case DLT_RAW:
+        if (len < 1) {
+            return 0;
+        }
+        ethertype = ((pd[0] >> 4) == 6) ? 0x86dd : 0x0800;
+        off = 0;
+        break;
+#endif
+
+    case DLT_NULL:
+#ifdef DLT_LOOP
+    case DLT_LOOP:
+#endif
+        /* The address family is in host or network byte order; look at the IP version instead */
+        if (len < 5) {
+            return 0;
+        }
+        ethertype = ((pd[4] >> 4) == 6) ? 0x86dd : 0x0800;
+        off = 4;
+        break;
+
+    default:
+        return 0;
+    }
+    return capture_flow_hash_ip(ethertype, pd + off, len - off);
+}
+
+/* Write a packet the writer thread put into a shard ring; runs in the shard thread */
+static void
+capture_shard_write_cb(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                       const u_char *pd, void *user_data)
+{
+    capture_shard *shard = (capture_shard *)user_data;
+    int            err;
+
+    if (shard->err != 0) {
+        return;
+    }
+    if (!capture_loop_write_packet(shard->pdh, &shard->bytes_written,
+                                   pcap_opts, phdr, pd, &err)) {
+        g_atomic_int_set(&shard->err, err);
+    }
+}
+
+static gboolean
+capture_shard_pending(void *data)
+{
+    capture_shard *shard = (capture_shard *)data;
+
+    return !pcap_ring_is_empty(shard->ring);
+}
+
+static void *
+capture_shard_thread(void *arg)
+{
+    capture_shard *shard = (capture_shard *)arg;
+    gboolean       stopping;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Started thread for shard %u.",
+          shard->num);
+    for (;;) {
+        /* Check this first, so that the last packets are drained below */
+        stopping = g_atomic_int_get(&shard->stop);
+        if (pcap_ring_drain(shard->ring, capture_shard_write_cb, shard) == 0) {
+            if (stopping) {
+                break;
+            }
+            pcap_ring_wait(&shard->waiter, capture_shard_pending, shard);
+        }
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped thread for shard %u.",
+          shard->num);
+    return (NULL);
+}
+
+/*
+ * Hand a packet to the thread writing its shard; called from the writer
+ * thread.  If the shard's ring is full, wait for its thread to catch up
+ * rather than drop the packet.
+ */
+static gboolean
+capture_loop_shard_packet(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                          const u_char *pd, int *err)
+{
+    capture_shard *shard;
+
+    shard = &shards[capture_flow_hash(pcap_opts->linktype, phdr, pd) % num_shards];
+    while (!pcap_ring_put(shard->ring, pcap_opts, phdr, pd)) {
+        if ((*err = g_atomic_int_get(&shard->err)) != 0) {
+            return FALSE;
+        }
+        pcap_ring_wake(&shard->waiter);
+        g_usleep(SHARD_FULL_WAIT);
+    }
+    pcap_ring_wake(&shard->waiter);
+    if ((*err = g_atomic_int_get(&shard->err)) != 0) {
+        return FALSE;
+    }
+    /* We don't know the size of the written block yet; count the data */
+    global_ld.bytes_written += phdr->caplen;
+    return TRUE;
+}
+
+/*
+ * Open the shard files, named after the -w file with the shard number
+ * added, write their headers and start their threads.
+ */
+static gboolean
+capture_loop_open_shards(capture_options *capture_opts, loop_data *ld,
+                         char *errmsg, int errmsg_len)
+{
+    capture_shard *shard;
+    gchar         *prefix;
+    const gchar   *suffix;
+    gchar         *basename;
+    guint          i;
+    int            fd, err = 0;
+    int            snaplen = 0;
+
+    /* Split the file name into prefix and suffix, as ringbuf_init() does */
+    basename = g_path_get_basename(capture_opts->save_file);
+    suffix = strrchr(basename, '.');
+    if (suffix == NULL) {
+        suffix = "";
+        prefix = g_strdup(capture_opts->save_file);
+    } else {
+        prefix = g_strndup(capture_opts->save_file,
+                           strlen(capture_opts->save_file) - strlen(suffix));
+    }
+
+    shards = g_new0(capture_shard, num_shards);
+    for (i = 0; i < num_shards; i++) {
+        shard = &shards[i];
+        shard->num = i;
+        shard->filename = g_strdup_printf("%s_shard%02u%s", prefix, i, suffix);
+        fd = ws_open(shard->filename, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                     (capture_opts->group_read_access) ? 0640 : 0600);
+        if (fd == -1 || (shard->pdh = ws_fdopen(fd, "wb")) == NULL) {
+            err = errno;
+            if (fd != -1) {
+                ws_close(fd);
+            }
+        } else if (!capture_loop_write_file_header(capture_opts, ld, shard->pdh,
+                                                   &shard->bytes_written, &err)) {
+            fclose(shard->pdh);
+            shard->pdh = NULL;
+        }
+        if (shard->pdh == NULL) {
+            g_snprintf(errmsg, errmsg_len,
+                       "The file to which the capture would be"
+                       " saved (\"%s\") could not be opened: %s.",
+                       shard->filename, (err > 0) ? g_strerror(err) : "Unknown error");
+            g_free(prefix);
+            g_free(basename);
+            /* We couldn't start the capture, so get rid of the files */
+            capture_loop_free_shards(TRUE);
+            return FALSE;
+        }
+    }
+    g_free(prefix);
+    g_free(basename);
+
+    /* Writing the headers has set the snapshot lengths */
+    for (i = 0; i < ld->pcaps->len; i++) {
+        snaplen = MAX(snaplen, g_array_index(ld->pcaps, pcap_options *, i)->snaplen);
+    }
+    for (i = 0; i < num_shards; i++) {
+        shard = &shards[i];
+        shard->ring = pcap_ring_new(snaplen);
+        pcap_ring_waiter_init(&shard->waiter);
+#if GLIB_CHECK_VERSION(2,31,0)
+        shard->tid = g_thread_new("Shard write", capture_shard_thread, shard);
+#else
+        shard->tid = g_thread_create(capture_shard_thread, shard, TRUE, NULL);
+#endif
+        fflush(shard->pdh);
+        report_new_capture_file(shard->filename);
+    }
+    return TRUE;
+}
+
+/* Let the shard threads write what they've got, and wait for them */
+static void
+capture_loop_stop_shards(void)
+{
+    guint i;
+
+    for (i = 0; i < num_shards; i++) {
+        g_atomic_int_set(&shards[i].stop, TRUE);
+        pcap_ring_wake(&shards[i].waiter);
+    }
+    for (i = 0; i < num_shards; i++) {
+        if (shards[i].tid != NULL) {
+            /* Wakes up by itself after at most WRITER_THREAD_TIMEOUT */
+            g_thread_join(shards[i].tid);
+            shards[i].tid = NULL;
+        }
+        if (shards[i].err != 0 && global_ld.err == 0) {
+            global_ld.err = shards[i].err;
+        }
+    }
+}
+
+static void
+capture_loop_free_shards(gboolean unlink_files)
+{
+    guint i;
+
+    if (shards == NULL) {
+        return;
+    }
+    for (i = 0; i < num_shards; i++) {
+        if (shards[i].pdh != NULL) {
+            fclose(shards[i].pdh);
+        }
+        if (unlink_files && shards[i].filename != NULL) {
+            ws_unlink(shards[i].filename);
+        }
+        if (shards[i].ring != NULL) {
+            pcap_ring_free(shards[i].ring);
+            pcap_ring_waiter_clear(&shards[i].waiter);
+        }
+        g_free(shards[i].filename);
+    }
+    g_free(shards);
+    shards = NULL;
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3062,11 +3943,26 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_snprintf(secondary_errmsg, sizeof(secondary_errmsg), "%s", please_report);
             goto error;
         }
+#ifdef HAVE_LINUX_TPACKET_V3
+        if (pcap_opts->tpacket != NULL &&
+            !capture_loop_init_tpacket_filter(pcap_opts, &interface_opts,
+                                              errmsg, sizeof(errmsg))) {
+            g_snprintf(secondary_errmsg, sizeof(secondary_errmsg),
+                       "Try capturing without --tpacket-v3.");
+            goto error;
+        }
+#endif
     }
 
     /* If we're supposed to write to a capture file, open it for output
        (temporary/specified name/ringbuffer) */
-    if (capture_opts->saving_to_file) {
+    if (capture_opts->saving_to_file && num_shards > 0) {
+        /* set up the flow shard files and their writer threads */
+        if (!capture_loop_open_shards(capture_opts, &global_ld, errmsg,
+                                      sizeof(errmsg))) {
+            goto error;
+        }
+    } else if (capture_opts->saving_to_file) {
         if (!capture_loop_open_output(capture_opts, &global_ld.save_file_fd,
                                       errmsg, sizeof(errmsg))) {
             goto error;
@@ -3131,11 +4027,12 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
         pcap_queue_bytes = 0;
         pcap_queue_packets = 0;
+        pcap_ring_waiter_init(&pcap_ring_writer);
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            pcap_opts->ring = pcap_ring_new(pcap_opts->snaplen);
 #if GLIB_CHECK_VERSION(2,31,0)
             /* XXX - Add an interface name here? */
             pcap_opts->tid = g_thread_new("Capture read", pcap_read_handler, pcap_opts);
@@ -3147,37 +4044,13 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-#if GLIB_CHECK_VERSION(2,31,18)
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-#else
-            GTimeVal write_thread_time;
-
-            g_get_current_time(&write_thread_time);
-            g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timed_pop_unlocked(pcap_queue, &write_thread_time);
-#endif
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
+            inpkts = 0;
+            for (i = 0; i < global_ld.pcaps->len; i++) {
+                pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+                inpkts += pcap_ring_drain(pcap_opts->ring, capture_loop_dequeue_packet_cb, NULL);
             }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                      "Dequeued a packet of length %d captured on interface %d.",
-                      queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-
-                capture_loop_write_packet_cb((u_char *) queue_element->pcap_opts,
-                                             &queue_element->phdr,
-                                             queue_element->pd);
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
+            if (inpkts == 0) {
+                pcap_ring_wait(&pcap_ring_writer, capture_loop_queue_pending, NULL);
             }
         } else {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, 0);
@@ -3270,8 +4143,6 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
-
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
@@ -3280,30 +4151,19 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_opts->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_opts,
-                                         &queue_element->phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
-            global_ld.inpkts_to_sync_pipe += 1;
-            if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
-            }
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            global_ld.inpkts_to_sync_pipe += pcap_ring_drain(pcap_opts->ring, capture_loop_dequeue_packet_cb, NULL);
+            pcap_ring_free(pcap_opts->ring);
+            pcap_opts->ring = NULL;
         }
+        if (capture_opts->output_to_pipe) {
+            fflush(global_ld.pdh);
+        }
+        pcap_ring_waiter_clear(&pcap_ring_writer);
+    }
+    if (shards != NULL) {
+        capture_loop_stop_shards();
     }
 
 
@@ -3415,14 +4275,14 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
              * platforms; initialize it to 0 to handle that.
              */
             stats->ps_ifdrop = 0;
-            if (pcap_stats(pcap_opts->pcap_h, stats) >= 0) {
+            if (capture_loop_get_stats(pcap_opts, stats, secondary_errmsg, sizeof(secondary_errmsg))) {
                 *stats_known = TRUE;
                 /* Let the parent process know. */
                 pcap_dropped += stats->ps_drop;
             } else {
                 g_snprintf(errmsg, sizeof(errmsg),
                            "Can't get packet-drop statistics: %s",
-                           pcap_geterr(pcap_opts->pcap_h));
+                           secondary_errmsg);
                 report_capture_error(errmsg, please_report);
             }
         }
@@ -3441,6 +4301,8 @@ error:
     if (capture_opts->multi_files_on) {
         /* cleanup ringbuffer */
         ringbuf_error_cleanup();
+    } else if (num_shards > 0) {
+        /* capture_loop_open_shards() has removed the files it created */
     } else {
         /* We can't use the save file, and we have no FILE * for the stream
            to close in order to close it, so close the FD directly. */
@@ -3539,7 +4401,6 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
 {
     pcap_options *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
     int           err;
-    guint         ts_mul    = pcap_opts->ts_nsec ? 1000000000 : 1000000;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -3549,27 +4410,18 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    if (global_ld.pdh) {
+    if (global_ld.pdh || num_shards > 0) {
         gboolean successful;
 
-        /* We're supposed to write the packet to a file; do so.
+        /* We're supposed to write the packet to a file, or hand it to
+           the thread writing its flow shard; do so.
            If this fails, set "ld->go" to FALSE, to stop the capture, and set
            "ld->err" to the error. */
-        if (global_capture_opts.use_pcapng) {
-            successful = pcapng_write_enhanced_packet_block(global_ld.pdh,
-                                                            NULL,
-                                                            phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
-                                                            phdr->caplen, phdr->len,
-                                                            pcap_opts->interface_id,
-                                                            ts_mul,
-                                                            pd, 0,
-                                                            &global_ld.bytes_written, &err);
+        if (num_shards > 0) {
+            successful = capture_loop_shard_packet(pcap_opts, phdr, pd, &err);
         } else {
-            successful = libpcap_write_packet(global_ld.pdh,
-                                              phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
-                                              phdr->caplen, phdr->len,
-                                              pd,
-                                              &global_ld.bytes_written, &err);
+            successful = capture_loop_write_packet(global_ld.pdh, &global_ld.bytes_written,
+                                                   pcap_opts, phdr, pd, &err);
         }
         if (!successful) {
             global_ld.go = FALSE;
@@ -3597,7 +4449,6 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
                              const u_char *pd)
 {
     pcap_options       *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
-    pcap_queue_element *queue_element;
     gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
@@ -3608,35 +4459,21 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
-    if (queue_element == NULL) {
-       pcap_opts->dropped++;
-       return;
-    }
-    queue_element->pcap_opts = pcap_opts;
-    queue_element->phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_opts->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
+    if (((pcap_queue_byte_limit == 0) || (g_atomic_int_get(&pcap_queue_bytes) < pcap_queue_byte_limit)) &&
+        ((pcap_queue_packet_limit == 0) || (g_atomic_int_get(&pcap_queue_packets) < pcap_queue_packet_limit))) {
+        /* Count the packet before the writer thread can see it */
+        g_atomic_int_add(&pcap_queue_bytes, (gint)phdr->caplen);
+        g_atomic_int_add(&pcap_queue_packets, 1);
+        limit_reached = !pcap_ring_put(pcap_opts->ring, pcap_opts, phdr, pd);
+        if (limit_reached) {
+            g_atomic_int_add(&pcap_queue_bytes, -(gint)phdr->caplen);
+            g_atomic_int_add(&pcap_queue_packets, -1);
+        }
     } else {
         limit_reached = TRUE;
     }
-    g_async_queue_unlock(pcap_queue);
     if (limit_reached) {
         pcap_opts->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
@@ -3645,12 +4482,13 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Queued a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
+        pcap_ring_wake(&pcap_ring_writer);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
+    /* The counters may have been changed by other threads in the
+       meantime. So the output may be wrong */
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+          "Queue size is now %d bytes (%d packets)",
+          g_atomic_int_get(&pcap_queue_bytes), g_atomic_int_get(&pcap_queue_packets));
 }
 
 static int
@@ -3734,6 +4572,10 @@ main(int argc, char *argv[])
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         LONGOPT_CAPTURE_COMMON
+#ifdef HAVE_LINUX_TPACKET_V3
+        {"tpacket-v3", no_argument, NULL, LONGOPT_TPACKET_V3},
+#endif
+        {"flow-shards", required_argument, NULL, LONGOPT_FLOW_SHARDS},
         {0, 0, 0, 0 }
     };
 
@@ -4198,6 +5040,18 @@ main(int argc, char *argv[])
         case 'N':
             pcap_queue_packet_limit = get_positive_int(optarg, "packet_limit");
             break;
+#ifdef HAVE_LINUX_TPACKET_V3
+        case LONGOPT_TPACKET_V3:
+            use_tpacket_v3 = TRUE;
+            break;
+#endif
+        case LONGOPT_FLOW_SHARDS:
+            num_shards = get_positive_int(optarg, "number of flow shards");
+            if (num_shards > MAX_FLOW_SHARDS) {
+                cmdarg_err("The number of flow shards may not be greater than %u.", MAX_FLOW_SHARDS);
+                arg_error = TRUE;
+            }
+            break;
         default:
             cmdarg_err("Invalid Option: %s", argv[optind-1]);
             /* FALLTHROUGH */
@@ -4287,6 +5141,22 @@ main(int argc, char *argv[])
 #endif
             }
         }
+
+        /* Flow shards are written to files named after the -w file. */
+        if (num_shards > 0) {
+            if (global_capture_opts.save_file == NULL || global_capture_opts.output_to_pipe) {
+                cmdarg_err("Flow shards requested, but capture isn't being saved to a permanent file.");
+                exit_main(1);
+            }
+            if (global_capture_opts.multi_files_on) {
+                cmdarg_err("Flow shards can't be used with a ring buffer.");
+                exit_main(1);
+            }
+            if (capture_child) {
+                cmdarg_err("Flow shards can't be used when capturing for another program.");
+                exit_main(1);
+            }
+        }
     }
 
     /*
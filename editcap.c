@@ -117,6 +117,9 @@ static int       cur_dup_entry = 0;
 
 static int       ignored_bytes  = 0;  /* Used with -I */
 
+/* Long option values that aren't single-character options */
+#define LONGOPT_COMPRESS 0x8200
+
 #define ONE_BILLION 1000000000
 
 /* Weights of different errors we can introduce */
@@ -160,6 +163,7 @@ static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcap     */
 #endif
 static int                    out_frame_type            = -2; /* Leave frame type alone */
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    verbose                   = 0;  /* Not so verbose         */
 static struct time_adjustment time_adj                  = {{0, 0}, 0}; /* no adjustment */
 static nstime_t               relative_time_window      = {0, 0}; /* de-dup time window */
@@ -802,6 +806,8 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file(s); <type> is gzip, zstd\n");
+    fprintf(output, "                         or lz4.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h                     display this help and exit.\n");
@@ -914,11 +920,11 @@ editcap_dump_open(const char *filename, guint32 snaplen,
   if (strcmp(filename, "-") == 0) {
     /* Write to the standard output. */
     pdh = wtap_dump_open_stdout_ng(out_file_type_subtype, out_frame_type,
-                                   snaplen, FALSE /* compressed */,
+                                   snaplen, out_compression_type,
                                    shb_hdrs, idb_inf, nrb_hdrs, write_err);
   } else {
     pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                            snaplen, FALSE /* compressed */,
+                            snaplen, out_compression_type,
                             shb_hdrs, idb_inf, nrb_hdrs, write_err);
   }
   return pdh;
@@ -935,6 +941,7 @@ main(int argc, char *argv[])
     int           opt;
     static const struct option long_options[] = {
         {"novlan", no_argument, NULL, 0x8100},
+        {"compress", required_argument, NULL, LONGOPT_COMPRESS},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'V'},
         {0, 0, 0, 0 }
@@ -1027,6 +1034,27 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS:
+        {
+            if (strcmp(optarg, "gzip") == 0) {
+                out_compression_type = WTAP_GZIP_COMPRESSED;
+            } else if (strcmp(optarg, "zstd") == 0) {
+                out_compression_type = WTAP_ZSTD_COMPRESSED;
+            } else if (strcmp(optarg, "lz4") == 0) {
+                out_compression_type = WTAP_LZ4_COMPRESSED;
+            } else {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid compression type\n\n",
+                        optarg);
+                exit(1);
+            }
+            if (!wtap_can_write_compression_type(out_compression_type)) {
+                fprintf(stderr, "editcap: This version of editcap can't write %s compressed files\n",
+                        optarg);
+                exit(1);
+            }
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1305,6 +1333,13 @@ main(int argc, char *argv[])
         exit(1);
     }
 
+    if (out_compression_type != WTAP_UNCOMPRESSED &&
+        !wtap_dump_can_compress(out_file_type_subtype)) {
+        fprintf(stderr, "editcap: %s files can't be written compressed\n",
+                wtap_file_type_subtype_string(out_file_type_subtype));
+        exit(1);
+    }
+
     if (split_packet_count > 0 && secs_per_block > 0) {
         fprintf(stderr, "editcap: can't split on both packet count and time interval\n");
         fprintf(stderr, "editcap: at the same time\n");
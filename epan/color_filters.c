@@ -56,6 +56,13 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* The enabled filters in color_filter_list compiled into a single dfilter,
+ * so that fields used by several of them are only read once per packet,
+ * and the filters they came from, in the same order. */
+static dfilter_t *color_filters_combined      = NULL;
+static GPtrArray *color_filters_combined_list = NULL;
+static gboolean   color_filters_combined_stale = TRUE;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -180,6 +187,7 @@ color_filters_set_tmp(guint8 filt_nr, const gchar *filter, gboolean disabled, gc
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
                 colorf->disabled = ((i!=filt_nr) ? TRUE : disabled);
+                color_filters_combined_stale = TRUE;
                 /* Remember that there are now temporary coloring filters set */
                 if( filter )
                     tmp_colors_set = TRUE;
@@ -298,6 +306,7 @@ color_filters_init(gchar** err_msg, color_filter_add_cb_func add_cb)
 {
     /* delete all currently existing filters */
     color_filter_list_delete(&color_filter_list);
+    color_filters_combined_stale = TRUE;
 
     /* start the list with the temporary colorizing rules */
     color_filters_add_tmp(&color_filter_list);
@@ -325,6 +334,7 @@ color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb)
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
+    color_filters_combined_stale = TRUE;
 
     /* start the list with the temporary colorizing rules */
     color_filters_add_tmp(&color_filter_list);
@@ -349,6 +359,15 @@ color_filters_cleanup(void)
 {
     /* delete the previously deleted filters */
     color_filter_list_delete(&color_filter_deleted_list);
+
+    /* and the combined filter; it's recompiled if it's needed again */
+    dfilter_free(color_filters_combined);
+    color_filters_combined = NULL;
+    if (color_filters_combined_list != NULL) {
+        g_ptr_array_free(color_filters_combined_list, TRUE);
+        color_filters_combined_list = NULL;
+    }
+    color_filters_combined_stale = TRUE;
 }
 
 typedef struct _color_clone
@@ -425,6 +444,7 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, gchar** err_msg)
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
+    color_filters_combined_stale = TRUE;
 
     /* clone all list entries from tmp/edit to normal list */
     color_filter_valid_list = NULL;
@@ -462,6 +482,41 @@ tmp_color_filters_used(void)
     return tmp_colors_set;
 }
 
+/* (Re)compile the enabled filters into color_filters_combined.  If that
+ * fails, the filters are applied one at a time. */
+static void
+color_filters_combine(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+    GPtrArray      *texts;
+    gchar          *err_msg = NULL;
+
+    dfilter_free(color_filters_combined);
+    color_filters_combined = NULL;
+    if (color_filters_combined_list != NULL)
+        g_ptr_array_free(color_filters_combined_list, TRUE);
+    color_filters_combined_list = g_ptr_array_new();
+
+    texts = g_ptr_array_new();
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if ( (!colorf->disabled) && (colorf->c_colorfilter != NULL) ) {
+            g_ptr_array_add(color_filters_combined_list, colorf);
+            g_ptr_array_add(texts, colorf->filter_text);
+        }
+    }
+
+    if (texts->len > 0 &&
+        !dfilter_compile_first_match((const gchar **)texts->pdata, texts->len,
+                                     &color_filters_combined, &err_msg)) {
+        g_free(err_msg);
+    }
+    g_ptr_array_free(texts, TRUE);
+
+    color_filters_combined_stale = FALSE;
+}
+
 /* prepare the epan_dissect_t for the filter */
 static void
 prime_edt(gpointer data, gpointer user_data)
@@ -478,8 +533,15 @@ prime_edt(gpointer data, gpointer user_data)
 void
 color_filters_prime_edt(epan_dissect_t *edt)
 {
-    if (color_filters_used())
-        g_slist_foreach(color_filter_list, prime_edt, edt);
+    if (color_filters_used()) {
+        if (color_filters_combined_stale)
+            color_filters_combine();
+
+        if (color_filters_combined != NULL)
+            epan_dissect_prime_dfilter(edt, color_filters_combined);
+        else
+            g_slist_foreach(color_filter_list, prime_edt, edt);
+    }
 }
 
 /* * Return the color_t for later use */
@@ -488,9 +550,20 @@ color_filters_colorize_packet(epan_dissect_t *edt)
 {
     GSList         *curr;
     color_filter_t *colorf;
+    int             match;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
+        if (color_filters_combined_stale)
+            color_filters_combine();
+
+        if (color_filters_combined != NULL) {
+            match = dfilter_apply_first_match(color_filters_combined, edt);
+            if (match < 0)
+                return NULL;
+            return (color_filter_t *)g_ptr_array_index(color_filters_combined_list, match);
+        }
+
         curr = color_filter_list;
 
         while(curr != NULL) {
@@ -81,7 +81,8 @@ WS_DLL_PUBLIC gboolean color_filters_init(gchar** err_msg, color_filter_add_cb_f
 /** Reload the color filters */
 WS_DLL_PUBLIC gboolean color_filters_reload(gchar** err_msg, color_filter_add_cb_func add_cb);
 
-/** Cleanup remaining color filter zombies */
+/** Cleanup remaining color filter zombies, and the filter the enabled
+ * filters were combined into */
 WS_DLL_PUBLIC void color_filters_cleanup(void);
 
 /** Color filters currently used?
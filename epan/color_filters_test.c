@@ -0,0 +1,278 @@
+/* color_filters_test.c
+ * Color filter tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/proto.h>
+#include <epan/color_filters.h>
+#include <epan/dfilter/dfilter.h>
+#include <wsutil/report_err.h>
+
+#include "register.h"
+
+static epan_t *session;
+static int hf_ip_ttl = -1;
+
+typedef struct
+{
+    const gchar *name;
+    const gchar *text;
+    gboolean disabled;
+} test_filter_s;
+
+/* Make the filters the current color filters, in the order given */
+static void
+set_filters(const test_filter_s *filters, guint num_filters)
+{
+    GSList *cfl = NULL;
+    color_t color;
+    gchar *err_msg;
+    gboolean ok;
+    guint i;
+
+    memset(&color, 0, sizeof color);
+    for (i = 0; i < num_filters; i++) {
+        cfl = g_slist_append(cfl, color_filter_new(filters[i].name,
+                    filters[i].text, &color, &color, filters[i].disabled));
+    }
+    ok = color_filters_apply(NULL, cfl, &err_msg);
+    g_assert_cmpstr(err_msg, ==, NULL);
+    g_assert(ok);
+    color_filter_list_delete(&cfl);
+}
+
+/* Dissect a "packet" holding only an IP TTL, returning the name of
+ * the color filter that matches it, or NULL */
+static const gchar *
+colorize_ttl(guint32 ttl)
+{
+    epan_dissect_t *edt;
+    const color_filter_t *colorf;
+
+    edt = epan_dissect_new(session, TRUE, FALSE);
+    color_filters_prime_edt(edt);
+    proto_tree_add_uint(edt->tree, hf_ip_ttl, NULL, 0, 0, ttl);
+    colorf = color_filters_colorize_packet(edt);
+    epan_dissect_free(edt);
+    return colorf ? colorf->filter_name : NULL;
+}
+
+/* Apply a dfilter compiled with dfilter_compile_first_match() to a
+ * "packet" holding only an IP TTL */
+static int
+first_match_ttl(dfilter_t *df, guint32 ttl)
+{
+    epan_dissect_t *edt;
+    int match;
+
+    edt = epan_dissect_new(session, TRUE, FALSE);
+    epan_dissect_prime_dfilter(edt, df);
+    proto_tree_add_uint(edt->tree, hf_ip_ttl, NULL, 0, 0, ttl);
+    match = dfilter_apply_first_match(df, edt);
+    epan_dissect_free(edt);
+    return match;
+}
+
+static void
+color_filters_test_first_match(void)
+{
+    static const gchar *texts[] = {
+        "ip.ttl == 1", "", "ip.ttl > 10", "ip.ttl == 64"
+    };
+    dfilter_t *df;
+    gchar *err_msg = NULL;
+    gboolean ok;
+
+    ok = dfilter_compile_first_match(texts, G_N_ELEMENTS(texts), &df, &err_msg);
+    g_assert(ok);
+    g_assert(df != NULL);
+    g_assert_cmpint(first_match_ttl(df, 1), ==, 0);
+    /* the empty filter never matches, and the first match wins */
+    g_assert_cmpint(first_match_ttl(df, 64), ==, 2);
+    g_assert_cmpint(first_match_ttl(df, 5), ==, -1);
+    dfilter_free(df);
+}
+
+static void
+color_filters_test_first_match_error(void)
+{
+    static const gchar *texts[] = {
+        "ip.ttl == 1", "ip.ttl ==", "ip.ttl == 64"
+    };
+    dfilter_t *df = NULL;
+    gchar *err_msg = NULL;
+    gboolean ok;
+
+    ok = dfilter_compile_first_match(texts, G_N_ELEMENTS(texts), &df, &err_msg);
+    g_assert(!ok);
+    g_assert(df == NULL);
+    g_assert(err_msg != NULL);
+    g_free(err_msg);
+}
+
+static void
+color_filters_test_overlap(void)
+{
+    static const test_filter_s filters[] = {
+        { "big",  "ip.ttl > 10",  FALSE },
+        { "64",   "ip.ttl == 64", FALSE },
+        { "one",  "ip.ttl == 1",  FALSE }
+    };
+
+    set_filters(filters, G_N_ELEMENTS(filters));
+    g_assert_cmpstr(colorize_ttl(64), ==, "big");
+    g_assert_cmpstr(colorize_ttl(11), ==, "big");
+    g_assert_cmpstr(colorize_ttl(1), ==, "one");
+    g_assert(colorize_ttl(5) == NULL);
+}
+
+static void
+color_filters_test_disabled(void)
+{
+    static const test_filter_s filters[] = {
+        { "big",  "ip.ttl > 10",  TRUE },
+        { "off",  "ip.ttl == 64", TRUE },
+        { "64",   "ip.ttl == 64", FALSE },
+        { "one",  "ip.ttl == 1",  FALSE }
+    };
+
+    set_filters(filters, G_N_ELEMENTS(filters));
+    g_assert_cmpstr(colorize_ttl(64), ==, "64");
+    g_assert_cmpstr(colorize_ttl(1), ==, "one");
+    g_assert(colorize_ttl(11) == NULL);
+}
+
+static void
+color_filters_test_apply(void)
+{
+    static const test_filter_s before[] = {
+        { "64",   "ip.ttl == 64", FALSE }
+    };
+    static const test_filter_s after[] = {
+        { "one",  "ip.ttl == 1",  FALSE }
+    };
+
+    set_filters(before, G_N_ELEMENTS(before));
+    g_assert_cmpstr(colorize_ttl(64), ==, "64");
+    set_filters(after, G_N_ELEMENTS(after));
+    g_assert(colorize_ttl(64) == NULL);
+    g_assert_cmpstr(colorize_ttl(1), ==, "one");
+}
+
+static void
+color_filters_test_cleanup(void)
+{
+    static const test_filter_s filters[] = {
+        { "big",  "ip.ttl > 10",  FALSE },
+        { "64",   "ip.ttl == 64", FALSE }
+    };
+
+    set_filters(filters, G_N_ELEMENTS(filters));
+    g_assert_cmpstr(colorize_ttl(64), ==, "big");
+    /* the combined filter is freed, and compiled again when it's used */
+    color_filters_cleanup();
+    g_assert_cmpstr(colorize_ttl(64), ==, "big");
+    color_filters_cleanup();
+    color_filters_cleanup();
+    g_assert(colorize_ttl(1) == NULL);
+}
+
+static void
+failure_message(const char *msg_format, va_list ap)
+{
+    fprintf(stderr, "color_filters_test: ");
+    vfprintf(stderr, msg_format, ap);
+    fprintf(stderr, "\n");
+}
+
+static void
+open_failure_message(const char *filename, int err, gboolean for_writing _U_)
+{
+    fprintf(stderr, "color_filters_test: can't open \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+static void
+read_failure_message(const char *filename, int err)
+{
+    fprintf(stderr, "color_filters_test: can't read \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+static void
+write_failure_message(const char *filename, int err)
+{
+    fprintf(stderr, "color_filters_test: can't write \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    init_report_err(failure_message, open_failure_message,
+                    read_failure_message, write_failure_message);
+    if (!epan_init(register_all_protocols, register_all_protocol_handoffs,
+                   NULL, NULL))
+        return 2;
+    hf_ip_ttl = proto_registrar_get_id_byname("ip.ttl");
+    g_assert(hf_ip_ttl != -1);
+    session = epan_new();
+
+    g_test_add_func("/color_filters/first_match",   color_filters_test_first_match);
+    g_test_add_func("/color_filters/first_match/error",   color_filters_test_first_match_error);
+    g_test_add_func("/color_filters/colorize/overlap",   color_filters_test_overlap);
+    g_test_add_func("/color_filters/colorize/disabled",   color_filters_test_disabled);
+    g_test_add_func("/color_filters/colorize/apply",   color_filters_test_apply);
+    g_test_add_func("/color_filters/colorize/cleanup",   color_filters_test_cleanup);
+
+    result = g_test_run();
+
+    color_filters_cleanup();
+    epan_free(session);
+    epan_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
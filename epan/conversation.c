@@ -75,6 +75,33 @@ static conversation_key *conversation_keys;
 
 static guint32 new_index;
 
+/*
+ * Several dissectors look up the conversation for the same frame with
+ * the same arguments - TCP, then SSL, then HTTP, say.  Remember the last
+ * few lookups so that repeats are answered without hashing the addresses
+ * and probing the hash tables again.  Any change to the hash tables
+ * forgets them all.  Only addresses that fit in the memo are remembered.
+ */
+#define CONVERSATION_MEMO_SIZE		4
+#define CONVERSATION_MEMO_ADDR_LEN	16
+
+typedef struct conversation_memo {
+	gboolean	valid;
+	guint32		frame_num;
+	address		addr_a;
+	address		addr_b;
+	port_type	ptype;
+	guint32		port_a;
+	guint32		port_b;
+	guint		options;
+	conversation_t	*conversation;
+	guint8		addr_a_data[CONVERSATION_MEMO_ADDR_LEN];
+	guint8		addr_b_data[CONVERSATION_MEMO_ADDR_LEN];
+} conversation_memo;
+
+static conversation_memo conversation_memos[CONVERSATION_MEMO_SIZE];
+static guint conversation_memo_next;
+
 /*
  * Protocol-specific data attached to a conversation_t structure - protocol
  * index and opaque pointer.
@@ -181,30 +208,52 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 }
 
 /*
- * Compute the hash value for two given address/port pairs if the match
- * is to be exact.
+ * Compute the hash value for one address/port pair.
  */
 /* http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
  * One-at-a-Time hash
  */
 static guint
-conversation_hash_exact(gconstpointer v)
+conversation_hash_endpoint(const address *addr, guint32 port)
 {
-	const conversation_key *key = (const conversation_key *)v;
 	guint hash_val;
 	address tmp_addr;
 
 	hash_val = 0;
 	tmp_addr.len  = 4;
 
-	hash_val = add_address_to_hash(hash_val, &key->addr1);
+	hash_val = add_address_to_hash(hash_val, addr);
 
-	tmp_addr.data = &key->port1;
+	tmp_addr.data = &port;
 	hash_val = add_address_to_hash(hash_val, &tmp_addr);
 
-	hash_val = add_address_to_hash(hash_val, &key->addr2);
+	return hash_val;
+}
 
-	tmp_addr.data = &key->port2;
+/*
+ * Compute the hash value for two given address/port pairs if the match
+ * is to be exact.
+ *
+ * conversation_match_exact() matches the two pairs in either order, so
+ * the hash doesn't depend on the order either; that way one lookup finds
+ * the conversation whichever direction the packet is going in.
+ */
+static guint
+conversation_hash_exact(gconstpointer v)
+{
+	const conversation_key *key = (const conversation_key *)v;
+	guint hash_val, hash_1, hash_2;
+	address tmp_addr;
+
+	hash_1 = conversation_hash_endpoint(&key->addr1, key->port1);
+	hash_2 = conversation_hash_endpoint(&key->addr2, key->port2);
+
+	tmp_addr.len  = 4;
+
+	hash_val = 0;
+	tmp_addr.data = hash_1 < hash_2 ? &hash_1 : &hash_2;
+	hash_val = add_address_to_hash(hash_val, &tmp_addr);
+	tmp_addr.data = hash_1 < hash_2 ? &hash_2 : &hash_1;
 	hash_val = add_address_to_hash(hash_val, &tmp_addr);
 
 	hash_val += ( hash_val << 3 );
@@ -472,6 +521,69 @@ free_data_list(gpointer value)
 
 }
 
+/*
+ * Forget all the remembered lookups.
+ */
+static void
+conversation_memo_clear(void)
+{
+	guint i;
+
+	for (i = 0; i < CONVERSATION_MEMO_SIZE; i++)
+		conversation_memos[i].valid = FALSE;
+}
+
+static conversation_memo *
+conversation_memo_lookup(const guint32 frame_num, const address *addr_a, const address *addr_b,
+    const port_type ptype, const guint32 port_a, const guint32 port_b, const guint options)
+{
+	conversation_memo *memo;
+	guint i;
+
+	for (i = 0; i < CONVERSATION_MEMO_SIZE; i++) {
+		memo = &conversation_memos[i];
+		if (memo->valid &&
+		    memo->frame_num == frame_num &&
+		    memo->port_a == port_a &&
+		    memo->port_b == port_b &&
+		    memo->ptype == ptype &&
+		    memo->options == options &&
+		    addresses_equal(&memo->addr_a, addr_a) &&
+		    addresses_equal(&memo->addr_b, addr_b))
+			return memo;
+	}
+	return NULL;
+}
+
+static void
+conversation_memo_add(const guint32 frame_num, const address *addr_a, const address *addr_b,
+    const port_type ptype, const guint32 port_a, const guint32 port_b, const guint options,
+    conversation_t *conversation)
+{
+	conversation_memo *memo;
+
+	if (addr_a->len < 0 || addr_a->len > CONVERSATION_MEMO_ADDR_LEN ||
+	    addr_b->len < 0 || addr_b->len > CONVERSATION_MEMO_ADDR_LEN)
+		return;
+
+	memo = &conversation_memos[conversation_memo_next];
+	conversation_memo_next = (conversation_memo_next + 1) % CONVERSATION_MEMO_SIZE;
+
+	if (addr_a->len != 0)
+		memcpy(memo->addr_a_data, addr_a->data, addr_a->len);
+	set_address(&memo->addr_a, addr_a->type, addr_a->len, memo->addr_a_data);
+	if (addr_b->len != 0)
+		memcpy(memo->addr_b_data, addr_b->data, addr_b->len);
+	set_address(&memo->addr_b, addr_b->type, addr_b->len, memo->addr_b_data);
+	memo->frame_num = frame_num;
+	memo->ptype = ptype;
+	memo->port_a = port_a;
+	memo->port_b = port_b;
+	memo->options = options;
+	memo->conversation = conversation;
+	memo->valid = TRUE;
+}
+
 /*
  * Destroy all existing conversations
  */
@@ -484,6 +596,7 @@ conversation_cleanup(void)
 	 *  don't have to clean them up.
 	 */
 	conversation_keys = NULL;
+	conversation_memo_clear();
 	if (conversation_hashtable_exact != NULL) {
 		g_hash_table_destroy(conversation_hashtable_exact);
 	}
@@ -535,6 +648,7 @@ conversation_init(void)
 	 * Start the conversation indices over at 0.
 	 */
 	new_index = 0;
+	conversation_memo_clear();
 }
 
 /*
@@ -548,6 +662,8 @@ conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *chain_tail, *cur, *prev;
 
+	conversation_memo_clear();
+
 	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
 
 	if (NULL==chain_head) {
@@ -604,6 +720,8 @@ conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *cur, *prev;
 
+	conversation_memo_clear();
+
 	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
 
 	if (conv == chain_head) {
@@ -880,8 +998,8 @@ conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, co
  *
  *	otherwise, we found no matching conversation, and return NULL.
  */
-conversation_t *
-find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
+static conversation_t *
+find_conversation_uncached(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
     const guint32 port_a, const guint32 port_b, const guint options)
 {
 	conversation_t *conversation;
@@ -899,14 +1017,11 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			conversation_lookup_hashtable(conversation_hashtable_exact,
 			frame_num, addr_a, addr_b, ptype,
 			port_a, port_b);
-		/* Didn't work, try the other direction */
-		if (conversation == NULL) {
-			DPRINT(("trying opposite direction"));
-			conversation =
-				conversation_lookup_hashtable(conversation_hashtable_exact,
-				frame_num, addr_b, addr_a, ptype,
-				port_b, port_a);
-		}
+		/*
+		 * The exact match table hashes and matches the two
+		 * address/port pairs in either order, so that has
+		 * also found a conversation going the other way.
+		 */
 		if ((conversation == NULL) && (addr_a->type == AT_FC)) {
 			/* In Fibre channel, OXID & RXID are never swapped as
 			 * TCP/UDP ports are in TCP/IP.
@@ -1210,6 +1325,58 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 	return NULL;
 }
 
+conversation_t *
+find_conversation_exact(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
+    const guint32 port_a, const guint32 port_b)
+{
+	conversation_t *conversation;
+
+	conversation =
+		conversation_lookup_hashtable(conversation_hashtable_exact,
+		frame_num, addr_a, addr_b, ptype, port_a, port_b);
+	if ((conversation == NULL) && (addr_a->type == AT_FC)) {
+		/* In Fibre channel, OXID & RXID are never swapped as
+		 * TCP/UDP ports are in TCP/IP.
+		 */
+		conversation =
+			conversation_lookup_hashtable(conversation_hashtable_exact,
+			frame_num, addr_b, addr_a, ptype, port_a, port_b);
+	}
+	return conversation;
+}
+
+/*
+ * find_conversation_uncached(), with the answers to the last few lookups
+ * remembered.
+ */
+conversation_t *
+find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
+    const guint32 port_a, const guint32 port_b, const guint options)
+{
+	conversation_memo *memo;
+	conversation_t *conversation;
+
+	memo = conversation_memo_lookup(frame_num, addr_a, addr_b, ptype,
+	    port_a, port_b, options);
+	if (memo != NULL) {
+		DPRINT(("remembered match %sfound", memo->conversation?"":"not "));
+		return memo->conversation;
+	}
+
+	conversation = find_conversation_uncached(frame_num, addr_a, addr_b,
+	    ptype, port_a, port_b, options);
+
+	/*
+	 * A wildcard match may have filled in the conversation's second
+	 * address or port, which forgets the remembered lookups; this
+	 * result is remembered after that.
+	 */
+	conversation_memo_add(frame_num, addr_a, addr_b, ptype, port_a,
+	    port_b, options, conversation);
+
+	return conversation;
+}
+
 static gint
 p_compare(gconstpointer a, gconstpointer b)
 {
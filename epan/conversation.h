@@ -146,6 +146,14 @@ WS_DLL_PUBLIC conversation_t *conversation_new(const guint32 setup_frame, const
 WS_DLL_PUBLIC conversation_t *find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b,
     const port_type ptype, const guint32 port_a, const guint32 port_b, const guint options);
 
+/**
+ * Like find_conversation(), but only looks for a conversation with both
+ * address/port pairs given, in either order, and never changes the
+ * conversation it finds.
+ */
+extern conversation_t *find_conversation_exact(const guint32 frame_num, const address *addr_a, const address *addr_b,
+    const port_type ptype, const guint32 port_a, const guint32 port_b);
+
 /**  A helper function that calls find_conversation() and, if a conversation is
  *  not found, calls conversation_new().
  *  The frame number and addresses are taken from pinfo.
@@ -185,8 +193,8 @@ try_conversation_dissector(const address *addr_a, const address *addr_b, const p
 
 /* These routines are used to set undefined values for a conversation */
 
-extern void conversation_set_port2(conversation_t *conv, const guint32 port);
-extern void conversation_set_addr2(conversation_t *conv, const address *addr);
+WS_DLL_PUBLIC void conversation_set_port2(conversation_t *conv, const guint32 port);
+WS_DLL_PUBLIC void conversation_set_addr2(conversation_t *conv, const address *addr);
 
 WS_DLL_PUBLIC
 GHashTable *get_conversation_hashtable_exact(void);
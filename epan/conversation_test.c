@@ -0,0 +1,208 @@
+/* conversation_test.c
+ * Conversation lookup tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/address.h>
+#include <epan/conversation.h>
+#include <wsutil/report_err.h>
+
+#include "register.h"
+
+static const guint8 addr_a_data[] = { 10, 0, 0, 1 };
+static const guint8 addr_b_data[] = { 10, 0, 0, 2 };
+static const guint8 addr_c_data[] = { 10, 0, 0, 3 };
+static address addr_a, addr_b, addr_c;
+
+/*
+ * Repeated lookups are answered from a memo; each test checks that a
+ * change to the conversation tables is seen by a repeat of a lookup
+ * that was made before the change.
+ */
+
+static void
+conversation_test_insert(void)
+{
+    epan_t *session;
+    conversation_t *conv;
+
+    session = epan_new();
+
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == NULL);
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == NULL);
+    conv = conversation_new(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0);
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv);
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv);
+    /* the other direction */
+    g_assert(find_conversation(5, &addr_b, &addr_a, PT_TCP, 1234, 80, 0) == conv);
+
+    epan_free(session);
+}
+
+static void
+conversation_test_insert_later(void)
+{
+    epan_t *session;
+    conversation_t *conv1, *conv2;
+
+    session = epan_new();
+
+    conv1 = conversation_new(10, &addr_a, &addr_b, PT_TCP, 80, 1234, 0);
+    g_assert(find_conversation(5, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == NULL);
+    g_assert(find_conversation(25, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv1);
+    /* the same addresses and ports, reused from frame 20 on */
+    conv2 = conversation_new(20, &addr_a, &addr_b, PT_TCP, 80, 1234, 0);
+    g_assert(find_conversation(25, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv2);
+    g_assert(find_conversation(15, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv1);
+
+    epan_free(session);
+}
+
+static void
+conversation_test_set_port2(void)
+{
+    epan_t *session;
+    conversation_t *conv;
+
+    session = epan_new();
+
+    conv = conversation_new(1, &addr_a, &addr_b, PT_TCP, 80, 0, NO_PORT2);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_TCP, 80, 0, NO_PORT_B) == conv);
+    /* moves it from the wildcarded port table to the exact one */
+    conversation_set_port2(conv, 1234);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_TCP, 80, 0, NO_PORT_B) == NULL);
+    g_assert(find_conversation(2, &addr_a, &addr_b, PT_TCP, 80, 1234, 0) == conv);
+
+    epan_free(session);
+}
+
+static void
+conversation_test_set_addr2(void)
+{
+    epan_t *session;
+    conversation_t *conv;
+
+    session = epan_new();
+
+    conv = conversation_new(1, &addr_a, &addr_a, PT_TCP, 81, 443, NO_ADDR2);
+    g_assert(find_conversation(2, &addr_a, &addr_c, PT_TCP, 81, 443, NO_ADDR_B) == conv);
+    /* moves it from the wildcarded address table to the exact one */
+    conversation_set_addr2(conv, &addr_c);
+    g_assert(find_conversation(2, &addr_a, &addr_c, PT_TCP, 81, 443, NO_ADDR_B) == NULL);
+    g_assert(find_conversation(2, &addr_a, &addr_c, PT_TCP, 81, 443, 0) == conv);
+
+    epan_free(session);
+}
+
+static void
+conversation_test_init(void)
+{
+    epan_t *session;
+    conversation_t *conv;
+
+    session = epan_new();
+    conv = conversation_new(1, &addr_a, &addr_b, PT_UDP, 53, 5353, 0);
+    g_assert(find_conversation(1, &addr_a, &addr_b, PT_UDP, 53, 5353, 0) == conv);
+    epan_free(session);
+
+    /* a new file starts with no conversations */
+    session = epan_new();
+    g_assert(find_conversation(1, &addr_a, &addr_b, PT_UDP, 53, 5353, 0) == NULL);
+    epan_free(session);
+}
+
+static void
+failure_message(const char *msg_format, va_list ap)
+{
+    fprintf(stderr, "conversation_test: ");
+    vfprintf(stderr, msg_format, ap);
+    fprintf(stderr, "\n");
+}
+
+static void
+open_failure_message(const char *filename, int err, gboolean for_writing _U_)
+{
+    fprintf(stderr, "conversation_test: can't open \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+static void
+read_failure_message(const char *filename, int err)
+{
+    fprintf(stderr, "conversation_test: can't read \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+static void
+write_failure_message(const char *filename, int err)
+{
+    fprintf(stderr, "conversation_test: can't write \"%s\": %s\n",
+            filename, g_strerror(err));
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    init_report_err(failure_message, open_failure_message,
+                    read_failure_message, write_failure_message);
+    if (!epan_init(register_all_protocols, register_all_protocol_handoffs,
+                   NULL, NULL))
+        return 2;
+
+    set_address(&addr_a, AT_IPv4, 4, addr_a_data);
+    set_address(&addr_b, AT_IPv4, 4, addr_b_data);
+    set_address(&addr_c, AT_IPv4, 4, addr_c_data);
+
+    g_test_add_func("/conversation/memo/insert",   conversation_test_insert);
+    g_test_add_func("/conversation/memo/insert/later",   conversation_test_insert_later);
+    g_test_add_func("/conversation/memo/set_port2",   conversation_test_set_port2);
+    g_test_add_func("/conversation/memo/set_addr2",   conversation_test_set_addr2);
+    g_test_add_func("/conversation/memo/init",   conversation_test_init);
+
+    result = g_test_run();
+
+    epan_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
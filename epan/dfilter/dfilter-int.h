@@ -37,6 +37,8 @@ struct epan_dfilter {
 	gboolean	*attempted_load;
 	int		*interesting_fields;
 	int		num_interesting_fields;
+	int		*required_protocols;
+	int		num_required_protocols;
 	GPtrArray	*deprecated;
 };
 
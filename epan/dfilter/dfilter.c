@@ -140,6 +140,7 @@ dfilter_free(dfilter_t *df)
 	}
 
 	g_free(df->interesting_fields);
+	g_free(df->required_protocols);
 
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
@@ -203,54 +204,33 @@ dfwork_free(dfwork_t *dfw)
 	g_free(dfw);
 }
 
-gboolean
-dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+/* Parses a filter string and checks its semantics, leaving the syntax
+ * tree in dfw->st_root; that is NULL for an empty filter.  On failure
+ * dfw->error_message may be set. */
+static gboolean
+dfw_parse(dfwork_t *dfw, const gchar *text, GPtrArray *deprecated)
 {
-	gchar		*expanded_text;
 	int		token;
-	dfilter_t	*dfilter;
-	dfwork_t	*dfw;
 	df_scanner_state_t state;
 	yyscan_t	scanner;
 	YY_BUFFER_STATE in_buffer;
 	gboolean failure = FALSE;
 	const char	*depr_test;
 	guint		i;
-	/* XXX, GHashTable */
-	GPtrArray	*deprecated;
-
-	g_assert(dfp);
-
-	if (!text) {
-		*dfp = NULL;
-		if (err_msg != NULL)
-			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
-		return FALSE;
-	}
-
-	if ( !( expanded_text = dfilter_macro_apply(text, err_msg) ) ) {
-		return FALSE;
-	}
 
 	if (df_lex_init(&scanner) != 0) {
-		*dfp = NULL;
-		if (err_msg != NULL)
-			*err_msg = g_strdup_printf("Can't initialize scanner: %s",
-			    g_strerror(errno));
+		dfilter_fail(dfw, "Can't initialize scanner: %s",
+		    g_strerror(errno));
 		return FALSE;
 	}
 
-	in_buffer = df__scan_string(expanded_text, scanner);
-
-	dfw = dfwork_new();
+	in_buffer = df__scan_string(text, scanner);
 
 	state.dfw = dfw;
 	state.quoted_string = NULL;
 
 	df_set_extra(&state, scanner);
 
-	deprecated = g_ptr_array_new();
-
 	while (1) {
 		df_lval = stnode_new(STTYPE_UNINITIALIZED, NULL);
 		token = df_lex(scanner);
@@ -320,48 +300,106 @@ dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
 	df_lex_destroy(scanner);
 
 	if (failure)
+		return FALSE;
+
+	/* Check semantics and do necessary type conversion*/
+	if (dfw->st_root != NULL && !dfw_semcheck(dfw, deprecated))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Tucks away the bytecode generated in dfw in a new dfilter_t. */
+static dfilter_t*
+dfilter_new_from_dfwork(dfwork_t *dfw, GPtrArray *deprecated)
+{
+	dfilter_t	*dfilter;
+
+	dfilter = dfilter_new();
+	dfilter->insns = dfw->insns;
+	dfilter->consts = dfw->consts;
+	dfw->insns = NULL;
+	dfw->consts = NULL;
+	dfilter->interesting_fields = dfw_interesting_fields(dfw,
+		&dfilter->num_interesting_fields);
+
+	/* Initialize run-time space */
+	dfilter->num_registers = dfw->first_constant;
+	dfilter->max_registers = dfw->next_register;
+	dfilter->registers = g_new0(GList*, dfilter->max_registers);
+	dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
+
+	/* Initialize constants */
+	dfvm_init_const(dfilter);
+
+	/* Add any deprecated items */
+	dfilter->deprecated = deprecated;
+
+	return dfilter;
+}
+
+static void
+free_deprecated(GPtrArray *deprecated)
+{
+	guint		i;
+
+	for (i = 0; i < deprecated->len; ++i) {
+		gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
+		g_free(depr);
+	}
+	g_ptr_array_free(deprecated, TRUE);
+}
+
+gboolean
+dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg)
+{
+	gchar		*expanded_text;
+	dfilter_t	*dfilter;
+	dfwork_t	*dfw;
+	/* XXX, GHashTable */
+	GPtrArray	*deprecated;
+	int		*required_protocols;
+	int		num_required_protocols;
+
+	g_assert(dfp);
+
+	if (!text) {
+		*dfp = NULL;
+		if (err_msg != NULL)
+			*err_msg = g_strdup("BUG: NULL text pointer passed to dfilter_compile()");
+		return FALSE;
+	}
+
+	if ( !( expanded_text = dfilter_macro_apply(text, err_msg) ) ) {
+		return FALSE;
+	}
+
+	dfw = dfwork_new();
+
+	deprecated = g_ptr_array_new();
+
+	if (!dfw_parse(dfw, expanded_text, deprecated))
 		goto FAILURE;
 
 	/* Success, but was it an empty filter? If so, discard
 	 * it and set *dfp to NULL */
 	if (dfw->st_root == NULL) {
 		*dfp = NULL;
-		for (i = 0; i < deprecated->len; ++i) {
-			gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
-			g_free(depr);
-		}
-		g_ptr_array_free(deprecated, TRUE);
+		free_deprecated(deprecated);
 	}
 	else {
-
-		/* Check semantics and do necessary type conversion*/
-		if (!dfw_semcheck(dfw, deprecated)) {
-			goto FAILURE;
-		}
+		/* Find the protocols it needs before code generation
+		 * takes the syntax tree apart */
+		required_protocols = dfw_required_protocols(dfw,
+			&num_required_protocols);
 
 		/* Create bytecode */
 		dfw_gencode(dfw);
 
 		/* Tuck away the bytecode in the dfilter_t */
-		dfilter = dfilter_new();
-		dfilter->insns = dfw->insns;
-		dfilter->consts = dfw->consts;
-		dfw->insns = NULL;
-		dfw->consts = NULL;
-		dfilter->interesting_fields = dfw_interesting_fields(dfw,
-			&dfilter->num_interesting_fields);
-
-		/* Initialize run-time space */
-		dfilter->num_registers = dfw->first_constant;
-		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
-		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
-
-		/* Initialize constants */
-		dfvm_init_const(dfilter);
-
-		/* Add any deprecated items */
-		dfilter->deprecated = deprecated;
+		dfilter = dfilter_new_from_dfwork(dfw, deprecated);
+		dfilter->required_protocols = required_protocols;
+		dfilter->num_required_protocols = num_required_protocols;
 
 		/* And give it to the user. */
 		*dfp = dfilter;
@@ -381,11 +419,7 @@ FAILURE:
 		global_dfw = NULL;
 		dfwork_free(dfw);
 	}
-	for (i = 0; i < deprecated->len; ++i) {
-		gchar* depr = (gchar*)g_ptr_array_index(deprecated,i);
-		g_free(depr);
-	}
-	g_ptr_array_free(deprecated, TRUE);
+	free_deprecated(deprecated);
 	if (err_msg != NULL) {
 		/*
 		 * Default error message.
@@ -400,6 +434,69 @@ FAILURE:
 	return FALSE;
 }
 
+gboolean
+dfilter_compile_first_match(const gchar **texts, guint num_texts,
+    dfilter_t **dfp, gchar **err_msg)
+{
+	gchar		*expanded_text;
+	dfwork_t	*dfw;
+	GPtrArray	*deprecated;
+	stnode_t	**roots;
+	guint		i;
+
+	g_assert(dfp);
+
+	dfw = dfwork_new();
+	deprecated = g_ptr_array_new();
+	roots = g_new0(stnode_t*, num_texts);
+
+	for (i = 0; i < num_texts; i++) {
+		if ( !( expanded_text = dfilter_macro_apply(texts[i], err_msg) ) ) {
+			goto FAILURE;
+		}
+		if (!dfw_parse(dfw, expanded_text, deprecated)) {
+			if (err_msg != NULL) {
+				if (dfw->error_message != NULL)
+					*err_msg = dfw->error_message;
+				else
+					*err_msg = g_strdup_printf("Unable to parse filter string \"%s\".", expanded_text);
+				dfw->error_message = NULL;
+			}
+			wmem_free(NULL, expanded_text);
+			goto FAILURE;
+		}
+		wmem_free(NULL, expanded_text);
+		roots[i] = dfw->st_root;
+		dfw->st_root = NULL;
+	}
+
+	/* Create bytecode that tries each filter in turn */
+	dfw_gencode_first_match(dfw, roots, num_texts);
+
+	*dfp = dfilter_new_from_dfwork(dfw, deprecated);
+
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i])
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
+	global_dfw = NULL;
+	dfwork_free(dfw);
+	return TRUE;
+
+FAILURE:
+	for (i = 0; i < num_texts; i++) {
+		if (roots[i])
+			stnode_free(roots[i]);
+	}
+	g_free(roots);
+	g_free(dfw->error_message);
+	global_dfw = NULL;
+	dfwork_free(dfw);
+	free_deprecated(deprecated);
+	*dfp = NULL;
+	return FALSE;
+}
 
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
@@ -413,6 +510,12 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+int
+dfilter_apply_first_match(dfilter_t *df, epan_dissect_t* edt)
+{
+	return dfvm_apply_first_match(df, edt->tree);
+}
+
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
@@ -430,6 +533,20 @@ dfilter_has_interesting_fields(const dfilter_t *df)
 	return (df->num_interesting_fields > 0);
 }
 
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields)
+{
+	*num_fields = df->num_interesting_fields;
+	return df->interesting_fields;
+}
+
+const int *
+dfilter_required_protocols(const dfilter_t *df, int *num_protocols)
+{
+	*num_protocols = df->num_required_protocols;
+	return df->required_protocols;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -61,6 +61,21 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg);
 
+/* Compiles a list of filter strings into a single dfilter_t that is
+ * applied with dfilter_apply_first_match().  Fields used by several of
+ * the filters are only read once per packet.  Empty filter strings
+ * never match.
+ *
+ * On failure, *err_msg is set as for dfilter_compile(), and *dfp is set
+ * to NULL.
+ *
+ * Returns TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean
+dfilter_compile_first_match(const gchar **texts, guint num_texts,
+    dfilter_t **dfp, gchar **err_msg);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -72,6 +87,12 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 
+/* Apply a dfilter compiled with dfilter_compile_first_match(); returns
+ * the index of the first of its filters that matches, or -1 if none do. */
+WS_DLL_PUBLIC
+int
+dfilter_apply_first_match(dfilter_t *df, struct epan_dissect *edt);
+
 /* Apply compiled dfilter */
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
@@ -84,6 +105,19 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 gboolean
 dfilter_has_interesting_fields(const dfilter_t *df);
 
+/* Get the fields and protocols the filter looks at, i.e. the ones
+ * dfilter_prime_proto_tree() primes a tree with. */
+WS_DLL_PUBLIC
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields);
+
+/* Get the protocols at least one of which must be in a packet's
+ * tree for the filter to match the packet.  Returns NULL if the
+ * filter can match without any particular protocol. */
+WS_DLL_PUBLIC
+const int *
+dfilter_required_protocols(const dfilter_t *df, int *num_protocols);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
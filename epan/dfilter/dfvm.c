@@ -22,6 +22,8 @@
 
 #include "dfvm.h"
 
+#include <string.h>
+
 #include <ftypes/ftypes-int.h>
 
 dfvm_insn_t*
@@ -38,6 +40,294 @@ dfvm_insn_new(dfvm_opcode_t op)
 	return insn;
 }
 
+/* How the constants in a dfvm_fvalue_set_t are hashed and compared;
+ * within each kind, equality is plain equality of the stored value. */
+typedef enum {
+	FVALUE_SET_NONE,
+	FVALUE_SET_UINT,
+	FVALUE_SET_UINT64,
+	FVALUE_SET_STRING,
+	FVALUE_SET_BYTES,
+	FVALUE_SET_IPV4
+} fvalue_set_kind_t;
+
+struct _dfvm_fvalue_set_t {
+	fvalue_set_kind_t	kind;
+	GHashTable		*table;
+	GPtrArray		*fvalues;	/* owns the constants */
+	GArray			*nmasks;	/* distinct IPv4 netmasks */
+};
+
+static fvalue_set_kind_t
+fvalue_set_kind(ftenum_t ftype)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			return FVALUE_SET_UINT;
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+		case FT_EUI64:
+			return FVALUE_SET_UINT64;
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			return FVALUE_SET_STRING;
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_OID:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			return FVALUE_SET_BYTES;
+		case FT_IPv4:
+			return FVALUE_SET_IPV4;
+		default:
+			return FVALUE_SET_NONE;
+	}
+}
+
+gboolean
+dfvm_fvalue_set_supported(ftenum_t ftype)
+{
+	return fvalue_set_kind(ftype) != FVALUE_SET_NONE;
+}
+
+static guint
+uint_hash(gconstpointer key)
+{
+	return ((const fvalue_t *)key)->value.uinteger;
+}
+
+static gboolean
+uint_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const fvalue_t *)a)->value.uinteger ==
+		((const fvalue_t *)b)->value.uinteger;
+}
+
+static guint
+uint64_hash(gconstpointer key)
+{
+	guint64 v = ((const fvalue_t *)key)->value.uinteger64;
+
+	return (guint)(v ^ (v >> 32));
+}
+
+static gboolean
+uint64_equal(gconstpointer a, gconstpointer b)
+{
+	return ((const fvalue_t *)a)->value.uinteger64 ==
+		((const fvalue_t *)b)->value.uinteger64;
+}
+
+static guint
+string_hash(gconstpointer key)
+{
+	return g_str_hash(((const fvalue_t *)key)->value.string);
+}
+
+static gboolean
+string_equal(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const fvalue_t *)a)->value.string,
+		((const fvalue_t *)b)->value.string) == 0;
+}
+
+static guint
+bytes_hash(gconstpointer key)
+{
+	const GByteArray *bytes = ((const fvalue_t *)key)->value.bytes;
+	guint	hash = bytes->len;
+	guint	i;
+
+	for (i = 0; i < bytes->len; i++) {
+		hash = (hash << 5) - hash + bytes->data[i];
+	}
+	return hash;
+}
+
+static gboolean
+bytes_equal(gconstpointer a, gconstpointer b)
+{
+	const GByteArray *bytes_a = ((const fvalue_t *)a)->value.bytes;
+	const GByteArray *bytes_b = ((const fvalue_t *)b)->value.bytes;
+
+	return bytes_a->len == bytes_b->len &&
+		memcmp(bytes_a->data, bytes_b->data, bytes_a->len) == 0;
+}
+
+/* IPv4 constants may be subnets; they are hashed on their network
+ * part, and an address is looked up once per distinct netmask. */
+static guint
+ipv4_hash(gconstpointer key)
+{
+	const ipv4_addr_and_mask *ipv4 = &((const fvalue_t *)key)->value.ipv4;
+
+	return (ipv4->addr & ipv4->nmask) ^ ipv4->nmask;
+}
+
+static gboolean
+ipv4_equal(gconstpointer a, gconstpointer b)
+{
+	const ipv4_addr_and_mask *ipv4_a = &((const fvalue_t *)a)->value.ipv4;
+	const ipv4_addr_and_mask *ipv4_b = &((const fvalue_t *)b)->value.ipv4;
+
+	return ipv4_a->nmask == ipv4_b->nmask &&
+		(ipv4_a->addr & ipv4_a->nmask) == (ipv4_b->addr & ipv4_b->nmask);
+}
+
+dfvm_fvalue_set_t*
+dfvm_fvalue_set_new(void)
+{
+	dfvm_fvalue_set_t	*set;
+
+	set = g_new(dfvm_fvalue_set_t, 1);
+	set->kind = FVALUE_SET_NONE;
+	set->table = NULL;
+	set->fvalues = g_ptr_array_new();
+	set->nmasks = NULL;
+	return set;
+}
+
+void
+dfvm_fvalue_set_add(dfvm_fvalue_set_t *set, fvalue_t *fv)
+{
+	fvalue_set_kind_t	kind;
+	guint32			nmask;
+	guint			i;
+
+	kind = fvalue_set_kind(fvalue_type_ftenum(fv));
+	g_assert(kind != FVALUE_SET_NONE);
+
+	if (set->table == NULL) {
+		set->kind = kind;
+		switch (kind) {
+			case FVALUE_SET_UINT:
+				set->table = g_hash_table_new(uint_hash, uint_equal);
+				break;
+			case FVALUE_SET_UINT64:
+				set->table = g_hash_table_new(uint64_hash, uint64_equal);
+				break;
+			case FVALUE_SET_STRING:
+				set->table = g_hash_table_new(string_hash, string_equal);
+				break;
+			case FVALUE_SET_BYTES:
+				set->table = g_hash_table_new(bytes_hash, bytes_equal);
+				break;
+			case FVALUE_SET_IPV4:
+				set->table = g_hash_table_new(ipv4_hash, ipv4_equal);
+				set->nmasks = g_array_new(FALSE, FALSE, sizeof(guint32));
+				break;
+			default:
+				g_assert_not_reached();
+		}
+	}
+	g_assert(kind == set->kind);
+
+	g_ptr_array_add(set->fvalues, fv);
+	g_hash_table_insert(set->table, fv, fv);
+
+	if (kind == FVALUE_SET_IPV4) {
+		nmask = fv->value.ipv4.nmask;
+		for (i = 0; i < set->nmasks->len; i++) {
+			if (g_array_index(set->nmasks, guint32, i) == nmask) {
+				break;
+			}
+		}
+		if (i == set->nmasks->len) {
+			g_array_append_val(set->nmasks, nmask);
+		}
+	}
+}
+
+static void
+dfvm_fvalue_set_free(dfvm_fvalue_set_t *set)
+{
+	guint	i;
+
+	for (i = 0; i < set->fvalues->len; i++) {
+		FVALUE_FREE((fvalue_t *)g_ptr_array_index(set->fvalues, i));
+	}
+	g_ptr_array_free(set->fvalues, TRUE);
+	if (set->table) {
+		g_hash_table_destroy(set->table);
+	}
+	if (set->nmasks) {
+		g_array_free(set->nmasks, TRUE);
+	}
+	g_free(set);
+}
+
+/* Compares the value with each constant in turn, as a chain of == tests
+ * would. */
+static gboolean
+fvalue_set_contains_slow(dfvm_fvalue_set_t *set, fvalue_t *fv)
+{
+	guint	i;
+
+	for (i = 0; i < set->fvalues->len; i++) {
+		if (fvalue_eq(fv, (fvalue_t *)g_ptr_array_index(set->fvalues, i))) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+dfvm_fvalue_set_contains(dfvm_fvalue_set_t *set, fvalue_t *fv)
+{
+	fvalue_t	probe;
+	guint32		nmask;
+	guint		i;
+
+	if (set->table == NULL) {
+		return FALSE;
+	}
+
+	/* A field of the same name, but of another type. */
+	if (fvalue_set_kind(fvalue_type_ftenum(fv)) != set->kind) {
+		return fvalue_set_contains_slow(set, fv);
+	}
+
+	if (set->kind != FVALUE_SET_IPV4) {
+		return g_hash_table_lookup(set->table, fv) != NULL;
+	}
+
+	/* == on IPv4 addresses applies the shorter of the two netmasks;
+	 * a value that is itself a wider subnet can't be hashed. */
+	probe = *fv;
+	for (i = 0; i < set->nmasks->len; i++) {
+		nmask = g_array_index(set->nmasks, guint32, i);
+		if ((nmask & fv->value.ipv4.nmask) != nmask) {
+			return fvalue_set_contains_slow(set, fv);
+		}
+		probe.value.ipv4.nmask = nmask;
+		if (g_hash_table_lookup(set->table, &probe)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 static void
 dfvm_value_free(dfvm_value_t *v)
 {
@@ -48,6 +338,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case FVALUE_SET:
+			dfvm_fvalue_set_free(v->value.fvalue_set);
+			break;
 		default:
 			/* nothing */
 			;
@@ -130,10 +423,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
+			case IF_TRUE_RETURN:
 			default:
 				g_assert_not_reached();
 				break;
@@ -264,6 +559,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				fprintf(f, "%05d ANY_IN\t\treg#%u in {%u values}\n",
+					id, arg1->value.numeric,
+					arg2->value.fvalue_set->fvalues->len);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -282,6 +583,11 @@ dfvm_dump(FILE *f, dfilter_t *df)
 						id, arg1->value.numeric);
 				break;
 
+			case IF_TRUE_RETURN:
+				fprintf(f, "%05d IF-TRUE-RETURN\t%u\n",
+						id, arg1->value.numeric);
+				break;
+
 			default:
 				g_assert_not_reached();
 				break;
@@ -369,6 +675,19 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 	return FALSE;
 }
 
+static gboolean
+any_in(dfilter_t *df, int reg, dfvm_fvalue_set_t *set)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (dfvm_fvalue_set_contains(set, (fvalue_t *)list->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 
 /* Free the list nodes w/o freeing the memory that each
  * list node points to. */
@@ -415,8 +734,10 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 
-gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+/* Runs the program.  If it is one that tries several filters in turn,
+ * *match is set to the index of the first one that matched. */
+static gboolean
+dfvm_run(dfilter_t *df, proto_tree *tree, int *match)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -527,6 +848,11 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_IN:
+				accum = any_in(df, arg1->value.numeric,
+						arg2->value.fvalue_set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -549,6 +875,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				}
 				break;
 
+			case IF_TRUE_RETURN:
+				if (accum) {
+					if (match) {
+						*match = arg1->value.numeric;
+					}
+					free_register_overhead(df);
+					return TRUE;
+				}
+				break;
+
 			case PUT_FVALUE:
 #if 0
 				/* These were handled in the constants initialization */
@@ -567,6 +903,21 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_run(df, tree, NULL);
+}
+
+int
+dfvm_apply_first_match(dfilter_t *df, proto_tree *tree)
+{
+	int		match = -1;
+
+	dfvm_run(df, tree, &match);
+	return match;
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -601,10 +952,12 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_IN:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
+			case IF_TRUE_RETURN:
 			default:
 				g_assert_not_reached();
 				break;
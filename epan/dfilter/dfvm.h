@@ -35,9 +35,14 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	FVALUE_SET
 } dfvm_value_type_t;
 
+/* A set of constants that an "in" test is checked against, hashed so that
+ * the test costs about the same however many constants there are. */
+typedef struct _dfvm_fvalue_set_t dfvm_fvalue_set_t;
+
 typedef struct {
 	dfvm_value_type_t	type;
 
@@ -47,6 +52,7 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		dfvm_fvalue_set_t	*fvalue_set;
 	} value;
 
 } dfvm_value_t;
@@ -56,6 +62,7 @@ typedef enum {
 
 	IF_TRUE_GOTO,
 	IF_FALSE_GOTO,
+	IF_TRUE_RETURN,
 	CHECK_EXISTS,
 	NOT,
 	RETURN,
@@ -70,6 +77,7 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_IN,
 	MK_RANGE,
     CALL_FUNCTION
 
@@ -93,12 +101,26 @@ dfvm_insn_free(dfvm_insn_t *insn);
 dfvm_value_t*
 dfvm_value_new(dfvm_value_type_t type);
 
+/* Can constants of this type be put in a dfvm_fvalue_set_t? */
+gboolean
+dfvm_fvalue_set_supported(ftenum_t ftype);
+
+dfvm_fvalue_set_t*
+dfvm_fvalue_set_new(void);
+
+/* Adds a constant to the set, which takes ownership of it. */
+void
+dfvm_fvalue_set_add(dfvm_fvalue_set_t *set, fvalue_t *fv);
+
 void
 dfvm_dump(FILE *f, dfilter_t *df);
 
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+int
+dfvm_apply_first_match(dfilter_t *df, proto_tree *tree);
+
 void
 dfvm_init_const(dfilter_t *df);
 
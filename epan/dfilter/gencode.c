@@ -289,6 +289,30 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+/* Can the set of an "in" test be looked up in a hash set rather than
+ * being compared item by item?  That needs all its items to be constants
+ * of the same type, and more than one of them. */
+static gboolean
+set_is_hashable(GSList *nodelist)
+{
+	stnode_t	*node;
+	ftenum_t	ftype = FT_NONE;
+
+	if (g_slist_length(nodelist) < 2)
+		return FALSE;
+
+	for (; nodelist; nodelist = g_slist_next(nodelist)) {
+		node = (stnode_t*)nodelist->data;
+		if (stnode_type_id(node) != STTYPE_FVALUE)
+			return FALSE;
+		if (ftype == FT_NONE)
+			ftype = fvalue_type_ftenum((fvalue_t*)stnode_data(node));
+		else if (fvalue_type_ftenum((fvalue_t*)stnode_data(node)) != ftype)
+			return FALSE;
+	}
+	return dfvm_fvalue_set_supported(ftype);
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
  * series of == tests, but without the redundant existence checks. */
 static void
@@ -305,8 +329,26 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 	/* Create code for the LHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 
-	/* Create code for the set on the RHS of the relation */
+	/* A set of constants is checked with a single hash lookup */
 	nodelist = (GSList*)stnode_data(st_arg2);
+	if (set_is_hashable(nodelist)) {
+		insn = dfvm_insn_new(ANY_IN);
+		val1 = dfvm_value_new(REGISTER);
+		val1->value.numeric = reg1;
+		val2 = dfvm_value_new(FVALUE_SET);
+		val2->value.fvalue_set = dfvm_fvalue_set_new();
+		for (; nodelist; nodelist = g_slist_next(nodelist)) {
+			node = (stnode_t*)nodelist->data;
+			dfvm_fvalue_set_add(val2->value.fvalue_set,
+			    (fvalue_t*)stnode_data(node));
+		}
+		insn->arg1 = val1;
+		insn->arg2 = val2;
+		dfw_append_insn(dfw, insn);
+		nodelist = NULL;
+	}
+
+	/* Otherwise create code for each item of the set on the RHS */
 	while (nodelist) {
 		node = (stnode_t*)nodelist->data;
 		reg2 = gen_entity(dfw, node, &jmp2);
@@ -521,19 +563,229 @@ gencode(dfwork_t *dfw, stnode_t *st_node)
 }
 
 
-void
-dfw_gencode(dfwork_t *dfw)
+/* Rough relative cost of evaluating a test, used to decide which side
+ * of an "and" or "or" to evaluate first. */
+static int
+entity_cost(stnode_t *st_arg)
 {
-	int		id, id1, length;
-	dfvm_insn_t	*insn, *insn1, *prev;
-	dfvm_value_t	*arg1;
+	switch (stnode_type_id(st_arg)) {
+		case STTYPE_FIELD:
+			return 2;
+		case STTYPE_RANGE:
+			return 3;
+		case STTYPE_FUNCTION:
+			return 5;
+		default:
+			return 0;
+	}
+}
+
+static int
+test_cost(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	int		cost;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_EXISTS:
+			return 1;
+		case TEST_OP_NOT:
+			return test_cost(st_arg1);
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			return test_cost(st_arg1) + test_cost(st_arg2);
+		case TEST_OP_IN:
+			return entity_cost(st_arg1) +
+				g_slist_length((GSList*)stnode_data(st_arg2));
+		default:
+			cost = entity_cost(st_arg1) + entity_cost(st_arg2);
+			if (st_op == TEST_OP_CONTAINS)
+				cost += 2;
+			else if (st_op == TEST_OP_MATCHES)
+				cost += 10;
+			return cost;
+	}
+}
+
+/* If the test is "field == constant" or "field in {...}" with only
+ * constants, return the field's first hfinfo of that name. */
+static header_field_info *
+eq_test_field(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	header_field_info *hfinfo;
+	GSList		*nodelist;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != TEST_OP_EQ && st_op != TEST_OP_IN)
+		return NULL;
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD)
+		return NULL;
+
+	if (st_op == TEST_OP_EQ) {
+		if (stnode_type_id(st_arg2) != STTYPE_FVALUE)
+			return NULL;
+	} else {
+		for (nodelist = (GSList*)stnode_data(st_arg2); nodelist; nodelist = g_slist_next(nodelist)) {
+			if (stnode_type_id((stnode_t*)nodelist->data) != STTYPE_FVALUE)
+				return NULL;
+		}
+	}
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	while (hfinfo->same_name_prev_id != -1)
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	return hfinfo;
+}
+
+/* Take the constants out of a "field == constant" or "field in {...}" test
+ * and free the test. */
+static GSList *
+steal_eq_constants(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	GSList		*nodelist;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op == TEST_OP_EQ) {
+		nodelist = g_slist_append(NULL, st_arg2);
+	} else {
+		nodelist = (GSList*)stnode_data(st_arg2);
+		stnode_free(st_arg2);
+	}
+	sttype_test_set2_args(st_node, st_arg1, NULL);
+	stnode_free(st_node);
+
+	return nodelist;
+}
+
+/* Rewrite the syntax tree into something cheaper to evaluate, and
+ * return the new top node:
+ *
+ *   - "f == a || f == b" becomes "f in {a b}", which loads f once and
+ *     checks it without the existence tests in between;
+ *   - "!!x" becomes "x";
+ *   - the cheaper operand of "and" and "or" is evaluated first, as the
+ *     tests have no side effects. */
+static stnode_t *
+optimize(stnode_t *st_node)
+{
+	test_op_t	st_op, st_inner_op;
+	stnode_t	*st_arg1, *st_arg2, *st_inner1, *st_inner2;
+	header_field_info *hfinfo1, *hfinfo2;
+	GSList		*nodelist;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return st_node;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_NOT:
+			st_arg1 = optimize(st_arg1);
+			sttype_test_set2_args(st_node, st_arg1, NULL);
+			sttype_test_get(st_arg1, &st_inner_op, &st_inner1, &st_inner2);
+			if (st_inner_op == TEST_OP_NOT) {
+				sttype_test_set2_args(st_arg1, NULL, NULL);
+				stnode_free(st_node);
+				return st_inner1;
+			}
+			break;
+
+		case TEST_OP_AND:
+		case TEST_OP_OR:
+			st_arg1 = optimize(st_arg1);
+			st_arg2 = optimize(st_arg2);
+
+			if (st_op == TEST_OP_OR) {
+				hfinfo1 = eq_test_field(st_arg1);
+				hfinfo2 = eq_test_field(st_arg2);
+				if (hfinfo1 != NULL && hfinfo1 == hfinfo2) {
+					/* Both sides compare the same field
+					 * with constants; merge them, keeping
+					 * the field from the first. */
+					sttype_test_get(st_arg1, &st_inner_op, &st_inner1, &st_inner2);
+					sttype_test_set2_args(st_arg1, NULL, st_inner2);
+					nodelist = steal_eq_constants(st_arg1);
+					nodelist = g_slist_concat(nodelist, steal_eq_constants(st_arg2));
+					sttype_test_set2(st_node, TEST_OP_IN, st_inner1,
+						stnode_new(STTYPE_SET, nodelist));
+					break;
+				}
+			}
+
+			if (test_cost(st_arg2) < test_cost(st_arg1))
+				sttype_test_set2_args(st_node, st_arg2, st_arg1);
+			else
+				sttype_test_set2_args(st_node, st_arg1, st_arg2);
+			break;
+
+		default:
+			break;
+	}
+
+	return st_node;
+}
 
+static void
+dfw_gencode_start(dfwork_t *dfw)
+{
 	dfw->insns = g_ptr_array_new();
 	dfw->consts = g_ptr_array_new();
 	dfw->loaded_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
 	dfw->interesting_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+static void
+dfw_gencode_finish(dfwork_t *dfw);
+
+void
+dfw_gencode(dfwork_t *dfw)
+{
+	dfw_gencode_start(dfw);
+	dfw->st_root = optimize(dfw->st_root);
 	gencode(dfw, dfw->st_root);
 	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	dfw_gencode_finish(dfw);
+}
+
+void
+dfw_gencode_first_match(dfwork_t *dfw, stnode_t **roots, guint num_roots)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1;
+	guint		i;
+
+	/* The filters share one set of registers, so a field used by
+	 * several of them is read from the tree only once. */
+	dfw_gencode_start(dfw);
+	for (i = 0; i < num_roots; i++) {
+		if (roots[i] == NULL)
+			continue;
+		roots[i] = optimize(roots[i]);
+		gencode(dfw, roots[i]);
+
+		insn = dfvm_insn_new(IF_TRUE_RETURN);
+		val1 = dfvm_value_new(INTEGER);
+		val1->value.numeric = i;
+		insn->arg1 = val1;
+		dfw_append_insn(dfw, insn);
+	}
+	dfw_append_insn(dfw, dfvm_insn_new(RETURN));
+	dfw_gencode_finish(dfw);
+}
+
+static void
+dfw_gencode_finish(dfwork_t *dfw)
+{
+	int		id, id1, length;
+	dfvm_insn_t	*insn, *insn1, *prev;
+	dfvm_value_t	*arg1;
 
 	/* fixup goto */
 	length = dfw->insns->len;
@@ -645,6 +897,132 @@ dfw_interesting_fields(dfwork_t *dfw, int *caller_num_fields)
 	return hki.fields;
 }
 
+/* Get the protocol that must be in the tree for an entity to be loaded,
+ * or -1 if there isn't one. */
+static int
+entity_protocol(stnode_t *st_arg)
+{
+	header_field_info *hfinfo;
+
+	if (stnode_type_id(st_arg) == STTYPE_RANGE)
+		st_arg = sttype_range_entity(st_arg);
+	if (stnode_type_id(st_arg) != STTYPE_FIELD)
+		return -1;
+
+	hfinfo = (header_field_info*)stnode_data(st_arg);
+	if (hfinfo->parent != -1) {
+		/* A field; fields with the same name can belong to
+		 * different protocols. */
+		int proto_id = hfinfo->parent;
+
+		while (hfinfo->same_name_prev_id != -1)
+			hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+		for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+			if (hfinfo->parent != proto_id)
+				return -1;
+		}
+		return proto_id;
+	}
+	return hfinfo->id;
+}
+
+static GArray *
+protocol_set_new(int proto_id)
+{
+	GArray *set = g_array_new(FALSE, FALSE, sizeof(int));
+
+	g_array_append_val(set, proto_id);
+	return set;
+}
+
+/* Returns a set of protocols at least one of which must be in the tree
+ * for the test to pass, or NULL if there's no such set. */
+static GArray *
+required_protocols(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	GArray		*set1, *set2;
+	int		proto_id;
+	guint		i, j;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return NULL;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+
+	switch (st_op) {
+		case TEST_OP_UNINITIALIZED:
+		case TEST_OP_NOT:
+			return NULL;
+
+		case TEST_OP_AND:
+			/* Either side will do; use the more selective one. */
+			set1 = required_protocols(st_arg1);
+			set2 = required_protocols(st_arg2);
+			if (set1 == NULL)
+				return set2;
+			if (set2 == NULL)
+				return set1;
+			if (set2->len < set1->len) {
+				g_array_free(set1, TRUE);
+				return set2;
+			}
+			g_array_free(set2, TRUE);
+			return set1;
+
+		case TEST_OP_OR:
+			/* We need one of the protocols from either side. */
+			set1 = required_protocols(st_arg1);
+			set2 = required_protocols(st_arg2);
+			if (set1 == NULL || set2 == NULL) {
+				if (set1)
+					g_array_free(set1, TRUE);
+				if (set2)
+					g_array_free(set2, TRUE);
+				return NULL;
+			}
+			for (i = 0; i < set2->len; i++) {
+				proto_id = g_array_index(set2, int, i);
+				for (j = 0; j < set1->len; j++) {
+					if (g_array_index(set1, int, j) == proto_id)
+						break;
+				}
+				if (j == set1->len)
+					g_array_append_val(set1, proto_id);
+			}
+			g_array_free(set2, TRUE);
+			return set1;
+
+		case TEST_OP_EXISTS:
+			proto_id = entity_protocol(st_arg1);
+			return proto_id == -1 ? NULL : protocol_set_new(proto_id);
+
+		default:
+			/* A relation fails if a field on either side isn't
+			 * in the tree. */
+			proto_id = entity_protocol(st_arg1);
+			if (proto_id == -1 && st_op != TEST_OP_IN)
+				proto_id = entity_protocol(st_arg2);
+			return proto_id == -1 ? NULL : protocol_set_new(proto_id);
+	}
+}
+
+int*
+dfw_required_protocols(dfwork_t *dfw, int *caller_num_protocols)
+{
+	GArray	*set;
+
+	set = required_protocols(dfw->st_root);
+	if (set == NULL) {
+		*caller_num_protocols = 0;
+		return NULL;
+	}
+
+	*caller_num_protocols = set->len;
+	return (int *)g_array_free(set, FALSE);
+}
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
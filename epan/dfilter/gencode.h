@@ -25,7 +25,15 @@
 void
 dfw_gencode(dfwork_t *dfw);
 
+/* Generates code that tries each syntax tree in turn and returns the index
+ * of the first that matches; NULL trees are skipped. */
+void
+dfw_gencode_first_match(dfwork_t *dfw, stnode_t **roots, guint num_roots);
+
 int*
 dfw_interesting_fields(dfwork_t *dfw, int *caller_num_fields);
 
+int*
+dfw_required_protocols(dfwork_t *dfw, int *caller_num_protocols);
+
 #endif
@@ -37,6 +37,7 @@
 #include <epan/to_str.h>
 #include <wiretap/wtap.h>
 #include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
 #include <epan/expert.h>
 #include <wsutil/md5.h>
 #include <wsutil/str_util.h>
@@ -694,6 +695,125 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 	return tvb_captured_length(tvb);
 }
 
+/*
+ * "Dissector Profile" statistics.  The counters are kept by the dissector
+ * call code in epan/packet.c; this just turns them on while the table is
+ * open and copies them into it after each frame.
+ */
+typedef enum
+{
+	PROFILE_PROTOCOL_COLUMN = 0,
+	PROFILE_CALLS_COLUMN,
+	PROFILE_ACCEPTED_COLUMN,
+	PROFILE_BYTES_COLUMN,
+	PROFILE_INCLUSIVE_COLUMN,
+	PROFILE_EXCLUSIVE_COLUMN,
+	PROFILE_WMEM_BYTES_COLUMN,
+	PROFILE_HEUR_TRIES_COLUMN,
+	PROFILE_HEUR_ACCEPTS_COLUMN
+} profile_stat_columns;
+
+static stat_tap_table_item profile_stat_fields[] = {
+	{TABLE_ITEM_STRING, TAP_ALIGN_LEFT, "Protocol", "%-16s"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Calls", "%u"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Accepted", "%u"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Bytes", "%u"},
+	{TABLE_ITEM_FLOAT, TAP_ALIGN_RIGHT, "Inclusive (ms)", "%.3f"},
+	{TABLE_ITEM_FLOAT, TAP_ALIGN_RIGHT, "Exclusive (ms)", "%.3f"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Wmem Bytes", "%u"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Heuristic Tries", "%u"},
+	{TABLE_ITEM_UINT, TAP_ALIGN_RIGHT, "Heuristic Accepts", "%u"}
+};
+
+static void
+profile_stat_init(stat_tap_table_ui* new_stat, new_stat_tap_gui_init_cb gui_callback, void* gui_data)
+{
+	int num_fields = sizeof(profile_stat_fields)/sizeof(stat_tap_table_item);
+	stat_tap_table* table = new_stat_tap_init_table("Dissector Profile", num_fields, 0, NULL, gui_callback, gui_data);
+
+	new_stat_tap_add_table(new_stat, table);
+
+	dissector_profiling_reset();
+	dissector_profiling_enable(TRUE);
+}
+
+static guint
+profile_stat_uint(guint64 value)
+{
+	return value > G_MAXUINT ? G_MAXUINT : (guint)value;
+}
+
+static gboolean
+profile_stat_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data _U_)
+{
+	new_stat_data_t* stat_data = (new_stat_data_t*)tapdata;
+	stat_tap_table* table = g_array_index(stat_data->stat_tap_data->tables, stat_tap_table*, 0);
+	stat_tap_table_item_type items[sizeof(profile_stat_fields)/sizeof(stat_tap_table_item)];
+	GPtrArray *profiles;
+	guint i;
+
+	memset(items, 0, sizeof(items));
+	items[PROFILE_PROTOCOL_COLUMN].type = TABLE_ITEM_STRING;
+	items[PROFILE_CALLS_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_ACCEPTED_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_BYTES_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_INCLUSIVE_COLUMN].type = TABLE_ITEM_FLOAT;
+	items[PROFILE_EXCLUSIVE_COLUMN].type = TABLE_ITEM_FLOAT;
+	items[PROFILE_WMEM_BYTES_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_HEUR_TRIES_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_HEUR_ACCEPTS_COLUMN].type = TABLE_ITEM_UINT;
+
+	/* The rows are kept in order of decreasing exclusive time. */
+	profiles = dissector_profile_get();
+	for (i = 0; i < profiles->len; i++) {
+		const dissector_profile_t *profile = (const dissector_profile_t *)g_ptr_array_index(profiles, i);
+
+		items[PROFILE_PROTOCOL_COLUMN].value.string_value = proto_get_protocol_short_name(find_protocol_by_id(profile->proto_id));
+		items[PROFILE_CALLS_COLUMN].value.uint_value = profile_stat_uint(profile->calls);
+		items[PROFILE_ACCEPTED_COLUMN].value.uint_value = profile_stat_uint(profile->accepted);
+		items[PROFILE_BYTES_COLUMN].value.uint_value = profile_stat_uint(profile->bytes);
+		items[PROFILE_INCLUSIVE_COLUMN].value.float_value = profile->time_inclusive / 1000.0;
+		items[PROFILE_EXCLUSIVE_COLUMN].value.float_value = profile->time_exclusive / 1000.0;
+		items[PROFILE_WMEM_BYTES_COLUMN].value.uint_value = profile_stat_uint(profile->wmem_bytes);
+		items[PROFILE_HEUR_TRIES_COLUMN].value.uint_value = profile_stat_uint(profile->heur_tries);
+		items[PROFILE_HEUR_ACCEPTS_COLUMN].value.uint_value = profile_stat_uint(profile->heur_accepts);
+
+		new_stat_tap_init_table_row(table, i, sizeof(profile_stat_fields)/sizeof(stat_tap_table_item), items);
+	}
+	g_ptr_array_free(profiles, TRUE);
+
+	return TRUE;
+}
+
+static void
+profile_stat_reset(stat_tap_table* table)
+{
+	guint element, field;
+	stat_tap_table_item_type* item_data;
+
+	dissector_profiling_reset();
+
+	for (element = 0; element < table->num_elements; element++)
+	{
+		for (field = PROFILE_CALLS_COLUMN; field < table->num_fields; field++)
+		{
+			item_data = new_stat_tap_get_field_data(table, element, field);
+			if (item_data->type == TABLE_ITEM_FLOAT)
+				item_data->value.float_value = 0.0;
+			else
+				item_data->value.uint_value = 0;
+			new_stat_tap_set_field_data(table, element, field, item_data);
+		}
+	}
+}
+
+static void
+profile_stat_free_table(stat_tap_table* table _U_)
+{
+	/* This table no longer needs the counters. */
+	dissector_profiling_enable(FALSE);
+}
+
 void
 proto_register_frame(void)
 {
@@ -887,6 +1007,27 @@ proto_register_frame(void)
 		{ &ei_incomplete, { "frame.incomplete", PI_UNDECODED, PI_NOTE, "Incomplete dissector", EXPFILL }}
 	};
 
+	static tap_param profile_stat_params[] = {
+		{ PARAM_FILTER, "filter", "Filter", NULL, TRUE }
+	};
+
+	static stat_tap_table_ui profile_stat_table = {
+		REGISTER_STAT_GROUP_GENERIC,
+		"Dissector Profile",
+		"frame",
+		"dissector,profile",
+		profile_stat_init,
+		profile_stat_packet,
+		profile_stat_reset,
+		NULL,
+		NULL,
+		sizeof(profile_stat_fields)/sizeof(stat_tap_table_item), profile_stat_fields,
+		sizeof(profile_stat_params)/sizeof(tap_param), profile_stat_params,
+		NULL,
+		0,
+		profile_stat_free_table
+	};
+
 	module_t *frame_module;
 	expert_module_t* expert_frame;
 
@@ -950,6 +1091,7 @@ proto_register_frame(void)
 	    &disable_packet_size_limited_in_summary);
 
 	frame_tap=register_tap("frame");
+	register_stat_tap_table_ui(&profile_stat_table);
 }
 
 void
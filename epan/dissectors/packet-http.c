@@ -3699,7 +3699,7 @@ proto_register_http(void)
 	http_follow_tap = register_tap("http_follow"); /* HTTP Follow tap */
 
 	register_follow_stream(proto_http, "http_follow", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
-							tcp_port_to_display, follow_tvb_tap_listener);
+							tcp_port_to_display, follow_tvb_tap_listener, tcp_follow_stream_frames);
 }
 
 /*
@@ -4187,7 +4187,7 @@ proto_register_ssl(void)
         "ssl", ssl_tap);
 
     register_follow_stream(proto_ssl, "ssl", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
-                            tcp_port_to_display, ssl_follow_tap_listener);
+                            tcp_port_to_display, ssl_follow_tap_listener, tcp_follow_stream_frames);
 }
 
 /* If this dissector uses sub-dissector registration add a registration
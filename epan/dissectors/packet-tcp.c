@@ -563,6 +563,7 @@ static dissector_handle_t data_handle;
 static dissector_handle_t sport_handle;
 static guint32 tcp_stream_count;
 static guint32 mptcp_stream_count;
+static follow_stream_index_t *tcp_stream_index;
 
 
 
@@ -790,6 +791,11 @@ gchar* tcp_follow_index_filter(int stream)
     return g_strdup_printf("tcp.stream eq %d", stream);
 }
 
+guint32 tcp_follow_stream_frames(guint32 stream, const guint32 **frames)
+{
+    return follow_stream_index_get(tcp_stream_index, stream, frames);
+}
+
 gchar* tcp_follow_address_filter(address* src_addr, address* dst_addr, int src_port, int dst_port)
 {
     const gchar  *ip_version = src_addr->type == AT_IPv6 ? "v6" : "";
@@ -5445,6 +5451,9 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
          * to tap listeners.
          */
         tcph->th_stream = tcpd->stream;
+
+        if (!PINFO_FD_VISITED(pinfo))
+            follow_stream_index_add(tcp_stream_index, tcpd->stream, pinfo->num);
     }
 
     /* Do we need to calculate timestamps relative to the tcp-stream? */
@@ -6085,6 +6094,7 @@ static void
 tcp_init(void)
 {
     tcp_stream_count = 0;
+    tcp_stream_index = follow_stream_index_new();
     reassembly_table_init(&tcp_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
 
@@ -7172,7 +7182,7 @@ proto_register_tcp(void)
 
     register_conversation_table(proto_mptcp, FALSE, mptcpip_conversation_packet, tcpip_hostlist_packet);
     register_follow_stream(proto_tcp, "tcp_follow", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
-                            tcp_port_to_display, follow_tvb_tap_listener);
+                            tcp_port_to_display, follow_tvb_tap_listener, tcp_follow_stream_frames);
 }
 
 void
@@ -508,6 +508,7 @@ WS_DLL_PUBLIC guint32 get_mptcp_stream_count(void);
 extern gchar* tcp_follow_conv_filter(packet_info* pinfo, int* stream);
 extern gchar* tcp_follow_index_filter(int stream);
 extern gchar* tcp_follow_address_filter(address* src_addr, address* dst_addr, int src_port, int dst_port);
+extern guint32 tcp_follow_stream_frames(guint32 stream, const guint32 **frames);
 
 #ifdef __cplusplus
 }
@@ -172,6 +172,7 @@ static gboolean udplite_check_checksum = FALSE;
 static dissector_table_t udp_dissector_table;
 static heur_dissector_list_t heur_subdissector_list;
 static guint32 udp_stream_count;
+static follow_stream_index_t *udp_stream_index;
 
 /* Determine if there is a sub-dissector and call it.  This has been */
 /* separated into a stand alone routine so other protocol dissectors */
@@ -429,6 +430,11 @@ static gchar* udp_follow_index_filter(int stream)
     return g_strdup_printf("udp.stream eq %d", stream);
 }
 
+static guint32 udp_follow_stream_frames(guint32 stream, const guint32 **frames)
+{
+    return follow_stream_index_get(udp_stream_index, stream, frames);
+}
+
 static gchar* udp_follow_address_filter(address* src_addr, address* dst_addr, int src_port, int dst_port)
 {
     const gchar  *ip_version = src_addr->type == AT_IPv6 ? "v6" : "";
@@ -1030,6 +1036,9 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, guint32 ip_proto)
     * to tap listeners.
     */
     udph->uh_stream = udpd->stream;
+
+    if (!PINFO_FD_VISITED(pinfo))
+      follow_stream_index_add(udp_stream_index, udpd->stream, pinfo->num);
   }
 
   tap_queue_packet(udp_tap, pinfo, udph);
@@ -1098,6 +1107,7 @@ static void
 udp_init(void)
 {
   udp_stream_count = 0;
+  udp_stream_index = follow_stream_index_new();
 }
 
 void
@@ -1215,7 +1225,7 @@ proto_register_udp(void)
   register_conversation_table(proto_udp, FALSE, udpip_conversation_packet, udpip_hostlist_packet);
   register_conversation_filter("udp", "UDP", udp_filter_valid, udp_build_filter);
   register_follow_stream(proto_udp, "udp_follow", udp_follow_conv_filter, udp_follow_index_filter, udp_follow_address_filter,
-                         udp_port_to_display, follow_tvb_tap_listener);
+                         udp_port_to_display, follow_tvb_tap_listener, udp_follow_stream_frames);
 
   register_init_routine(udp_init);
 
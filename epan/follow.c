@@ -31,6 +31,7 @@
 #include <epan/packet.h>
 #include "follow.h"
 #include <epan/tap.h>
+#include <epan/wmem/wmem.h>
 
 struct register_follow {
     int proto_id;              /* protocol id (0-indexed) */
@@ -40,6 +41,11 @@ struct register_follow {
     follow_address_filter_func address_filter; /* generate address filter to follow */
     follow_port_to_display_func port_to_display; /* port to name resolution for follow type */
     follow_tap_func tap_handler; /* tap listener handler */
+    follow_stream_frames_func stream_frames; /* frames in a stream, may be NULL */
+};
+
+struct _follow_stream_index {
+    wmem_array_t *streams;     /* wmem_array_t* of guint32 frame numbers, indexed by stream */
 };
 
 static GSList *registered_followers = NULL;
@@ -55,7 +61,8 @@ insert_sorted_by_name(gconstpointer aparam, gconstpointer bparam)
 
 void register_follow_stream(const int proto_id, const char* tap_listener,
                             follow_conv_filter_func conv_filter, follow_index_filter_func index_filter, follow_address_filter_func address_filter,
-                            follow_port_to_display_func port_to_display, follow_tap_func tap_handler)
+                            follow_port_to_display_func port_to_display, follow_tap_func tap_handler,
+                            follow_stream_frames_func stream_frames)
 {
   register_follow_t *follower;
   DISSECTOR_ASSERT(tap_listener);
@@ -74,6 +81,7 @@ void register_follow_stream(const int proto_id, const char* tap_listener,
   follower->address_filter = address_filter;
   follower->port_to_display = port_to_display;
   follower->tap_handler    = tap_handler;
+  follower->stream_frames  = stream_frames;
 
   registered_followers = g_slist_insert_sorted(registered_followers, follower, insert_sorted_by_name);
 }
@@ -119,6 +127,58 @@ follow_tap_func get_follow_tap_handler(register_follow_t* follower)
   return follower->tap_handler;
 }
 
+follow_stream_frames_func get_follow_stream_frames_func(register_follow_t* follower)
+{
+  return follower->stream_frames;
+}
+
+follow_stream_index_t* follow_stream_index_new(void)
+{
+  follow_stream_index_t *index = wmem_new(wmem_file_scope(), follow_stream_index_t);
+
+  index->streams = wmem_array_new(wmem_file_scope(), sizeof(wmem_array_t *));
+  return index;
+}
+
+void follow_stream_index_add(follow_stream_index_t* index, guint32 stream, guint32 frame_num)
+{
+  wmem_array_t *frames = NULL;
+  guint32 count;
+
+  /* Streams are numbered densely, so this normally grows by one. */
+  while (wmem_array_get_count(index->streams) <= stream)
+    wmem_array_append_one(index->streams, frames);
+
+  frames = *(wmem_array_t **)wmem_array_index(index->streams, stream);
+  if (frames == NULL) {
+    frames = wmem_array_new(wmem_file_scope(), sizeof(guint32));
+    *(wmem_array_t **)wmem_array_index(index->streams, stream) = frames;
+  }
+
+  /* A frame can carry more than one PDU of the same stream. */
+  count = wmem_array_get_count(frames);
+  if (count != 0 && *(guint32 *)wmem_array_index(frames, count - 1) == frame_num)
+    return;
+
+  wmem_array_append_one(frames, frame_num);
+}
+
+guint32 follow_stream_index_get(follow_stream_index_t* index, guint32 stream, const guint32 **frames)
+{
+  wmem_array_t *stream_frames;
+
+  *frames = NULL;
+  if (index == NULL || stream >= wmem_array_get_count(index->streams))
+    return 0;
+
+  stream_frames = *(wmem_array_t **)wmem_array_index(index->streams, stream);
+  if (stream_frames == NULL)
+    return 0;
+
+  *frames = (const guint32 *)wmem_array_get_raw(stream_frames);
+  return wmem_array_get_count(stream_frames);
+}
+
 
 register_follow_t* get_follow_by_name(const char* proto_short_name)
 {
@@ -111,11 +111,13 @@ typedef gchar* (*follow_index_filter_func)(int stream);
 typedef gchar* (*follow_address_filter_func)(address* src_addr, address* dst_addr, int src_port, int dst_port);
 typedef gchar* (*follow_port_to_display_func)(wmem_allocator_t *allocator, guint port);
 typedef gboolean (*follow_tap_func)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data);
+typedef guint32 (*follow_stream_frames_func)(guint32 stream, const guint32 **frames);
 
 WS_DLL_PUBLIC
 void register_follow_stream(const int proto_id, const char* tap_listener,
                             follow_conv_filter_func conv_filter, follow_index_filter_func index_filter, follow_address_filter_func address_filter,
-                            follow_port_to_display_func port_to_display, follow_tap_func tap_handler);
+                            follow_port_to_display_func port_to_display, follow_tap_func tap_handler,
+                            follow_stream_frames_func stream_frames);
 
 /** Get protocol ID from registered follower
  *
@@ -173,6 +175,45 @@ WS_DLL_PUBLIC follow_port_to_display_func get_follow_port_to_display(register_fo
  */
 WS_DLL_PUBLIC follow_tap_func get_follow_tap_handler(register_follow_t* follower);
 
+/** Provide function that looks up the frames belonging to a stream.
+ *
+ * @param follower [in] Registered follower
+ * @return A stream frames function handler, or NULL if the follower
+ * doesn't keep a stream index
+ */
+WS_DLL_PUBLIC follow_stream_frames_func get_follow_stream_frames_func(register_follow_t* follower);
+
+/** Index from stream number to the frames in that stream, built by a
+ * dissector while the capture file is first read so that following a
+ * stream only has to dissect the frames that are in it.
+ */
+typedef struct _follow_stream_index follow_stream_index_t;
+
+/** Create an empty stream index. It is allocated in file scope, so
+ * it should be created from the dissector's init routine.
+ *
+ * @return A new stream index
+ */
+WS_DLL_PUBLIC follow_stream_index_t* follow_stream_index_new(void);
+
+/** Record that a frame belongs to a stream. Frames must be added in
+ * increasing order; adding the last frame of the stream again is a no-op.
+ *
+ * @param index [in] Stream index
+ * @param stream [in] Stream number
+ * @param frame_num [in] Frame number
+ */
+WS_DLL_PUBLIC void follow_stream_index_add(follow_stream_index_t* index, guint32 stream, guint32 frame_num);
+
+/** Get the frames that belong to a stream.
+ *
+ * @param index [in] Stream index
+ * @param stream [in] Stream number
+ * @param frames [out] Sorted array of frame numbers, valid until the file is closed
+ * @return Number of frames in the stream, 0 if the stream is unknown
+ */
+WS_DLL_PUBLIC guint32 follow_stream_index_get(follow_stream_index_t* index, guint32 stream, const guint32 **frames);
+
 
 /** Tap function handler when dissector's tap provides follow data as a tvb.
  * Used by TCP, UDP and HTTP followers
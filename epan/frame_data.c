@@ -188,6 +188,7 @@ frame_data_init(frame_data *fdata, guint32 num,
   fdata->flags.has_user_comment = 0;
   fdata->flags.need_colorize = 0;
   fdata->tsprec = (gint16)phdr->pkt_tsprec;
+  fdata->layers_id = 0;
   fdata->color_filter = NULL;
   fdata->abs_ts = phdr->ts;
   fdata->shift_offset.secs = 0;
@@ -251,6 +252,7 @@ frame_data_reset(frame_data *fdata)
 {
   fdata->flags.visited = 0;
   fdata->subnum = 0;
+  fdata->layers_id = 0;
 
   if (fdata->pfd) {
     g_slist_free(fdata->pfd);
@@ -84,6 +84,7 @@ typedef struct _frame_data {
     unsigned int need_colorize  : 1; /**< 1 = need to (re-)calculate packet color */
   } flags;
   gint16       tsprec;       /**< Time stamp precision */
+  guint32      layers_id;    /**< Protocols found when last dissected with a tree (0 if unknown) */
 
   const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
 
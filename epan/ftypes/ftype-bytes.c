@@ -673,11 +673,11 @@ static gboolean
 cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 {
 	GByteArray *a = fv_a->value.bytes;
-	GRegex *regex = fv_b->value.re;
+	GRegex *regex = fv_b->value.regex.re;
 
 	/* fv_b is always a FT_PCRE, otherwise the dfilter semcheck() would have
 	 * warned us. For the same reason (and because we're using g_malloc()),
-	 * fv_b->value.re is not NULL.
+	 * fv_b->value.regex.re is not NULL.
 	 */
 	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
 		return FALSE;
@@ -709,6 +709,9 @@ cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 	 *
 	 * So we don't use G_REGEX_RAW for now.
 	 */
+	if (!fvalue_regex_may_match(fv_b, a->data, a->len)) {
+		return FALSE;
+	}
 	return g_regex_match_full(
 		regex,			/* Compiled PCRE */
 		(char *)a->data,	/* The data to check for the pattern... */
@@ -30,19 +30,195 @@
 #include <glib.h>
 #include <string.h>
 
+#include <wsutil/ws_memmem.h>
+
 static void
 gregex_fvalue_new(fvalue_t *fv)
 {
-    fv->value.re = NULL;
+    fv->value.regex.re = NULL;
+    fv->value.regex.literal = NULL;
 }
 
 static void
 gregex_fvalue_free(fvalue_t *fv)
 {
-    if (fv->value.re) {
-        g_regex_unref(fv->value.re);
-        fv->value.re = NULL;
+    if (fv->value.regex.re) {
+        g_regex_unref(fv->value.regex.re);
+        fv->value.regex.re = NULL;
     }
+    g_free(fv->value.regex.literal);
+    fv->value.regex.literal = NULL;
+}
+
+/* Escapes that match a single character that is not a literal, and
+ * that are not followed by anything belonging to them. */
+#define SIMPLE_ESCAPES "dDwWsSbBAzZGhHvVRXnrtfe"
+
+/* Remove the last character, which may be a multi-byte UTF-8 one, from
+ * a run of literal characters. */
+static void
+literal_run_drop_last(GString *run)
+{
+    while (run->len > 0 && ((guchar)run->str[run->len - 1] & 0xC0) == 0x80)
+        g_string_truncate(run, run->len - 1);
+    if (run->len > 0)
+        g_string_truncate(run, run->len - 1);
+}
+
+static void
+literal_run_end(GString *run, GString *best)
+{
+    if (run->len > best->len)
+        g_string_assign(best, run->str);
+    g_string_truncate(run, 0);
+}
+
+/* Find the longest string of literal characters that every match of the
+ * pattern must contain, so that data without it can be rejected by a
+ * substring search before running the regular expression.  This only
+ * understands a simple subset of the syntax and gives up (returning
+ * NULL) on anything else, such as alternation at the top level, inline
+ * options or most escapes. */
+static gchar *
+regex_required_literal(const gchar *pattern)
+{
+    GString     *run = g_string_new("");
+    GString     *best = g_string_new("");
+    const gchar *p = pattern;
+    int         depth = 0;
+    gboolean    literal;
+
+    while (*p) {
+        literal = FALSE;
+        switch (*p) {
+        case '\\':
+            if (p[1] == '\0')
+                goto give_up;
+            if (g_ascii_isalnum(p[1])) {
+                if (!strchr(SIMPLE_ESCAPES, p[1]))
+                    goto give_up;
+                literal_run_end(run, best);
+            } else if (depth == 0) {
+                g_string_append_c(run, p[1]);
+                literal = TRUE;
+            }
+            p += 2;
+            break;
+
+        case '(':
+            if (p[1] == '?')
+                goto give_up;
+            literal_run_end(run, best);
+            depth++;
+            p++;
+            break;
+
+        case ')':
+            literal_run_end(run, best);
+            depth--;
+            p++;
+            break;
+
+        case '|':
+            if (depth == 0)
+                goto give_up;
+            p++;
+            break;
+
+        case '[':
+            literal_run_end(run, best);
+            p++;
+            if (*p == '^')
+                p++;
+            if (*p == ']')
+                p++;
+            while (*p != ']') {
+                if (*p == '\0')
+                    goto give_up;
+                if (p[0] == '\\' && p[1] != '\0') {
+                    p += 2;
+                } else if (p[0] == '[' && p[1] == ':') {
+                    p = strstr(p, ":]");
+                    if (p == NULL)
+                        goto give_up;
+                    p += 2;
+                } else {
+                    p++;
+                }
+            }
+            p++;
+            break;
+
+        case '{':
+            /* Only the end of a quantifier is wanted here; the character
+             * it applies to was already dropped below. */
+            literal_run_end(run, best);
+            p = strchr(p, '}');
+            if (p == NULL)
+                goto give_up;
+            p++;
+            break;
+
+        case '.':
+        case '^':
+        case '$':
+        case '*':
+        case '+':
+        case '?':
+            literal_run_end(run, best);
+            p++;
+            break;
+
+        default:
+            if (depth == 0) {
+                g_string_append_c(run, *p);
+                literal = TRUE;
+            }
+            p++;
+            /* Take the rest of a multi-byte character with it */
+            while (((guchar)*p & 0xC0) == 0x80) {
+                if (depth == 0)
+                    g_string_append_c(run, *p);
+                p++;
+            }
+            break;
+        }
+
+        if (literal) {
+            /* A character that may be repeated zero times isn't required;
+             * one that is repeated at least once is, but ends the run. */
+            if (*p == '*' || *p == '?' || *p == '{') {
+                literal_run_drop_last(run);
+                literal_run_end(run, best);
+            } else if (*p == '+') {
+                literal_run_end(run, best);
+            }
+        }
+    }
+    literal_run_end(run, best);
+
+    g_string_free(run, TRUE);
+    if (best->len == 0) {
+        g_string_free(best, TRUE);
+        return NULL;
+    }
+    return g_string_free(best, FALSE);
+
+give_up:
+    g_string_free(run, TRUE);
+    g_string_free(best, TRUE);
+    return NULL;
+}
+
+gboolean
+fvalue_regex_may_match(const fvalue_t *fv, const guint8 *data, gsize len)
+{
+    const gchar *literal = fv->value.regex.literal;
+
+    if (literal == NULL)
+        return TRUE;
+
+    return ws_memmem(data, len, (const guint8 *)literal, strlen(literal)) != NULL;
 }
 
 /* Determines whether pattern needs to match raw byte sequences */
@@ -86,7 +262,7 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
     /* Free up the old value, if we have one */
     gregex_fvalue_free(fv);
 
-    fv->value.re = g_regex_new(
+    fv->value.regex.re = g_regex_new(
             pattern,            /* pattern */
             cflags,             /* Compile options */
             (GRegexMatchFlags)0,                  /* Match options */
@@ -98,11 +274,11 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
             *err_msg = g_strdup(regex_error->message);
         }
         g_error_free(regex_error);
-        if (fv->value.re) {
-            g_regex_unref(fv->value.re);
-        }
+        gregex_fvalue_free(fv);
         return FALSE;
     }
+
+    fv->value.regex.literal = regex_required_literal(pattern);
     return TRUE;
 }
 
@@ -121,14 +297,14 @@ static int
 gregex_repr_len(fvalue_t *fv, ftrepr_t rtype, int field_display _U_)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    return (int)strlen(g_regex_get_pattern(fv->value.re));
+    return (int)strlen(g_regex_get_pattern(fv->value.regex.re));
 }
 
 static void
 gregex_to_repr(fvalue_t *fv, ftrepr_t rtype, int field_display _U_, char *buf, unsigned int size)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    g_strlcpy(buf, g_regex_get_pattern(fv->value.re), size);
+    g_strlcpy(buf, g_regex_get_pattern(fv->value.regex.re), size);
 }
 
 /* BEHOLD - value contains the string representation of the regular expression,
@@ -145,7 +321,7 @@ gregex_fvalue_set(fvalue_t *fv, const char *value)
 static gpointer
 gregex_fvalue_get(fvalue_t *fv)
 {
-    return fv->value.re;
+    return fv->value.regex.re;
 }
 
 void
@@ -399,14 +399,14 @@ static gboolean
 cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 {
 	const protocol_value_t *a = (const protocol_value_t *)&fv_a->value.protocol;
-	GRegex *regex = fv_b->value.re;
+	GRegex *regex = fv_b->value.regex.re;
 	volatile gboolean rc = FALSE;
 	const char *data = NULL; /* tvb data */
 	guint32 tvb_len; /* tvb length */
 
 	/* fv_b is always a FT_PCRE, otherwise the dfilter semcheck() would have
 	 * warned us. For the same reason (and because we're using g_malloc()),
-	 * fv_b->value.re is not NULL.
+	 * fv_b->value.regex.re is not NULL.
 	 */
 	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
 		return FALSE;
@@ -418,15 +418,17 @@ cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 		if (a->tvb != NULL) {
 			tvb_len = tvb_captured_length(a->tvb);
 			data = (const char *)tvb_get_ptr(a->tvb, 0, tvb_len);
-			rc = g_regex_match_full(
-				regex,		/* Compiled PCRE */
-				data,		/* The data to check for the pattern... */
-				tvb_len,	/* ... and its length */
-				0,		/* Start offset within data */
-				(GRegexMatchFlags)0,		/* GRegexMatchFlags */
-				NULL,		/* We are not interested in the match information */
-				NULL		/* We don't want error information */
-				);
+			if (fvalue_regex_may_match(fv_b, (const guint8 *)data, tvb_len)) {
+				rc = g_regex_match_full(
+					regex,		/* Compiled PCRE */
+					data,		/* The data to check for the pattern... */
+					tvb_len,	/* ... and its length */
+					0,		/* Start offset within data */
+					(GRegexMatchFlags)0,		/* GRegexMatchFlags */
+					NULL,		/* We are not interested in the match information */
+					NULL		/* We don't want error information */
+					);
+			}
 			/* NOTE - DO NOT g_free(data) */
 		} else {
 			rc = g_regex_match_full(
@@ -201,11 +201,12 @@ static gboolean
 cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 {
 	char *str = fv_a->value.string;
-	GRegex *regex = fv_b->value.re;
+	GRegex *regex = fv_b->value.regex.re;
+	size_t len;
 
 	/* fv_b is always a FT_PCRE, otherwise the dfilter semcheck() would have
 	 * warned us. For the same reason (and because we're using g_malloc()),
-	 * fv_b->value.re is not NULL.
+	 * fv_b->value.regex.re is not NULL.
 	 */
 	if (strcmp(fv_b->ftype->name, "FT_PCRE") != 0) {
 		return FALSE;
@@ -213,10 +214,14 @@ cmp_matches(const fvalue_t *fv_a, const fvalue_t *fv_b)
 	if (! regex) {
 		return FALSE;
 	}
+	len = strlen(str);
+	if (!fvalue_regex_may_match(fv_b, (const guint8 *)str, len)) {
+		return FALSE;
+	}
 	return g_regex_match_full(
 			regex,		/* Compiled PCRE */
 			str,		/* The data to check for the pattern... */
-			(int)strlen(str),	/* ... and its length */
+			(int)len,	/* ... and its length */
 			0,		/* Start offset within data */
 			(GRegexMatchFlags)0,		/* GRegexMatchFlags */
 			NULL,		/* We are not interested in the match information */
@@ -46,6 +46,10 @@ void ftype_register_time(void);
 void ftype_register_tvbuff(void);
 void ftype_register_pcre(void);
 
+/* Can the FT_PCRE fvalue possibly match this data?  FALSE if the data
+ * lacks a string that every match of the regular expression contains. */
+gboolean fvalue_regex_may_match(const fvalue_t *fv, const guint8 *data, gsize len);
+
 typedef void (*FvalueNewFunc)(fvalue_t*);
 typedef void (*FvalueFreeFunc)(fvalue_t*);
 
@@ -222,7 +222,11 @@ typedef struct _fvalue_t {
 		e_guid_t		guid;
 		nstime_t		time;
         protocol_value_t protocol;
-		GRegex			*re;
+		struct {
+			GRegex		*re;
+			/* A string every match contains, or NULL */
+			gchar		*literal;
+		} regex;
 		guint16			sfloat_ieee_11073;
 		guint32			float_ieee_11073;
 	} value;
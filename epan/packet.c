@@ -44,6 +44,8 @@
 #include "wmem/wmem.h"
 
 #include <epan/exceptions.h>
+#include <epan/conversation.h>
+#include <epan/prefs.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
 #include <epan/expert.h>
@@ -90,9 +92,17 @@ struct data_source {
  *
  * "protocol" is the protocol associated with the dissector table. Used
  * for determining dependencies.
+ *
+ * "uint_array", for FT_UINT8 and FT_UINT16 tables, is the contents of
+ * "hash_table" indexed directly by value, so that the lookups done for
+ * every packet don't have to hash.  It's built the first time a packet
+ * is looked up in the table, and then kept up to date as entries are
+ * added and removed; "uint_array_size" is the number of entries in it.
  */
 struct dissector_table {
 	GHashTable	*hash_table;
+	dtbl_entry_t	**uint_array;
+	guint32		uint_array_size;
 	GSList		*dissector_handles;
 	const char	*ui_name;
 	ftenum_t	type;
@@ -119,6 +129,28 @@ struct depend_dissector_list {
 /* Maps char *dissector_name to depend_dissector_list_t */
 static GHashTable *depend_dissector_lists = NULL;
 
+/*
+ * Dissector profiling.  It's on while dissector_profiling, the number of
+ * users that have turned it on and not yet off, is non-zero.
+ * profile_child_time accumulates the inclusive time of the dissectors
+ * called from the one currently running, so that its own exclusive time
+ * can be worked out when it returns.
+ */
+static guint       dissector_profiling = 0;
+static GHashTable *dissector_profiles = NULL;
+static guint64     profile_child_time = 0;
+
+/*
+ * Demand-driven dissection.  demanded_protocols maps the ID of each
+ * demanded protocol to the demand_generation of the last packet that
+ * reached it; demand_generation goes up with every packet, and
+ * demand_seen counts the demanded protocols the current packet has
+ * reached so far.
+ */
+static GHashTable *demanded_protocols = NULL;
+static guint       demand_generation = 0;
+static guint       demand_seen = 0;
+
 static void
 destroy_depend_dissector_list(void *data)
 {
@@ -134,20 +166,80 @@ destroy_depend_dissector_list(void *data)
  * A heuristics dissector list.
  */
 struct heur_dissector_list {
+	const char	*name;
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	guint		active;		/* dissector_try_heuristic() calls in progress */
+	gboolean	reordered;	/* not in registration order */
+	heur_dissector_list_stats_t stats;
 };
 
+/*
+ * A heuristic dissector table entry, with what we keep about it for
+ * ordering the list.  Entries are always allocated as these.
+ */
+typedef struct heur_dtbl_entry_priv {
+	heur_dtbl_entry_t	entry;	/* must be first */
+	guint			registration_order;
+	guint			hits;
+} heur_dtbl_entry_priv_t;
+
+static guint heur_registration_count = 0;
+
+/*
+ * What we remember about the heuristic dissectors in a heuristic list
+ * for a conversation: which one last accepted a packet, with
+ * heur_conversation_memo set, and how many packets in a row each of the
+ * others has rejected, with heur_skip_rejecting set.  They're found in
+ * heur_conversation_memos by conversation, one per list the conversation
+ * has gone through; they're forgotten if a heuristic dissector is
+ * removed, as they may refer to it.
+ */
+typedef struct heur_conv_memo {
+	struct heur_conv_memo	*next;
+	heur_dissector_list_t	list;
+	heur_dtbl_entry_t	*accepted;
+	wmem_map_t		*rejects;
+	guint			generation;
+} heur_conv_memo_t;
+
+static wmem_map_t *heur_conversation_memos = NULL;
+static guint heur_memo_generation = 0;
+
+/* Packets in a row a heuristic dissector has to reject in a conversation
+   before it's no longer tried on it, with heur_skip_rejecting set */
+#define HEUR_REJECT_LIMIT	16
+
+/* Heuristic list lookups between reorderings, with heur_reorder set */
+#define HEUR_REORDER_INTERVAL	1024
+
 static GHashTable *heur_dissector_lists = NULL;
 
 /* Name hashtables for fast detection of duplicate names */
 static GHashTable* heuristic_short_names  = NULL;
 
+/*
+ * Protocols that have a dissector handle or a heuristic dissector, and so
+ * are normally added to pinfo->layers when their items are added to the
+ * tree, and the subset of those that have been called without being added
+ * to the layers or have had items added to a tree without being in its
+ * layers.
+ */
+static GHashTable *layered_protocols = NULL;
+static GHashTable *unlayered_protocols = NULL;
+
+/*
+ * The distinct sets of protocols seen in frames dissected with a tree.
+ * frame_data.layers_id is an index into layer_sets plus one.
+ */
+static GPtrArray  *layer_sets = NULL;     /* GArray of sorted protocol ids */
+static GHashTable *layer_set_ids = NULL;  /* maps "id,id,..." to index plus one */
+
 static void
 destroy_heuristic_dissector_entry(gpointer data, gpointer user_data _U_)
 {
 	g_free(((heur_dtbl_entry_t*)data)->list_name);
-	g_slice_free(heur_dtbl_entry_t, data);
+	g_slice_free(heur_dtbl_entry_priv_t, data);
 }
 
 static void
@@ -167,6 +259,7 @@ destroy_dissector_table(void *data)
 	struct dissector_table *table = (struct dissector_table *)data;
 
 	g_hash_table_destroy(table->hash_table);
+	g_free(table->uint_array);
 	g_slist_free(table->dissector_handles);
 	g_slice_free(struct dissector_table, data);
 }
@@ -187,6 +280,9 @@ packet_init(void)
 			NULL, destroy_heuristic_dissector_list);
 
 	heuristic_short_names  = g_hash_table_new(wrs_str_hash, g_str_equal);
+
+	layered_protocols = g_hash_table_new(g_direct_hash, g_direct_equal);
+	unlayered_protocols = g_hash_table_new(g_direct_hash, g_direct_equal);
 }
 
 void
@@ -213,6 +309,13 @@ packet_cleanup(void)
 	g_hash_table_destroy(depend_dissector_lists);
 	g_hash_table_destroy(heur_dissector_lists);
 	g_hash_table_destroy(heuristic_short_names);
+	g_hash_table_destroy(layered_protocols);
+	g_hash_table_destroy(unlayered_protocols);
+	if (dissector_profiles != NULL) {
+		g_hash_table_destroy(dissector_profiles);
+		dissector_profiles = NULL;
+	}
+	dissector_demand_clear();
 }
 
 /*
@@ -286,6 +389,14 @@ init_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_packet_init();
+
+	/* Nothing is known about the new file's conversations */
+	heur_conversation_memos = wmem_map_new(wmem_file_scope(),
+	    g_direct_hash, g_direct_equal);
+
+	/* Frames haven't been dissected yet, so their layers aren't known */
+	layer_sets = g_ptr_array_new();
+	layer_set_ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
 void
@@ -308,6 +419,19 @@ cleanup_dissection(void)
 	/* Cleanup the expert infos */
 	expert_packet_cleanup();
 
+	if (layer_sets) {
+		guint i;
+
+		for (i = 0; i < layer_sets->len; i++)
+			g_array_free((GArray *)g_ptr_array_index(layer_sets, i), TRUE);
+		g_ptr_array_free(layer_sets, TRUE);
+		layer_sets = NULL;
+		g_hash_table_destroy(layer_set_ids);
+		layer_set_ids = NULL;
+	}
+
+	heur_conversation_memos = NULL;
+
 	wmem_leave_file_scope();
 
 	/*
@@ -440,6 +564,111 @@ final_registration_all_protocols(void)
 }
 
 
+static gint
+compare_proto_ids(gconstpointer a, gconstpointer b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* Find, or add, the set of protocols in pinfo->layers */
+static guint32
+get_layers_id(packet_info *pinfo)
+{
+	GArray          *ids;
+	GString         *key;
+	wmem_list_frame_t *frame;
+	int              proto_id;
+	guint            i;
+	guint32          layers_id;
+
+	ids = g_array_new(FALSE, FALSE, sizeof(int));
+	for (frame = wmem_list_head(pinfo->layers); frame; frame = wmem_list_frame_next(frame)) {
+		proto_id = GPOINTER_TO_INT(wmem_list_frame_data(frame));
+		g_array_append_val(ids, proto_id);
+	}
+	g_array_sort(ids, compare_proto_ids);
+
+	key = g_string_new("");
+	for (i = 0; i < ids->len; i++) {
+		if (i > 0 && g_array_index(ids, int, i) == g_array_index(ids, int, i - 1)) {
+			g_array_remove_index(ids, i);
+			i--;
+			continue;
+		}
+		g_string_append_printf(key, "%d,", g_array_index(ids, int, i));
+	}
+
+	layers_id = GPOINTER_TO_UINT(g_hash_table_lookup(layer_set_ids, key->str));
+	if (layers_id == 0) {
+		g_ptr_array_add(layer_sets, ids);
+		layers_id = layer_sets->len;
+		g_hash_table_insert(layer_set_ids, g_string_free(key, FALSE), GUINT_TO_POINTER(layers_id));
+	} else {
+		g_array_free(ids, TRUE);
+		g_string_free(key, TRUE);
+	}
+	return layers_id;
+}
+
+/*
+ * Some dissectors add another protocol's items by calling its helper
+ * routines directly (e.g. dissect_kerberos_main(), or the BER and X.509
+ * helpers), so that protocol never gets into pinfo->layers.  Note every
+ * protocol that had items added to the tree without being in the frame's
+ * layers, so that frame_may_have_protocols() never trusts the layers for
+ * it.
+ */
+static void
+note_unlayered_item_protocols(proto_tree *tree, guint32 layers_id)
+{
+	GArray    *ids;
+	const int *item_protocols;
+	guint      num_item_protocols;
+	guint      i;
+
+	ids = (GArray *)g_ptr_array_index(layer_sets, layers_id - 1);
+	item_protocols = proto_tree_get_item_protocols(tree, &num_item_protocols);
+	for (i = 0; i < num_item_protocols; i++) {
+		int proto_id = item_protocols[i];
+
+		if (!g_hash_table_lookup(layered_protocols, GINT_TO_POINTER(proto_id)) ||
+		    g_hash_table_lookup(unlayered_protocols, GINT_TO_POINTER(proto_id)))
+			continue;	/* never trusted anyway */
+
+		if (bsearch(&proto_id, ids->data, ids->len, sizeof(int), compare_proto_ids) == NULL)
+			g_hash_table_insert(unlayered_protocols, GINT_TO_POINTER(proto_id), GINT_TO_POINTER(TRUE));
+	}
+}
+
+gboolean
+frame_may_have_protocols(const frame_data *fd, const int *proto_ids, int num_proto_ids)
+{
+	GArray *ids;
+	int     i;
+	guint   j;
+
+	if (fd->layers_id == 0 || layer_sets == NULL || fd->layers_id > layer_sets->len)
+		return TRUE;
+
+	ids = (GArray *)g_ptr_array_index(layer_sets, fd->layers_id - 1);
+	for (i = 0; i < num_proto_ids; i++) {
+		/*
+		 * The layers only tell us about protocols that are always
+		 * dissected through a handle.
+		 */
+		if (!g_hash_table_lookup(layered_protocols, GINT_TO_POINTER(proto_ids[i])) ||
+		    g_hash_table_lookup(unlayered_protocols, GINT_TO_POINTER(proto_ids[i])))
+			return TRUE;
+
+		for (j = 0; j < ids->len; j++) {
+			if (g_array_index(ids, int, j) == proto_ids[i])
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 /* Creates the top-most tvbuff and calls dissect_frame() */
 void
 dissect_record(epan_dissect_t *edt, int file_type_subtype,
@@ -507,6 +736,10 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	edt->pi.layers = wmem_list_new(edt->pi.pool);
 	edt->tvb = tvb;
 
+	/* No demanded protocol has been reached yet */
+	demand_generation++;
+	demand_seen = 0;
+
 
 	frame_delta_abs_time(edt->session, fd, fd->frame_ref_num, &edt->pi.rel_ts);
 
@@ -540,6 +773,16 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype,
 	}
 	ENDTRY;
 
+	/*
+	 * Remember which protocols are in the frame.  Without a tree,
+	 * some dissectors don't call their subdissectors, so only trust
+	 * the layers if we built one.
+	 */
+	if (edt->tree && fd->layers_id == 0 && layer_sets != NULL) {
+		fd->layers_id = get_layers_id(&edt->pi);
+		note_unlayered_item_protocols(edt->tree, fd->layers_id);
+	}
+
 	fd->flags.visited = 1;
 }
 
@@ -573,6 +816,10 @@ dissect_file(epan_dissect_t *edt, struct wtap_pkthdr *phdr,
 	edt->pi.layers = wmem_list_new(edt->pi.pool);
 	edt->tvb = tvb;
 
+	/* No demanded protocol has been reached yet */
+	demand_generation++;
+	demand_seen = 0;
+
 
 	frame_delta_abs_time(edt->session, fd, fd->frame_ref_num, &edt->pi.rel_ts);
 
@@ -621,6 +868,250 @@ struct dissector_handle {
 	protocol_t	*protocol;
 };
 
+typedef struct {
+	dissector_profile_t *profile;
+	gint64               start;
+	guint64              saved_child_time;
+	guint64              wmem_start;
+} profile_frame_t;
+
+void
+dissector_profiling_enable(gboolean enable)
+{
+	if (enable)
+		dissector_profiling++;
+	else if (dissector_profiling > 0)
+		dissector_profiling--;
+}
+
+gboolean
+dissector_profiling_enabled(void)
+{
+	return dissector_profiling != 0;
+}
+
+void
+dissector_profiling_reset(void)
+{
+	if (dissector_profiles != NULL)
+		g_hash_table_remove_all(dissector_profiles);
+	profile_child_time = 0;
+}
+
+static gint
+dissector_profile_compare(gconstpointer a, gconstpointer b)
+{
+	const dissector_profile_t *pa = *(const dissector_profile_t * const *)a;
+	const dissector_profile_t *pb = *(const dissector_profile_t * const *)b;
+
+	if (pa->time_exclusive != pb->time_exclusive)
+		return pa->time_exclusive > pb->time_exclusive ? -1 : 1;
+	return pa->proto_id - pb->proto_id;
+}
+
+static void
+dissector_profile_add_to_array(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	g_ptr_array_add((GPtrArray *)user_data, value);
+}
+
+GPtrArray *
+dissector_profile_get(void)
+{
+	GPtrArray *profiles = g_ptr_array_new();
+
+	if (dissector_profiles != NULL) {
+		g_hash_table_foreach(dissector_profiles,
+		    dissector_profile_add_to_array, profiles);
+		g_ptr_array_sort(profiles, dissector_profile_compare);
+	}
+	return profiles;
+}
+
+void
+dissector_demand_protocol(const int proto_id)
+{
+	if (demanded_protocols == NULL) {
+		demanded_protocols = g_hash_table_new(g_direct_hash, g_direct_equal);
+		g_hash_table_insert(demanded_protocols,
+		    GINT_TO_POINTER(dissector_handle_get_protocol_index(frame_handle)),
+		    GUINT_TO_POINTER(0));
+	}
+	g_hash_table_insert(demanded_protocols, GINT_TO_POINTER(proto_id),
+	    GUINT_TO_POINTER(0));
+}
+
+void
+dissector_demand_field(const int hfid)
+{
+	header_field_info *hfinfo = proto_registrar_get_nth(hfid);
+
+	if (hfinfo == NULL)
+		return;
+	dissector_demand_protocol(hfinfo->parent == -1 ? hfinfo->id : hfinfo->parent);
+}
+
+void
+dissector_demand_clear(void)
+{
+	if (demanded_protocols != NULL) {
+		g_hash_table_destroy(demanded_protocols);
+		demanded_protocols = NULL;
+	}
+	demand_seen = 0;
+}
+
+gboolean
+dissector_demand_enabled(void)
+{
+	return demanded_protocols != NULL;
+}
+
+/* Has the current packet reached every demanded protocol? */
+static gboolean
+demand_satisfied(void)
+{
+	return demand_seen >= g_hash_table_size(demanded_protocols);
+}
+
+static gboolean
+demand_is_demanded(const int proto_id)
+{
+	return g_hash_table_lookup_extended(demanded_protocols,
+	    GINT_TO_POINTER(proto_id), NULL, NULL);
+}
+
+/*
+ * Note that the current packet has reached a protocol.  Returns TRUE if
+ * that made a difference, i.e. if the protocol is demanded and the packet
+ * hadn't reached it before.
+ */
+static gboolean
+demand_note(const int proto_id)
+{
+	gpointer generation;
+
+	if (!g_hash_table_lookup_extended(demanded_protocols,
+	    GINT_TO_POINTER(proto_id), NULL, &generation) ||
+	    GPOINTER_TO_UINT(generation) == demand_generation)
+		return FALSE;
+
+	g_hash_table_insert(demanded_protocols, GINT_TO_POINTER(proto_id),
+	    GUINT_TO_POINTER(demand_generation));
+	demand_seen++;
+	return TRUE;
+}
+
+/* Take back a demand_note() for a dissector that rejected the packet. */
+static void
+demand_forget(const int proto_id)
+{
+	g_hash_table_insert(demanded_protocols, GINT_TO_POINTER(proto_id),
+	    GUINT_TO_POINTER(demand_generation - 1));
+	demand_seen--;
+}
+
+static gint64
+profile_now(void)
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+	return g_get_monotonic_time();
+#else
+	GTimeVal now;
+
+	g_get_current_time(&now);
+	return (gint64)now.tv_sec * G_USEC_PER_SEC + now.tv_usec;
+#endif
+}
+
+static guint64
+profile_wmem_bytes(packet_info *pinfo)
+{
+	guint64 bytes;
+
+	bytes = wmem_allocator_bytes_requested(wmem_packet_scope()) +
+		wmem_allocator_bytes_requested(wmem_file_scope());
+	if (pinfo->pool != NULL)
+		bytes += wmem_allocator_bytes_requested(pinfo->pool);
+	return bytes;
+}
+
+static void
+profile_enter(profile_frame_t *frame, int proto_id, packet_info *pinfo)
+{
+	dissector_profile_t *profile;
+
+	if (dissector_profiles == NULL)
+		dissector_profiles = g_hash_table_new_full(g_direct_hash,
+		    g_direct_equal, NULL, g_free);
+
+	profile = (dissector_profile_t *)g_hash_table_lookup(dissector_profiles,
+	    GINT_TO_POINTER(proto_id));
+	if (profile == NULL) {
+		profile = g_new0(dissector_profile_t, 1);
+		profile->proto_id = proto_id;
+		g_hash_table_insert(dissector_profiles,
+		    GINT_TO_POINTER(proto_id), profile);
+	}
+	profile->calls++;
+
+	frame->profile = profile;
+	frame->saved_child_time = profile_child_time;
+	frame->wmem_start = profile_wmem_bytes(pinfo);
+	profile_child_time = 0;
+	frame->start = profile_now();
+}
+
+static void
+profile_leave(profile_frame_t *frame, packet_info *pinfo, tvbuff_t *tvb,
+	      gboolean accepted)
+{
+	dissector_profile_t *profile = frame->profile;
+	gint64               elapsed;
+
+	elapsed = profile_now() - frame->start;
+	if (elapsed < 0)
+		elapsed = 0;
+
+	profile->time_inclusive += elapsed;
+	if ((guint64)elapsed > profile_child_time)
+		profile->time_exclusive += elapsed - profile_child_time;
+	profile->wmem_bytes += profile_wmem_bytes(pinfo) - frame->wmem_start;
+	if (accepted) {
+		profile->accepted++;
+		profile->bytes += tvb_captured_length(tvb);
+	}
+	profile_child_time = frame->saved_child_time + elapsed;
+}
+
+/*
+ * Call a heuristic dissector, counting it if profiling is on.
+ */
+static gboolean
+call_heuristic_through_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+			     packet_info *pinfo, proto_tree *tree, void *data)
+{
+	profile_frame_t   frame;
+	volatile gboolean accepted = FALSE;
+
+	if (!dissector_profiling || hdtbl_entry->protocol == NULL)
+		return (*hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+
+	profile_enter(&frame, proto_get_id(hdtbl_entry->protocol), pinfo);
+	frame.profile->heur_tries++;
+	TRY {
+		accepted = (*hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	}
+	FINALLY {
+		if (accepted)
+			frame.profile->heur_accepts++;
+		profile_leave(&frame, pinfo, tvb, accepted);
+	}
+	ENDTRY;
+
+	return accepted;
+}
+
 /* This function will return
  * old style dissector :
  *   length of the payload or 1 of the payload is empty
@@ -645,7 +1136,22 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 			proto_get_protocol_short_name(handle->protocol);
 	}
 
-	len = (*handle->dissector)(tvb, pinfo, tree, data);
+	if (dissector_profiling && handle->protocol != NULL) {
+		profile_frame_t frame;
+		volatile int    profiled_len = 0;
+
+		profile_enter(&frame, proto_get_id(handle->protocol), pinfo);
+		TRY {
+			profiled_len = (*handle->dissector)(tvb, pinfo, tree, data);
+		}
+		FINALLY {
+			profile_leave(&frame, pinfo, tvb, profiled_len != 0);
+		}
+		ENDTRY;
+		len = profiled_len;
+	} else {
+		len = (*handle->dissector)(tvb, pinfo, tree, data);
+	}
 	pinfo->current_proto = saved_proto;
 
 	return len;
@@ -673,6 +1179,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 	guint16      saved_can_desegment;
 	int          len;
 	guint        saved_layers_len = 0;
+	int          demand_proto = -1;
+	gboolean     demand_noted = FALSE;
 
 	if (handle->protocol != NULL &&
 	    !proto_is_protocol_enabled(handle->protocol)) {
@@ -682,6 +1190,21 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (demanded_protocols != NULL) {
+		if (handle->protocol != NULL)
+			demand_proto = proto_get_id(handle->protocol);
+		if (demand_satisfied() && !demand_is_demanded(demand_proto)) {
+			/*
+			 * Everything that was asked for has been
+			 * dissected; act as if this dissector took
+			 * all of the data.
+			 */
+			len = tvb_captured_length(tvb);
+			return len > 0 ? len : 1;
+		}
+		demand_noted = demand_note(demand_proto);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
@@ -711,6 +1234,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		if (add_proto_name) {
 			pinfo->curr_layer_num++;
 			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_get_id(handle->protocol)));
+		} else if (!g_hash_table_lookup(unlayered_protocols, GINT_TO_POINTER(proto_get_id(handle->protocol)))) {
+			g_hash_table_insert(unlayered_protocols, GINT_TO_POINTER(proto_get_id(handle->protocol)), GINT_TO_POINTER(TRUE));
 		}
 	}
 
@@ -731,6 +1256,8 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
 			wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
 		}
+		if (demand_noted)
+			demand_forget(demand_proto);
  	}
  	pinfo->current_proto = saved_proto;
  	pinfo->can_desegment = saved_can_desegment;
@@ -889,6 +1416,91 @@ find_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
 				   GUINT_TO_POINTER(pattern));
 }
 
+static void
+uint_array_add_entry(gpointer key, gpointer value, gpointer user_data)
+{
+	dissector_table_t sub_dissectors = (dissector_table_t)user_data;
+	guint32 pattern = GPOINTER_TO_UINT(key);
+
+	if (pattern < sub_dissectors->uint_array_size)
+		sub_dissectors->uint_array[pattern] = (dtbl_entry_t *)value;
+}
+
+/*
+ * Find an entry in a uint dissector table when dissecting a packet,
+ * indexing the table directly if it's narrow enough.
+ */
+static dtbl_entry_t *
+lookup_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
+{
+	if (sub_dissectors->uint_array == NULL) {
+		switch (sub_dissectors->type) {
+
+		case FT_UINT8:
+			sub_dissectors->uint_array_size = G_MAXUINT8 + 1;
+			break;
+
+		case FT_UINT16:
+			sub_dissectors->uint_array_size = G_MAXUINT16 + 1;
+			break;
+
+		default:
+			/*
+			 * Too wide for an array; hash.
+			 */
+			return find_uint_dtbl_entry(sub_dissectors, pattern);
+		}
+		sub_dissectors->uint_array = g_new0(dtbl_entry_t *,
+		    sub_dissectors->uint_array_size);
+		g_hash_table_foreach(sub_dissectors->hash_table,
+		    uint_array_add_entry, sub_dissectors);
+	}
+
+	/*
+	 * Values too big for the table's type can still have been
+	 * registered; they're only in the hash table.
+	 */
+	if (pattern < sub_dissectors->uint_array_size)
+		return sub_dissectors->uint_array[pattern];
+	return (dtbl_entry_t *)g_hash_table_lookup(sub_dissectors->hash_table,
+				   GUINT_TO_POINTER(pattern));
+}
+
+/*
+ * Add an entry to, or remove an entry from, a uint dissector table,
+ * keeping its array, if it has one, in step.
+ */
+static void
+uint_dtbl_insert(dissector_table_t sub_dissectors, const guint32 pattern,
+		 dtbl_entry_t *dtbl_entry)
+{
+	g_hash_table_insert(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	if (pattern < sub_dissectors->uint_array_size)
+		sub_dissectors->uint_array[pattern] = dtbl_entry;
+}
+
+static void
+uint_dtbl_remove(dissector_table_t sub_dissectors, const guint32 pattern)
+{
+	g_hash_table_remove(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern));
+	if (pattern < sub_dissectors->uint_array_size)
+		sub_dissectors->uint_array[pattern] = NULL;
+}
+
+/*
+ * Throw away a table's array after removing entries from it wholesale;
+ * it'll be rebuilt when it's next needed.
+ */
+static void
+uint_dtbl_forget_array(dissector_table_t sub_dissectors)
+{
+	g_free(sub_dissectors->uint_array);
+	sub_dissectors->uint_array = NULL;
+	sub_dissectors->uint_array_size = 0;
+}
+
 #if 0
 static void
 dissector_add_uint_sanity_check(const char *name, guint32 pattern, dissector_handle_t handle, dissector_table_t sub_dissectors)
@@ -966,8 +1578,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dtbl_entry->initial = dtbl_entry->current;
 
 	/* do the table insertion */
-	g_hash_table_insert( sub_dissectors->hash_table,
-			     GUINT_TO_POINTER( pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 
 	/*
 	 * Now add it to the list of handles that could be used for
@@ -1020,8 +1631,7 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 		/*
 		 * Found - remove it.
 		 */
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -1063,6 +1673,7 @@ void dissector_delete_all(const char *name, dissector_handle_t handle)
 	g_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	uint_dtbl_forget_array(sub_dissectors);
 }
 
 static void
@@ -1072,6 +1683,7 @@ dissector_delete_from_table(gpointer key _U_, gpointer value, gpointer user_data
 	g_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove(sub_dissectors->hash_table, dissector_delete_all_check, user_data);
+	uint_dtbl_forget_array(sub_dissectors);
 	sub_dissectors->dissector_handles = g_slist_remove(sub_dissectors->dissector_handles, user_data);
 }
 
@@ -1115,8 +1727,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	dtbl_entry->current = handle;
 
 	/* do the table insertion */
-	g_hash_table_insert( sub_dissectors->hash_table,
-			     GUINT_TO_POINTER( pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1143,8 +1754,7 @@ dissector_reset_uint(const char *name, const guint32 pattern)
 	if (dtbl_entry->initial != NULL) {
 		dtbl_entry->current = dtbl_entry->initial;
 	} else {
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -1162,7 +1772,7 @@ dissector_try_uint_new(dissector_table_t sub_dissectors, const guint32 uint_val,
 	guint32                  saved_match_uint;
 	int len;
 
-	dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
+	dtbl_entry = lookup_uint_dtbl_entry(sub_dissectors, uint_val);
 	if (dtbl_entry != NULL) {
 		/*
 		 * Is there currently a dissector handle for this entry?
@@ -1220,7 +1830,7 @@ dissector_get_uint_handle(dissector_table_t const sub_dissectors, const guint32
 {
 	dtbl_entry_t *dtbl_entry;
 
-	dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
+	dtbl_entry = lookup_uint_dtbl_entry(sub_dissectors, uint_val);
 	if (dtbl_entry != NULL)
 		return dtbl_entry->current;
 	else
@@ -2136,6 +2746,8 @@ register_dissector_table(const char *name, const char *ui_name, const int proto,
 		g_error("The dissector table %s (%s) is registering an unsupported type - are you using a buggy plugin?", name, ui_name);
 		g_assert_not_reached();
 	}
+	sub_dissectors->uint_array = NULL;
+	sub_dissectors->uint_array_size = 0;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = type;
@@ -2165,6 +2777,8 @@ dissector_table_t register_custom_dissector_table(const char *name,
 							       &g_free,
 							       &g_free );
 
+	sub_dissectors->uint_array = NULL;
+	sub_dissectors->uint_array_size = 0;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = FT_BYTES; /* Consider key a "blob" of data, no need to really create new type */
@@ -2234,6 +2848,7 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
 	const char            *proto_name;
 	heur_dtbl_entry_t     *hdtbl_entry;
+	heur_dtbl_entry_priv_t *hdtbl_priv;
 	guint                  i, list_size;
 	GSList                *list_entry;
 
@@ -2279,7 +2894,10 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 			" This might be caused by an inappropriate plugin or a development error.", short_name);
 	}
 
-	hdtbl_entry = g_slice_new(heur_dtbl_entry_t);
+	hdtbl_priv = g_slice_new(heur_dtbl_entry_priv_t);
+	hdtbl_priv->registration_order = heur_registration_count++;
+	hdtbl_priv->hits = 0;
+	hdtbl_entry = &hdtbl_priv->entry;
 	hdtbl_entry->dissector = dissector;
 	hdtbl_entry->protocol  = find_protocol_by_id(proto);
 	hdtbl_entry->display_name = display_name;
@@ -2287,6 +2905,9 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
 
+	if (hdtbl_entry->protocol != NULL)
+		g_hash_table_insert(layered_protocols, GINT_TO_POINTER(proto), GINT_TO_POINTER(TRUE));
+
 	/* do the table insertion */
 	g_hash_table_insert(heuristic_short_names, (gpointer)short_name, hdtbl_entry);
 
@@ -2333,10 +2954,172 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 		heur_dtbl_entry_t *found_hdtbl_entry = (heur_dtbl_entry_t *)(found_entry->data);
 		g_free(found_hdtbl_entry->list_name);
 		g_hash_table_remove(heuristic_short_names, found_hdtbl_entry->short_name);
-		g_slice_free(heur_dtbl_entry_t, found_entry->data);
+		g_slice_free(heur_dtbl_entry_priv_t, found_entry->data);
 		sub_dissectors->dissectors = g_slist_delete_link(sub_dissectors->dissectors,
 		    found_entry);
+		heur_memo_generation++;
+	}
+}
+
+/*
+ * Find what we remember about the conversation the packet is in for a
+ * heuristic list, if it's in a conversation.
+ */
+static heur_conv_memo_t *
+heur_conversation_memo(heur_dissector_list_t sub_dissectors, packet_info *pinfo)
+{
+	conversation_t   *conversation;
+	heur_conv_memo_t *head, *memo;
+
+	if (heur_conversation_memos == NULL)
+		return NULL;
+
+	conversation = find_conversation_exact(pinfo->num, &pinfo->src, &pinfo->dst,
+	    pinfo->ptype, pinfo->srcport, pinfo->destport);
+	if (conversation == NULL)
+		return NULL;
+
+	head = (heur_conv_memo_t *)wmem_map_lookup(heur_conversation_memos, conversation);
+	for (memo = head; memo != NULL; memo = memo->next) {
+		if (memo->list == sub_dissectors)
+			break;
+	}
+	if (memo == NULL) {
+		memo = wmem_new0(wmem_file_scope(), heur_conv_memo_t);
+		memo->list = sub_dissectors;
+		memo->generation = heur_memo_generation;
+		memo->next = head;
+		wmem_map_insert(heur_conversation_memos, conversation, memo);
+	}
+	if (memo->generation != heur_memo_generation) {
+		memo->accepted = NULL;
+		memo->rejects = NULL;
+		memo->generation = heur_memo_generation;
 	}
+	return memo;
+}
+
+static gint
+heur_entry_compare_hits(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_priv_t *pa = (const heur_dtbl_entry_priv_t *)a;
+	const heur_dtbl_entry_priv_t *pb = (const heur_dtbl_entry_priv_t *)b;
+
+	if (pa->hits != pb->hits)
+		return pa->hits > pb->hits ? -1 : 1;
+	return 0;
+}
+
+static gint
+heur_entry_compare_registration(gconstpointer a, gconstpointer b)
+{
+	const heur_dtbl_entry_priv_t *pa = (const heur_dtbl_entry_priv_t *)a;
+	const heur_dtbl_entry_priv_t *pb = (const heur_dtbl_entry_priv_t *)b;
+
+	/* Entries are prepended, so the latest registered comes first. */
+	if (pa->registration_order != pb->registration_order)
+		return pa->registration_order > pb->registration_order ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Reorder a heuristic list by the number of packets each dissector has
+ * accepted, or put it back in registration order, depending on the
+ * "heuristic_reorder" preference.  Lists being walked are left alone.
+ * g_slist_sort() is stable, so dissectors that have accepted the same
+ * number of packets stay in the order they were in.
+ */
+static void
+heur_dissector_list_reorder(heur_dissector_list_t sub_dissectors)
+{
+	if (sub_dissectors->active != 0)
+		return;
+
+	if (prefs.heur_reorder) {
+		if (sub_dissectors->stats.lookups % HEUR_REORDER_INTERVAL == 0) {
+			sub_dissectors->dissectors = g_slist_sort(sub_dissectors->dissectors,
+			    heur_entry_compare_hits);
+			sub_dissectors->reordered = TRUE;
+			sub_dissectors->stats.reorders++;
+		}
+	} else if (sub_dissectors->reordered) {
+		sub_dissectors->dissectors = g_slist_sort(sub_dissectors->dissectors,
+		    heur_entry_compare_registration);
+		sub_dissectors->reordered = FALSE;
+	}
+}
+
+/*
+ * Leave a heuristic list we've been walking; this is also called if a
+ * dissector throws an exception, so the list can be reordered again.
+ */
+static void
+heur_dissector_list_leave(void *arg)
+{
+	heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)arg;
+
+	sub_dissectors->active--;
+}
+
+/*
+ * Try one heuristic dissector from a list, if it's enabled.  Returns
+ * TRUE if it accepted the packet.
+ */
+static gboolean
+try_heuristic_entry(heur_dissector_list_t sub_dissectors, heur_dtbl_entry_t *hdtbl_entry,
+		    guint saved_layers_len, guint16 saved_can_desegment, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data)
+{
+	int      proto_id = -1;
+	gboolean demand_noted = FALSE;
+
+	/* XXX - why set this now and above? */
+	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	if (demanded_protocols != NULL)
+		demand_noted = demand_note(proto_id);
+
+	sub_dissectors->stats.tries++;
+	if (call_heuristic_through_entry(hdtbl_entry, tvb, pinfo, tree, data)) {
+		((heur_dtbl_entry_priv_t *)hdtbl_entry)->hits++;
+		return TRUE;
+	}
+
+	if (demand_noted)
+		demand_forget(proto_id);
+
+	/*
+	 * That dissector didn't accept the packet, so
+	 * remove its protocol's name from the list
+	 * of protocols.
+	 */
+	while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+		wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+	}
+	return FALSE;
+}
+
+static gboolean
+heur_entry_usable(heur_dtbl_entry_t *hdtbl_entry)
+{
+	return hdtbl_entry->protocol == NULL ||
+	    (proto_is_protocol_enabled(hdtbl_entry->protocol) && hdtbl_entry->enabled);
 }
 
 gboolean
@@ -2350,7 +3133,18 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
+	heur_dtbl_entry_t *tried_first;
+	heur_conv_memo_t  *memo;
+	guint              rejects;
+
+	if (demanded_protocols != NULL && demand_satisfied()) {
+		/*
+		 * Everything that was asked for has been dissected;
+		 * don't go looking for anything else.
+		 */
+		*heur_dtbl_entry = NULL;
+		return FALSE;
+	}
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
 	   then everytime a subdissector is called it is decremented by one.
@@ -2372,58 +3166,120 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	saved_layers_len = wmem_list_count(pinfo->layers);
 	*heur_dtbl_entry = NULL;
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
+	sub_dissectors->stats.lookups++;
+	heur_dissector_list_reorder(sub_dissectors);
+	sub_dissectors->active++;
+	CLEANUP_PUSH(heur_dissector_list_leave, sub_dissectors);
+
+	memo = NULL;
+	tried_first = NULL;
+	if (prefs.heur_conversation_memo || prefs.heur_skip_rejecting)
+		memo = heur_conversation_memo(sub_dissectors, pinfo);
+
+	/*
+	 * If a heuristic dissector accepted the last packet in this
+	 * packet's conversation, it's likely to accept this one, so try
+	 * it first.  That makes which dissector gets a packet depend on
+	 * the packets dissected before it, so it's only done if asked for.
+	 */
+	if (memo != NULL && prefs.heur_conversation_memo &&
+	    memo->accepted != NULL && heur_entry_usable(memo->accepted)) {
+		tried_first = memo->accepted;
+		if (try_heuristic_entry(sub_dissectors, tried_first, saved_layers_len,
+					saved_can_desegment, tvb, pinfo, tree, data)) {
+			*heur_dtbl_entry = tried_first;
+			sub_dissectors->stats.memo_hits++;
+			status = TRUE;
+		}
+	}
+
+	for (entry = sub_dissectors->dissectors; !status && entry != NULL;
 	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
 		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
+		if (!heur_entry_usable(hdtbl_entry)) {
 			/*
 			 * No - don't try this dissector.
 			 */
 			continue;
 		}
 
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
-
+		if (hdtbl_entry == tried_first) {
 			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
+			 * Already tried above.
 			 */
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+			continue;
 		}
 
-		pinfo->heur_list_name = hdtbl_entry->list_name;
+		rejects = 0;
+		if (memo != NULL && memo->rejects != NULL) {
+			rejects = GPOINTER_TO_UINT(wmem_map_lookup(memo->rejects, hdtbl_entry));
+			if (rejects >= HEUR_REJECT_LIMIT && prefs.heur_skip_rejecting) {
+				/*
+				 * It's rejected everything in this conversation
+				 * for a while; don't bother.
+				 */
+				sub_dissectors->stats.skipped++;
+				continue;
+			}
+		}
 
-		if ((hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
+		if (try_heuristic_entry(sub_dissectors, hdtbl_entry, saved_layers_len,
+					saved_can_desegment, tvb, pinfo, tree, data)) {
 			*heur_dtbl_entry = hdtbl_entry;
 			status = TRUE;
-			break;
-		} else {
-			/*
-			 * That dissector didn't accept the packet, so
-			 * remove its protocol's name from the list
-			 * of protocols.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+			if (memo != NULL) {
+				if (prefs.heur_conversation_memo)
+					memo->accepted = hdtbl_entry;
+				if (rejects != 0)
+					wmem_map_insert(memo->rejects, hdtbl_entry, GUINT_TO_POINTER(0));
 			}
+		} else if (memo != NULL && prefs.heur_skip_rejecting) {
+			if (memo->rejects == NULL)
+				memo->rejects = wmem_map_new(wmem_file_scope(),
+				    g_direct_hash, g_direct_equal);
+			wmem_map_insert(memo->rejects, hdtbl_entry, GUINT_TO_POINTER(rejects + 1));
 		}
 	}
 
+	if (status)
+		sub_dissectors->stats.accepts++;
+	CLEANUP_CALL_AND_POP;
+
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->heur_list_name = saved_heur_list_name;
 	pinfo->can_desegment = saved_can_desegment;
 	return status;
 }
 
+static void
+heur_dissector_list_add_stats(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+
+	if (sub_dissectors->stats.lookups != 0)
+		g_ptr_array_add((GPtrArray *)user_data, &sub_dissectors->stats);
+}
+
+static gint
+heur_dissector_list_stats_compare(gconstpointer a, gconstpointer b)
+{
+	const heur_dissector_list_stats_t *sa = *(const heur_dissector_list_stats_t * const *)a;
+	const heur_dissector_list_stats_t *sb = *(const heur_dissector_list_stats_t * const *)b;
+
+	return strcmp(sa->list_name, sb->list_name);
+}
+
+GPtrArray *
+heur_dissector_list_stats_get(void)
+{
+	GPtrArray *stats = g_ptr_array_new();
+
+	g_hash_table_foreach(heur_dissector_lists, heur_dissector_list_add_stats, stats);
+	g_ptr_array_sort(stats, heur_dissector_list_stats_compare);
+	return stats;
+}
+
 typedef struct heur_dissector_foreach_info {
 	gpointer      caller_data;
 	DATFunc_heur  caller_func;
@@ -2569,9 +3425,11 @@ register_heur_dissector_list(const char *name, const int proto)
 
 	/* Create and register the dissector table for this name; returns */
 	/* a pointer to the dissector table. */
-	sub_dissectors = g_slice_new(struct heur_dissector_list);
+	sub_dissectors = g_slice_new0(struct heur_dissector_list);
+	sub_dissectors->name = name;
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->stats.list_name = name;
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
@@ -2678,6 +3536,9 @@ create_dissector_handle(dissector_t dissector, const int proto)
 	handle->dissector	= dissector;
 	handle->protocol	= find_protocol_by_id(proto);
 
+	if (handle->protocol != NULL)
+		g_hash_table_insert(layered_protocols, GINT_TO_POINTER(proto), GINT_TO_POINTER(TRUE));
+
 	return handle;
 }
 
@@ -2691,6 +3552,9 @@ dissector_handle_t create_dissector_handle_with_name(dissector_t dissector,
 	handle->dissector	= dissector;
 	handle->protocol	= find_protocol_by_id(proto);
 
+	if (handle->protocol != NULL)
+		g_hash_table_insert(layered_protocols, GINT_TO_POINTER(proto), GINT_TO_POINTER(TRUE));
+
 	return handle;
 }
 
@@ -2719,6 +3583,9 @@ register_dissector(const char *name, dissector_t dissector, const int proto)
 	handle->dissector     = dissector;
 	handle->protocol      = find_protocol_by_id(proto);
 
+	if (handle->protocol != NULL)
+		g_hash_table_insert(layered_protocols, GINT_TO_POINTER(proto), GINT_TO_POINTER(TRUE));
+
 	g_hash_table_insert(registered_dissectors, (gpointer)name,
 			    (gpointer) handle);
 
@@ -2860,7 +3727,7 @@ void call_heur_dissector_direct(heur_dtbl_entry_t *heur_dtbl_entry, tvbuff_t *tv
 	pinfo->heur_list_name = heur_dtbl_entry->list_name;
 
 	/* call the dissector, as we have saved the result heuristic failure is an error */
-	if(!(*heur_dtbl_entry->dissector)(tvb, pinfo, tree, data))
+	if(!call_heuristic_through_entry(heur_dtbl_entry, tvb, pinfo, tree, data))
 		g_assert_not_reached();
 
 	/* Restore info from caller */
@@ -444,6 +444,10 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
  *  until we find one that recognizes the protocol.
  *  Call this while the parent dissector running.
  *
+ *  If the "heuristic_conversation_memo" preference is set and the packet
+ *  is in a conversation, the dissector from the list that last recognized
+ *  a packet in that conversation is tried first.
+ *
  * @param sub_dissectors the sub-dissector list
  * @param tvb the tvbuff with the (remaining) packet data
  * @param pinfo the packet info of this packet (additional info)
@@ -455,6 +459,23 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
 WS_DLL_PUBLIC gboolean dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
     tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **hdtbl_entry, void *data);
 
+/** Counters for the lookups done in a heuristic dissector list. */
+typedef struct heur_dissector_list_stats_s {
+    const char *list_name;
+    guint64     lookups;    /**< calls to dissector_try_heuristic() */
+    guint64     accepts;    /**< lookups in which a dissector recognized the packet */
+    guint64     memo_hits;  /**< ...the one that last did in the packet's conversation */
+    guint64     tries;      /**< heuristic dissectors called */
+    guint64     skipped;    /**< heuristic dissectors not called, as they kept rejecting the conversation */
+    guint64     reorders;   /**< times the list was sorted by success */
+} heur_dissector_list_stats_t;
+
+/** Get the counters for every heuristic dissector list that has been used,
+ *  sorted by list name.  The entries belong to the lists; free the array
+ *  with g_ptr_array_free(array, TRUE).
+ */
+WS_DLL_PUBLIC GPtrArray *heur_dissector_list_stats_get(void);
+
 /** Find a heuristic dissector table by table name.
  *
  * @param name name of the dissector table
@@ -711,6 +732,20 @@ typedef struct file_data_s
 
 } file_data_t;
 
+/** Check whether a frame can contain any of a set of protocols.
+ *
+ * Returns FALSE only if the frame was already dissected with a tree and
+ * none of the protocols were found in it, so that a filter needing one of
+ * them can skip dissecting the frame again.
+ *
+ * @param fd the frame
+ * @param proto_ids protocol ids
+ * @param num_proto_ids number of protocol ids
+ * @return FALSE if none of the protocols can be in the frame
+ */
+WS_DLL_PUBLIC gboolean frame_may_have_protocols(const frame_data *fd,
+    const int *proto_ids, int num_proto_ids);
+
 /*
  * Dissectors should never modify the record data.
  */
@@ -757,6 +792,72 @@ void deregister_postdissector(dissector_handle_t handle);
 extern gboolean have_postdissector(void);
 extern void call_all_postdissectors(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree);
 
+/*
+ * Per-protocol dissector profiling.  While enabled, every call made
+ * through a dissector handle and every heuristic dissector tried is
+ * counted against the handle's protocol.  Times are in microseconds;
+ * "inclusive" counts the time spent in the dissectors it calls, while
+ * "exclusive" does not.  bytes is the captured length of the tvbuffs
+ * the protocol accepted, and wmem_bytes is what was requested from the
+ * packet, pinfo and file scopes while it (or anything it called) ran.
+ */
+typedef struct dissector_profile_s {
+    int     proto_id;
+    guint64 calls;
+    guint64 accepted;
+    guint64 time_inclusive;
+    guint64 time_exclusive;
+    guint64 bytes;
+    guint64 wmem_bytes;
+    guint64 heur_tries;
+    guint64 heur_accepts;
+} dissector_profile_t;
+
+/** Turn dissector profiling on or off.  It is off by default, and costs
+ * nothing but a test per dissector call while off.  Calls are counted,
+ * so that profiling stays on until it has been turned off as many times
+ * as it was turned on. */
+WS_DLL_PUBLIC void dissector_profiling_enable(gboolean enable);
+
+/** Returns TRUE if dissector profiling is on. */
+WS_DLL_PUBLIC gboolean dissector_profiling_enabled(void);
+
+/** Discard all the counters gathered so far. */
+WS_DLL_PUBLIC void dissector_profiling_reset(void);
+
+/** Get the counters for every protocol that has been called since the
+ * last reset, sorted by decreasing exclusive time.  The entries belong to
+ * the profiler and are only valid until the next reset; free the array
+ * with g_ptr_array_free(array, TRUE). */
+WS_DLL_PUBLIC GPtrArray *dissector_profile_get(void);
+
+/*
+ * Demand-driven dissection.  Once any protocol has been demanded, each
+ * packet is dissected as usual until every demanded protocol has been
+ * handed the packet; from then on only the dissectors of demanded
+ * protocols are called, and everything beneath them is left alone.
+ *
+ * This is only for callers that need the fields of a few protocols and
+ * no columns, taps or full protocol tree.  A demanded protocol that turns
+ * up again beneath an undemanded one, such as the inner IP header of a
+ * GRE tunnel, is not dissected there.  Packets that never reach some
+ * demanded protocol are dissected in full.
+ */
+
+/** Demand the protocol with the given ID.  The "frame" protocol is
+ * demanded along with the first one. */
+WS_DLL_PUBLIC void dissector_demand_protocol(const int proto_id);
+
+/** Demand the protocol the field with the given ID belongs to, or the
+ * protocol itself if the ID is a protocol's. */
+WS_DLL_PUBLIC void dissector_demand_field(const int hfid);
+
+/** Forget all demanded protocols, going back to full dissection. */
+WS_DLL_PUBLIC void dissector_demand_clear(void);
+
+/** Returns TRUE if any protocol has been demanded. */
+WS_DLL_PUBLIC gboolean dissector_demand_enabled(void);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -2455,6 +2455,15 @@ prefs_register_modules(void)
                                    "Show the intelligent scroll bar (a minimap of packet list colors in the scrollbar)",
                                    &prefs.gui_packet_list_show_minimap);
 
+    prefs_register_bool_preference(gui_module, "frame_index.enabled",
+                                   "Keep an index of the frames in capture files",
+                                   "Save the list of frames in a capture file after reading it, and use it "
+                                   "instead of reading the file again the next time it's opened. "
+                                   "Frames are then only dissected as they're displayed, so analysis that "
+                                   "depends on earlier frames, such as TCP sequence analysis and reassembly, "
+                                   "is only complete after the file has been reloaded (Experimental)",
+                                   &prefs.gui_frame_index);
+
     /* Console
      * These are preferences that can be read/written using the
      * preference module API.  These preferences still use their own
@@ -2686,6 +2695,25 @@ prefs_register_modules(void)
                                    "Look for dissectors that left some bytes undecoded.",
                                    &prefs.enable_incomplete_dissectors_check);
 
+    prefs_register_bool_preference(protocols_module, "heuristic_skip_rejecting",
+                                   "Stop trying heuristic dissectors that keep rejecting a conversation",
+                                   "Once a heuristic dissector has rejected a number of packets in a row "
+                                   "in a conversation, don't try it on the rest of that conversation.",
+                                   &prefs.heur_skip_rejecting);
+
+    prefs_register_bool_preference(protocols_module, "heuristic_reorder",
+                                   "Try the most successful heuristic dissectors first",
+                                   "Every so often, reorder each list of heuristic dissectors so that "
+                                   "the ones that have accepted the most packets are tried first.",
+                                   &prefs.heur_reorder);
+
+    prefs_register_bool_preference(protocols_module, "heuristic_conversation_memo",
+                                   "Try the last successful heuristic dissector first",
+                                   "In each conversation, first try the heuristic dissector that "
+                                   "recognized the last packet.  Which dissector gets a packet "
+                                   "may then depend on the packets dissected before it.",
+                                   &prefs.heur_conversation_memo);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -3118,6 +3146,7 @@ pre_init_prefs(void)
     prefs.gui_packet_list_elide_mode = ELIDE_RIGHT;
     prefs.gui_packet_list_show_related = TRUE;
     prefs.gui_packet_list_show_minimap = TRUE;
+    prefs.gui_frame_index            = FALSE;
 
     prefs.gui_qt_packet_list_separator = FALSE;
 
@@ -3174,6 +3203,9 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.heur_skip_rejecting = FALSE;
+    prefs.heur_reorder = FALSE;
+    prefs.heur_conversation_memo = FALSE;
 }
 
 /*
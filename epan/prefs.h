@@ -214,6 +214,9 @@ typedef struct _e_prefs {
   gboolean     display_hidden_proto_items;
   gboolean     display_byte_fields_with_spaces;
   gboolean     enable_incomplete_dissectors_check;
+  gboolean     heur_skip_rejecting;
+  gboolean     heur_reorder;
+  gboolean     heur_conversation_memo;
   gpointer     filter_expressions;/* Actually points to &head */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
@@ -226,6 +229,7 @@ typedef struct _e_prefs {
   elide_mode_e gui_packet_list_elide_mode;
   gboolean     gui_packet_list_show_related;
   gboolean     gui_packet_list_show_minimap;
+  gboolean     gui_frame_index; /* Save and load frame index files */
   gboolean     st_enable_burstinfo;
   gboolean     st_burst_showcount;
   gint         st_burst_resolution;
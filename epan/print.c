@@ -1724,6 +1724,15 @@ gsize output_fields_num_fields(output_fields_t* fields)
     }
 }
 
+const gchar *output_fields_get_field(output_fields_t* fields, gsize i)
+{
+    g_assert(fields);
+    g_assert(fields->fields);
+    g_assert(i < fields->fields->len);
+
+    return (const gchar *)g_ptr_array_index(fields->fields, i);
+}
+
 void output_fields_free(output_fields_t* fields)
 {
     g_assert(fields);
@@ -128,6 +128,7 @@ struct ptvcursor {
 			wmem_strdup_printf(wmem_packet_scope(), "More than %d items in the tree -- possible infinite loop", MAX_TREE_ITEMS)); \
 	}								\
 	PROTO_REGISTRAR_GET_NTH(hfindex, hfinfo);			\
+	tree_data_note_item_protocol(PTREE_DATA(tree), hfinfo);	\
 	if (!(PTREE_DATA(tree)->visible)) {				\
 		if (PTREE_FINFO(tree)) {				\
 			if ((hfinfo->ref_type != HF_REF_TYPE_DIRECT)	\
@@ -309,6 +310,7 @@ struct _protocol {
 	gboolean    enabled_by_default; /* TRUE if protocol is enabled by default */
 	gboolean    can_toggle;         /* TRUE if is_enabled can be changed */
 	GList      *heur_list;          /* Heuristic dissectors associated with this protocol */
+	guint32     item_stamp;         /* item_stamp of the last tree this protocol had items added to */
 };
 
 /* List of all protocols */
@@ -318,20 +320,51 @@ static GList *protocols = NULL;
 static GPtrArray *deregistered_fields = NULL;
 static GPtrArray *deregistered_data = NULL;
 
+/* Every field that has been primed gets a small "interesting field" slot
+ * number, so that each proto_tree can keep the field_info arrays of the
+ * primed fields in a dense array instead of a hash table.  Slots are
+ * handed out once and never reused. */
+static guint  *interesting_slots = NULL;	/* slot + 1 for each hfid, 0 if none */
+static guint   interesting_slots_len = 0;
+static GArray *interesting_slot_hfids = NULL;	/* hfid for each slot */
+
+/* field_info and proto_node records are carved out of slabs of this many
+ * records, allocated from the packet's pool.  The slabs go away in bulk
+ * when the pool is freed after proto_tree_reset(). */
+#define PROTO_SLAB_RECORDS	64
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+#define FIELD_INFO_NEW(tree, fi)					\
+	do {								\
+		tree_data_t *_td = PTREE_DATA(tree);			\
+		if (_td->fi_slab_left == 0) {				\
+			_td->fi_slab = wmem_alloc_array(PNODE_POOL(tree), \
+				field_info, PROTO_SLAB_RECORDS);	\
+			_td->fi_slab_left = PROTO_SLAB_RECORDS;		\
+		}							\
+		fi = _td->fi_slab++;					\
+		_td->fi_slab_left--;					\
+	} while (0)
 
 /* Contains the space for proto_nodes. */
+#define PROTO_NODE_NEW(tree, node)					\
+	do {								\
+		tree_data_t *_td = PTREE_DATA(tree);			\
+		if (_td->node_slab_left == 0) {				\
+			_td->node_slab = wmem_alloc_array(PNODE_POOL(tree), \
+				proto_node, PROTO_SLAB_RECORDS);	\
+			_td->node_slab_left = PROTO_SLAB_RECORDS;	\
+		}							\
+		node = _td->node_slab++;				\
+		_td->node_slab_left--;					\
+	} while (0)
+
 #define PROTO_NODE_INIT(node)			\
 	node->first_child = NULL;		\
 	node->last_child = NULL;		\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(pool, node)			\
-	wmem_free(pool, node)
-
 /* String space for protocol and field items for the GUI */
 #define ITEM_LABEL_NEW(pool, il)			\
 	il = wmem_new(pool, item_label_t);
@@ -354,6 +387,33 @@ typedef struct _gpa_hfinfo_t {
 
 static gpa_hfinfo_t gpa_hfinfo;
 
+/* Handed out to each tree when it is created or reset; see tree_data_t.item_stamp */
+static guint32 item_stamp_counter = 0;
+
+/*
+ * Remember which protocol a field being added to a tree belongs to, so that
+ * the protocols whose items appear without the protocol having been called
+ * as a layer can be found.  This is done before an item is faked.
+ */
+static inline void
+tree_data_note_item_protocol(tree_data_t *tree_data, const header_field_info *hfinfo)
+{
+	protocol_t *protocol;
+
+	if (hfinfo->parent != -1)
+		hfinfo = gpa_hfinfo.hfi[hfinfo->parent];
+	else if (hfinfo->type != FT_PROTOCOL)
+		return;		/* e.g. text-only items */
+
+	protocol = (protocol_t *)hfinfo->strings;
+	if (protocol->item_stamp != tree_data->item_stamp) {
+		protocol->item_stamp = tree_data->item_stamp;
+		if (tree_data->item_protocols == NULL)
+			tree_data->item_protocols = g_array_new(FALSE, FALSE, sizeof(int));
+		g_array_append_val(tree_data->item_protocols, protocol->proto_id);
+	}
+}
+
 /* Hash table of abbreviations and IDs */
 static GHashTable *gpa_name_map = NULL;
 static header_field_info *same_name_hfinfo;
@@ -614,6 +674,14 @@ proto_cleanup(void)
 		deregistered_data = NULL;
 	}
 
+	g_free(interesting_slots);
+	interesting_slots     = NULL;
+	interesting_slots_len = 0;
+	if (interesting_slot_hfids) {
+		g_array_free(interesting_slot_hfids, TRUE);
+		interesting_slot_hfids = NULL;
+	}
+
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
 }
@@ -689,11 +757,46 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 	}
 }
 
+/* Returns the interesting-field slot of a field, or -1 if it has none. */
+static inline gint
+interesting_field_slot(const gint hfid)
+{
+	if ((guint)hfid >= interesting_slots_len)
+		return -1;
+	return (gint)interesting_slots[hfid] - 1;
+}
+
+/* Returns the interesting-field slot of a field, giving it one if needed. */
+static gint
+interesting_field_slot_new(const gint hfid)
+{
+	gint slot = interesting_field_slot(hfid);
+
+	if (slot >= 0)
+		return slot;
+
+	if ((guint)hfid >= interesting_slots_len) {
+		guint new_len = MAX(gpa_hfinfo.len, (guint)hfid + 1);
+
+		interesting_slots = (guint *)g_realloc(interesting_slots,
+						       new_len * sizeof(guint));
+		memset(interesting_slots + interesting_slots_len, 0,
+		       (new_len - interesting_slots_len) * sizeof(guint));
+		interesting_slots_len = new_len;
+	}
+	if (interesting_slot_hfids == NULL)
+		interesting_slot_hfids = g_array_new(FALSE, FALSE, sizeof(gint));
+
+	slot = interesting_slot_hfids->len;
+	g_array_append_val(interesting_slot_hfids, hfid);
+	interesting_slots[hfid] = slot + 1;
+
+	return slot;
+}
+
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+clear_interesting_field_ref(const gint hfid)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = GPOINTER_TO_UINT(key);
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -709,8 +812,44 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
+}
+
+/* Empties the field_info arrays of a tree's interesting fields, dropping the
+ * references the fields in them were primed with.  The arrays themselves
+ * are kept around for the next dissection. */
+static void
+tree_data_clear_interesting_fields(tree_data_t *tree_data)
+{
+	guint slot;
+
+	if (tree_data->interesting_count == 0)
+		return;
+
+	for (slot = 0; slot < tree_data->interesting_len; slot++) {
+		GPtrArray *ptrs = tree_data->interesting_ptrs[slot];
+
+		if (ptrs && ptrs->len) {
+			clear_interesting_field_ref(g_array_index(interesting_slot_hfids, gint, slot));
+			g_ptr_array_set_size(ptrs, 0);
+		}
+	}
+	tree_data->interesting_count = 0;
+}
 
-	g_ptr_array_free(ptrs, TRUE);
+static void
+tree_data_free_interesting_fields(tree_data_t *tree_data)
+{
+	guint slot;
+
+	tree_data_clear_interesting_fields(tree_data);
+
+	for (slot = 0; slot < tree_data->interesting_len; slot++) {
+		if (tree_data->interesting_ptrs[slot])
+			g_ptr_array_free(tree_data->interesting_ptrs[slot], TRUE);
+	}
+	g_free(tree_data->interesting_ptrs);
+	tree_data->interesting_ptrs = NULL;
+	tree_data->interesting_len  = 0;
 }
 
 static void
@@ -731,18 +870,22 @@ proto_tree_reset(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then remove all values. */
-		g_hash_table_remove_all(tree_data->interesting_hfids);
-	}
+	tree_data_clear_interesting_fields(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
+	/* Start over on the protocols items were added for */
+	if (tree_data->item_protocols)
+		g_array_set_size(tree_data->item_protocols, 0);
+	tree_data->item_stamp = ++item_stamp_counter;
+
+	/* The slabs belong to the packet's pool, which is about to be freed */
+	tree_data->fi_slab        = NULL;
+	tree_data->fi_slab_left   = 0;
+	tree_data->node_slab      = NULL;
+	tree_data->node_slab_left = 0;
+
 	PROTO_NODE_INIT(tree);
 }
 
@@ -755,14 +898,10 @@ proto_tree_free(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
+	tree_data_free_interesting_fields(tree_data);
 
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
-	}
+	if (tree_data->item_protocols)
+		g_array_free(tree_data->item_protocols, TRUE);
 
 	g_slice_free(tree_data_t, tree_data);
 
@@ -1795,23 +1934,28 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		GPtrArray *ptrs = NULL;
-
-		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else if (g_hash_table_size(tree_data->interesting_hfids)) {
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		gint       slot = interesting_field_slot_new(hfinfo->id);
+		GPtrArray *ptrs;
+
+		if ((guint)slot >= tree_data->interesting_len) {
+			/* Grow the array to cover every slot handed out so far */
+			guint new_len = interesting_slot_hfids->len;
+
+			tree_data->interesting_ptrs = (GPtrArray **)g_realloc(tree_data->interesting_ptrs,
+								new_len * sizeof(GPtrArray *));
+			memset(tree_data->interesting_ptrs + tree_data->interesting_len, 0,
+			       (new_len - tree_data->interesting_len) * sizeof(GPtrArray *));
+			tree_data->interesting_len = new_len;
 		}
 
+		ptrs = tree_data->interesting_ptrs[slot];
 		if (!ptrs) {
 			/* First element triggers the creation of pointer array */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			tree_data->interesting_ptrs[slot] = ptrs;
 		}
+		if (ptrs->len == 0)
+			tree_data->interesting_count++;
 
 		g_ptr_array_add(ptrs, fi);
 	}
@@ -4382,7 +4526,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	PROTO_NODE_NEW(tree, pnode);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
@@ -4661,7 +4805,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 {
 	field_info *fi;
 
-	FIELD_INFO_NEW(PNODE_POOL(tree), fi);
+	FIELD_INFO_NEW(tree, fi);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -5430,7 +5574,15 @@ proto_tree_create_root(packet_info *pinfo)
 	pnode->tree_data->pinfo = pinfo;
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->interesting_ptrs  = NULL;
+	pnode->tree_data->interesting_len   = 0;
+	pnode->tree_data->interesting_count = 0;
+
+	/* The slabs are allocated when the first item is added */
+	pnode->tree_data->fi_slab        = NULL;
+	pnode->tree_data->fi_slab_left   = 0;
+	pnode->tree_data->node_slab      = NULL;
+	pnode->tree_data->node_slab_left = 0;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -5444,6 +5596,10 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	/* Keep track of the protocols items are added for */
+	pnode->tree_data->item_protocols = NULL;
+	pnode->tree_data->item_stamp = ++item_stamp_counter;
+
 	return (proto_tree *)pnode;
 }
 
@@ -5460,6 +5616,7 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
 	hfinfo->ref_type = HF_REF_TYPE_DIRECT;
+	interesting_field_slot_new(hfid);
 	/* only increase the refcount if there is a parent.
 	   if this is a protocol and not a field then parent will be -1
 	   and there is no parent to add any refcounting for.
@@ -5704,6 +5861,7 @@ proto_register_protocol(const char *name, const char *short_name,
 	protocol->enabled_by_default = TRUE; /* see previous comment */
 	protocol->can_toggle = TRUE;
 	protocol->heur_list = NULL;
+	protocol->item_stamp = 0;
 	/* list will be sorted later by name, when all protocols completed registering */
 	protocols = g_list_prepend(protocols, protocol);
 	g_hash_table_insert(proto_filter_names, (gpointer)filter_name, protocol);
@@ -7987,27 +8145,46 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	tree_data_t *tree_data;
+	GPtrArray   *ptrs;
+	gint         slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	tree_data = PTREE_DATA(tree);
+	slot = interesting_field_slot(id);
+	if (slot < 0 || (guint)slot >= tree_data->interesting_len)
+		return NULL;
+
+	/* Empty arrays are kept for reuse; they mean the field isn't there */
+	ptrs = tree_data->interesting_ptrs[slot];
+	if (ptrs == NULL || ptrs->len == 0)
 		return NULL;
+
+	return ptrs;
+}
+
+const int *
+proto_tree_get_item_protocols(const proto_tree *tree, guint *num_protocols)
+{
+	const tree_data_t *tree_data = PTREE_DATA(tree);
+
+	if (tree_data->item_protocols == NULL) {
+		*num_protocols = 0;
+		return NULL;
+	}
+	*num_protocols = tree_data->item_protocols->len;
+	return (const int *)(void *)tree_data->item_protocols->data;
 }
 
 gboolean
 proto_tracking_interesting_fields(const proto_tree *tree)
 {
-	GHashTable *interesting_hfids;
-
 	if (!tree)
 		return FALSE;
 
-	interesting_hfids = PTREE_DATA(tree)->interesting_hfids;
-
-	return (interesting_hfids != NULL) && g_hash_table_size(interesting_hfids);
+	return PTREE_DATA(tree)->interesting_count != 0;
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -689,11 +689,19 @@ typedef struct
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    GPtrArray  **interesting_ptrs;   /**< field_info arrays of primed fields, indexed by interesting-field slot */
+    guint        interesting_len;    /**< number of entries in interesting_ptrs */
+    guint        interesting_count;  /**< number of those arrays that are not empty */
     gboolean     visible;
     gboolean     fake_protocols;
     gint         count;
     struct _packet_info *pinfo;
+    field_info  *fi_slab;            /**< next free field_info record in the current slab */
+    guint        fi_slab_left;       /**< number of free records left in that slab */
+    struct _proto_node *node_slab;   /**< next free proto_node record in the current slab */
+    guint        node_slab_left;     /**< number of free records left in that slab */
+    GArray      *item_protocols;     /**< IDs of the protocols that items were added for */
+    guint32      item_stamp;         /**< tells this dissection's item_protocols entries apart */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -934,6 +942,14 @@ void proto_tree_reset(proto_tree *tree);
  @param tree the tree to free */
 WS_DLL_PUBLIC void proto_tree_free(proto_tree *tree);
 
+/** Get the IDs of the protocols whose fields were added to the tree,
+ * whether or not the items were faked, since it was created or reset.
+ * An ID may appear more than once.
+ @param tree the tree to look at
+ @param num_protocols set to the number of IDs returned
+ @return the IDs, valid until the tree is reset or freed */
+extern const int *proto_tree_get_item_protocols(const proto_tree *tree, guint *num_protocols);
+
 /** Set the tree visible or invisible.
  Is the parsing being done for a visible proto_tree or an invisible one?
  By setting this correctly, the proto_tree creation is sped up by not
@@ -277,6 +277,8 @@ void free_stat_tables(stat_tap_table_ui* new_stat, new_stat_tap_gui_free_cb gui_
             }
             g_free(stat_table->elements[element]);
         }
+        if (new_stat->stat_tap_free_table_cb)
+            new_stat->stat_tap_free_table_cb(stat_table);
         g_free(stat_table->elements);
         g_free(stat_table);
     }
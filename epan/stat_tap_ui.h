@@ -150,6 +150,7 @@ typedef struct _stat_tap_table_ui {
     tap_param             *params;     /* pointer to table of parameter info */
     GArray                *tables;     /* An array of stat_tap_table* */
     guint                  refcount;   /* a reference count for deallocation */
+    void (* stat_tap_free_table_cb)(stat_tap_table* table); /* called for each table after its items are freed; may be NULL */
 } stat_tap_table_ui;
 
 
@@ -184,7 +185,7 @@ WS_DLL_PUBLIC void reset_stat_table(stat_tap_table_ui* new_stat, new_stat_tap_gu
  *
  * Frees data created by stat_tap_ui.stat_tap_init_cb.
  * stat_tap_table_ui.stat_tap_free_table_item_cb is called for each index in each
- * row.
+ * row, and then stat_tap_table_ui.stat_tap_free_table_cb is called for the table.
  *
  * @param new_stat Parent stat_tap_table_ui struct, provided by the dissector.
  * @param gui_callback Per-table callback, run before rows are removed.
@@ -691,6 +691,23 @@ tap_listeners_require_dissection(void)
 
 }
 
+/* Returns TRUE if any tap listener other than the one with the specified
+   tapdata needs to see dissected packets. */
+gboolean
+have_other_tap_listeners(void *tapdata)
+{
+	volatile tap_listener_t *tap_queue = tap_listener_queue;
+
+	while(tap_queue) {
+		if(tap_queue->tapdata != tapdata && !(tap_queue->flags & TL_IS_DISSECTOR_HELPER))
+			return TRUE;
+
+		tap_queue = tap_queue->next;
+	}
+
+	return FALSE;
+}
+
 /* Returns TRUE there is an active tap listener for the specified tap id. */
 gboolean
 have_tap_listener(int tap_id)
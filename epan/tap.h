@@ -230,6 +230,12 @@ WS_DLL_PUBLIC void remove_tap_listener(void *tapdata);
  */
 WS_DLL_PUBLIC gboolean tap_listeners_require_dissection(void);
 
+/**
+ * Return TRUE if there is a tap listener other than the one registered
+ * with tapdata that requires dissection, FALSE otherwise.
+ */
+WS_DLL_PUBLIC gboolean have_other_tap_listeners(void *tapdata);
+
 /** Returns TRUE there is an active tap listener for the specified tap id. */
 WS_DLL_PUBLIC gboolean have_tap_listener(int tap_id);
 
@@ -53,6 +53,9 @@ struct _wmem_allocator_t {
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
     gboolean                     in_scope;
+
+    /* Running total of bytes requested from this allocator, for profiling */
+    guint64                      bytes_requested;
 };
 
 #ifdef __cplusplus
@@ -53,6 +53,8 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
+    allocator->bytes_requested += size;
+
     return allocator->walloc(allocator->private_data, size);
 }
 
@@ -105,6 +107,8 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     g_assert(allocator->in_scope);
 
+    allocator->bytes_requested += size;
+
     return allocator->wrealloc(allocator->private_data, ptr, size);
 }
 
@@ -128,6 +132,12 @@ wmem_gc(wmem_allocator_t *allocator)
     allocator->gc(allocator->private_data);
 }
 
+guint64
+wmem_allocator_bytes_requested(wmem_allocator_t *allocator)
+{
+    return allocator->bytes_requested;
+}
+
 void
 wmem_destroy_allocator(wmem_allocator_t *allocator)
 {
@@ -154,6 +164,7 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = TRUE;
+    allocator->bytes_requested = 0;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
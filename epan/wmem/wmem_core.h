@@ -187,6 +187,17 @@ WS_DLL_PUBLIC
 void
 wmem_gc(wmem_allocator_t *allocator);
 
+/** Return the total number of bytes that have been requested from the
+ * allocator since it was created, including reallocations. This only ever
+ * grows; it is not reset by wmem_free_all() and is intended for profiling.
+ *
+ * @param allocator The allocator to query.
+ * @return The total number of bytes requested.
+ */
+WS_DLL_PUBLIC
+guint64
+wmem_allocator_bytes_requested(wmem_allocator_t *allocator);
+
 /** Destroy the given allocator, freeing all memory allocated in it. Once this
  * function has been called, no memory allocated with the allocator is valid.
  *
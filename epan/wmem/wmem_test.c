@@ -53,6 +53,7 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = TRUE;
+    allocator->bytes_requested = 0;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -61,6 +61,7 @@
 #include "frame_tvbuff.h"
 
 #include "ui/alert_box.h"
+#include "ui/frame_index.h"
 #include "ui/simple_dialog.h"
 #include "ui/main_statusbar.h"
 #include "ui/progress_dlg.h"
@@ -98,7 +99,8 @@ gboolean auto_scroll_live; /* GTK+ only? */
 static int read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
     column_info *cinfo, gint64 offset);
 
-static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
+static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect,
+    void *tapdata, const guint32 *frames, guint32 num_frames);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -288,6 +290,27 @@ ws_epan_new(capture_file *cf)
   return epan;
 }
 
+/*
+ * Names from name resolution records in the file being read.  A frame
+ * index file can't bring those back, so we don't save one for a file
+ * that has them.
+ */
+static gboolean names_from_file;
+
+static void
+cf_add_ipv4_name(const guint addr, const gchar *name)
+{
+  names_from_file = TRUE;
+  add_ipv4_name(addr, name);
+}
+
+static void
+cf_add_ipv6_name(const void *addrp, const gchar *name)
+{
+  names_from_file = TRUE;
+  add_ipv6_name((const struct e_in6_addr *)addrp, name);
+}
+
 cf_status_t
 cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_tempfile, int *err)
 {
@@ -298,6 +321,10 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   if (wth == NULL)
     goto fail;
 
+  /* Files opened here are likely to be opened again, so keep the fast
+     seek points of compressed ones around. */
+  wtap_set_save_fast_seek_index(wth, TRUE);
+
   /* The open succeeded.  Close whatever capture file we had open,
      and fill in the information for this file. */
   cf_close(cf);
@@ -369,8 +396,9 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
     ber_set_filename(cf->filename);
   }
 
-  wtap_set_cb_new_ipv4(cf->wth, add_ipv4_name);
-  wtap_set_cb_new_ipv6(cf->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+  names_from_file = FALSE;
+  wtap_set_cb_new_ipv4(cf->wth, cf_add_ipv4_name);
+  wtap_set_cb_new_ipv6(cf->wth, cf_add_ipv6_name);
 
   return CF_OK;
 
@@ -504,6 +532,45 @@ progress_is_slow(progdlg_t *progdlg, GTimer *prog_timer, gint64 size, gint64 pos
   return FALSE;
 }
 
+static guint
+cf_interface_count(capture_file *cf)
+{
+  wtapng_iface_descriptions_t *idb_inf;
+  guint                        count;
+
+  idb_inf = wtap_file_get_idb_info(cf->wth);
+  count = idb_inf->interface_data->len;
+  g_free(idb_inf);
+  return count;
+}
+
+/*
+ * Add the frames we got from the frame index file to the packet list.
+ * Nothing needed them dissected, and there's no display filter, so they
+ * are all displayed; the packet list dissects them as it shows them.
+ */
+static void
+add_indexed_frames_to_packet_list(capture_file *cf)
+{
+  guint32     framenum;
+  frame_data *fdata;
+
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->ref, cf->prev_dis);
+    cf->prev_cap = fdata;
+    fdata->flags.passed_dfilter = 1;
+    cf->displayed_count++;
+    packet_list_append(NULL, fdata);
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+}
+
 static float
 calc_progbar_val(capture_file *cf, gint64 size, gint64 file_pos, gchar *status_str, gulong status_size)
 {
@@ -550,6 +617,9 @@ cf_read(capture_file *cf, gboolean reloading)
   volatile gboolean    create_proto_tree;
   guint                tap_flags;
   gboolean             compiled;
+  gboolean             use_frame_index;
+  gboolean             from_frame_index = FALSE;
+  guint                interface_count;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -563,6 +633,14 @@ cf_read(capture_file *cf, gboolean reloading)
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() || (tap_flags & TL_REQUIRES_PROTO_TREE));
 
+  /* A frame index only holds what reading the file tells us, so it's
+     only any use if there's no read filter, and we can only skip reading
+     the file if nothing needs the frames dissected as they're read.
+     Reloading always reads the file, so that the stateful dissectors see
+     every frame in order. */
+  use_frame_index = prefs.gui_frame_index && !cf->is_tempfile && cf->rfcode == NULL;
+  interface_count = cf_interface_count(cf);
+
   reset_tap_listeners();
 
   name_ptr = g_filename_display_basename(cf->filename);
@@ -584,6 +662,12 @@ cf_read(capture_file *cf, gboolean reloading)
 
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
 
+  if (use_frame_index && !reloading && dfcode == NULL &&
+      !tap_listeners_require_dissection() && frame_index_load(cf)) {
+    add_indexed_frames_to_packet_list(cf);
+    from_frame_index = TRUE;
+  }
+
   TRY {
     int     count             = 0;
 
@@ -603,7 +687,8 @@ cf_read(capture_file *cf, gboolean reloading)
 
     g_timer_start(prog_timer);
 
-    while ((wtap_read(cf->wth, &err, &err_info, &data_offset))) {
+    /* If the frames came from the frame index, there's nothing to read. */
+    while (!from_frame_index && (wtap_read(cf->wth, &err, &err_info, &data_offset))) {
       if (size >= 0) {
         count++;
         file_pos = wtap_read_so_far(cf->wth);
@@ -692,8 +777,16 @@ cf_read(capture_file *cf, gboolean reloading)
   /* Set the file encapsulation type now; we don't know what it is until
      we've looked at all the packets, as we don't know until then whether
      there's more than one type (and thus whether it's
-     WTAP_ENCAP_PER_PACKET). */
-  cf->lnk_t = wtap_file_encap(cf->wth);
+     WTAP_ENCAP_PER_PACKET).  The frame index recorded it. */
+  if (!from_frame_index)
+    cf->lnk_t = wtap_file_encap(cf->wth);
+
+  /* Save the frames if we read the whole file, and it had nothing, such
+     as name resolution records or interfaces described after its first
+     packet, that the frame index couldn't bring back. */
+  if (use_frame_index && !from_frame_index && !cf->stop_flag && err == 0 &&
+      !names_from_file && cf_interface_count(cf) == interface_count)
+    frame_index_save(cf);
 
   cf->current_frame = frame_data_sequence_find(cf->frames, cf->first_displayed);
   cf->current_row = 0;
@@ -1419,8 +1512,9 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     return CF_OK;
 }
 
-cf_status_t
-cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
+static cf_status_t
+filter_packets(capture_file *cf, gchar *dftext, gboolean force,
+               void *tapdata, const guint32 *frames, guint32 num_frames)
 {
   const char *filter_new = dftext ? dftext : "";
   const char *filter_old = cf->dfilter ? cf->dfilter : "";
@@ -1474,9 +1568,9 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
      throwing away information constructed on a previous pass. */
   if (cf->state != FILE_CLOSED) {
     if (dftext == NULL) {
-      rescan_packets(cf, "Resetting", "Filter", FALSE);
+      rescan_packets(cf, "Resetting", "Filter", FALSE, NULL, NULL, 0);
     } else {
-      rescan_packets(cf, "Filtering", dftext, FALSE);
+      rescan_packets(cf, "Filtering", dftext, FALSE, tapdata, frames, num_frames);
     }
   }
 
@@ -1486,6 +1580,19 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
   return CF_OK;
 }
 
+cf_status_t
+cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
+{
+  return filter_packets(cf, dftext, force, NULL, NULL, 0);
+}
+
+cf_status_t
+cf_filter_frames(capture_file *cf, gchar *dftext, void *tapdata,
+                 const guint32 *frames, guint32 num_frames)
+{
+  return filter_packets(cf, dftext, TRUE, tapdata, frames, num_frames);
+}
+
 void
 cf_reftime_packets(capture_file *cf)
 {
@@ -1496,7 +1603,7 @@ void
 cf_redissect_packets(capture_file *cf)
 {
   if (cf->state != FILE_CLOSED) {
-    rescan_packets(cf, "Reprocessing", "all packets", TRUE);
+    rescan_packets(cf, "Reprocessing", "all packets", TRUE, NULL, NULL, 0);
   }
 }
 
@@ -1565,9 +1672,16 @@ cf_read_record(capture_file *cf, frame_data *fdata)
    "redissect" is TRUE if we need to make the dissectors reconstruct
    any state information they have (because a preference that affects
    some dissector has changed, meaning some dissector might construct
-   its state differently from the way it was constructed the last time). */
+   its state differently from the way it was constructed the last time).
+
+   "frames", if not NULL, is a sorted list of the only frames that can
+   possibly pass the filter, and "tapdata" the tap listener, if any, that
+   is interested in them.  If nothing else needs to see every frame, the
+   remaining frames are hidden without being dissected, as are frames
+   that an earlier dissection showed lack the protocols the filter needs. */
 static void
-rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect)
+rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect,
+               void *tapdata, const guint32 *frames, guint32 num_frames)
 {
   /* Rescan packets new packet list */
   guint32     framenum;
@@ -1589,6 +1703,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    add_to_packet_list = FALSE;
   gboolean    compiled;
   guint32     frames_count;
+  guint32     frame_idx = 0;
+  const int  *required_protos = NULL;
+  int         num_required_protos = 0;
+  gboolean    skip;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -1689,6 +1807,15 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
 
   frames_count = cf->count;
 
+  /* We can only skip frames if their dissection isn't needed to rebuild
+     state or to feed some other tap listener. */
+  if (redissect || have_other_tap_listeners(tapdata)) {
+    frames = NULL;
+  } else if (dfcode != NULL) {
+    /* Frames without any of the protocols the filter needs can't pass it. */
+    required_protos = dfilter_required_protocols(dfcode, &num_required_protos);
+  }
+
   epan_dissect_init(&edt, cf->epan, create_proto_tree, FALSE);
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
@@ -1757,9 +1884,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->flags.dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata))
-      break; /* error reading the frame */
-
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1768,10 +1892,30 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &cf->phdr,
-                                    ws_buffer_start_ptr(&cf->buf),
-                                    add_to_packet_list);
+    skip = FALSE;
+    if (frames != NULL) {
+      while (frame_idx < num_frames && frames[frame_idx] < framenum)
+        frame_idx++;
+      skip = (frame_idx == num_frames || frames[frame_idx] != framenum);
+    }
+    if (!skip && required_protos != NULL)
+      skip = !frame_may_have_protocols(fdata, required_protos, num_required_protos);
+
+    if (skip && !fdata->flags.ref_time) {
+      /* This frame can't pass the filter; don't bother dissecting it. */
+      frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                    &cf->ref, cf->prev_dis);
+      cf->prev_cap = fdata;
+      fdata->flags.passed_dfilter = 0;
+    } else {
+      if (!cf_read_record(cf, fdata))
+        break; /* error reading the frame */
+
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                      cinfo, &cf->phdr,
+                                      ws_buffer_start_ptr(&cf->buf),
+                                      add_to_packet_list);
+    }
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -2191,6 +2335,58 @@ cf_retap_packets(capture_file *cf)
   return CF_READ_OK;
 }
 
+cf_read_status_t
+cf_retap_frames(capture_file *cf, void *tapdata, const guint32 *frames,
+                guint32 num_frames)
+{
+  retap_callback_args_t callback_args;
+  gboolean              construct_protocol_tree;
+  guint                 tap_flags;
+  guint32               i;
+  frame_data           *fdata;
+  cf_read_status_t      ret = CF_READ_OK;
+
+  /* Presumably the user closed the capture file. */
+  if (cf == NULL) {
+    return CF_READ_ABORTED;
+  }
+
+  /* Anybody else listening wants to see all the packets. */
+  if (have_other_tap_listeners(tapdata)) {
+    return cf_retap_packets(cf);
+  }
+
+  cf_callback_invoke(cf_cb_file_retap_started, cf);
+
+  tap_flags = union_of_tap_listener_flags();
+  construct_protocol_tree = have_filtering_tap_listeners() ||
+                            (tap_flags & TL_REQUIRES_PROTO_TREE);
+  callback_args.cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
+
+  reset_tap_listeners();
+
+  epan_dissect_init(&callback_args.edt, cf->epan, construct_protocol_tree, FALSE);
+
+  for (i = 0; i < num_frames; i++) {
+    fdata = frame_data_sequence_find(cf->frames, frames[i]);
+    if (fdata == NULL)
+      continue;
+
+    if (!cf_read_record(cf, fdata)) {
+      /* Attempt to get the packet failed. */
+      ret = CF_READ_ERROR;
+      break;
+    }
+    retap_packet(cf, fdata, &cf->phdr, ws_buffer_start_ptr(&cf->buf), &callback_args);
+  }
+
+  epan_dissect_cleanup(&callback_args.edt);
+
+  cf_callback_invoke(cf_cb_file_retap_finished, cf);
+
+  return ret;
+}
+
 typedef struct {
   print_args_t *print_args;
   gboolean      print_header_line;
@@ -381,6 +381,21 @@ void cf_set_rfcode(capture_file *cf, dfilter_t *rfcode);
  */
 cf_status_t cf_filter_packets(capture_file *cf, gchar *dfilter, gboolean force);
 
+/**
+ * "Display Filter" packets in the capture file, when only the given frames
+ * can match the filter.  If no tap listener other than tapdata needs to
+ * see every packet, the other frames are hidden without dissecting them.
+ *
+ * @param cf the capture file
+ * @param dfilter the display filter
+ * @param tapdata the tap listener interested in the frames, or NULL
+ * @param frames sorted list of frame numbers
+ * @param num_frames number of entries in frames
+ * @return one of cf_status_t
+ */
+cf_status_t cf_filter_frames(capture_file *cf, gchar *dfilter, void *tapdata,
+                             const guint32 *frames, guint32 num_frames);
+
 /**
  * At least one "Refence Time" flag has changed, rescan all packets.
  *
@@ -408,6 +423,19 @@ void cf_redissect_packets(capture_file *cf);
  */
 cf_read_status_t cf_retap_packets(capture_file *cf);
 
+/**
+ * Run taps on the given frames only, unless a tap listener other than
+ * tapdata needs to see every packet.
+ *
+ * @param cf the capture file
+ * @param tapdata the tap listener interested in the frames
+ * @param frames sorted list of frame numbers
+ * @param num_frames number of entries in frames
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_retap_frames(capture_file *cf, void *tapdata,
+                                 const guint32 *frames, guint32 num_frames);
+
 /**
  * Adjust timestamp precision if auto is selected.
  *
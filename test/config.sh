@@ -68,6 +68,7 @@ WIRESHARK_GTK=$WS_BIN_PATH/wireshark-gtk
 TSHARK=$WS_BIN_PATH/tshark
 RAWSHARK=$WS_BIN_PATH/rawshark
 CAPINFOS=$WS_BIN_PATH/capinfos
+EDITCAP=$WS_BIN_PATH/editcap
 MERGECAP=$WS_BIN_PATH/mergecap
 TEXT2PCAP=$WS_BIN_PATH/text2pcap
 DUMPCAP=$WS_BIN_PATH/dumpcap
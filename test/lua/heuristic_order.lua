@@ -0,0 +1,27 @@
+-- test script for the order heuristic dissectors are tried in
+-- use with a capture of UDP packets that all belong to one conversation,
+-- and with the udp.try_heuristic_first preference set
+--
+-- "heur_some" accepts every fourth packet and "heur_all" accepts all of
+-- them.  heur_some is registered last, so it's tried first, unless the
+-- heuristic list gets reordered or a conversation memo makes heur_all
+-- be tried first.
+
+local heur_all = Proto("heur_all", "Heuristic test dissector accepting all packets")
+local heur_some = Proto("heur_some", "Heuristic test dissector accepting some packets")
+
+local function dissect_all(tvb, pinfo, tree)
+    tree:add(heur_all, tvb())
+    return true
+end
+
+local function dissect_some(tvb, pinfo, tree)
+    if pinfo.number % 4 ~= 0 then
+        return false
+    end
+    tree:add(heur_some, tvb())
+    return true
+end
+
+heur_all:register_heuristic("udp", dissect_all)
+heur_some:register_heuristic("udp", dissect_some)
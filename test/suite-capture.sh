@@ -426,6 +426,63 @@ capture_step_snapshot() {
 	fi
 }
 
+# capture through a TPACKET_V3 ring, which shouldn't let through anything
+# the capture filter rejects, even before the filter was attached
+capture_step_tpacket_v3_filter() {
+	if [ $SKIP_CAPTURE -ne 0 -o "$WS_SYSTEM" != "Linux" ] ; then
+		test_step_skipped
+		return
+	fi
+
+	traffic_gen_ping
+
+	date > ./testout.txt
+	$DUT -i $TRAFFIC_CAPTURE_IFACE $TRAFFIC_CAPTURE_PROMISC \
+		-w ./testout.pcap \
+		--tpacket-v3 \
+		-a duration:$TRAFFIC_CAPTURE_DURATION \
+		-f "icmp || icmp6" \
+		>> ./testout.txt 2>&1
+	RETURNVALUE=$?
+	date >> ./testout.txt
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		echo
+		capture_test_output_print ./testout.txt
+		# part of the Prerequisite checks
+		# wrong interface ? output the possible interfaces
+		$TSHARK -D
+		test_step_failed "exit status: $RETURNVALUE"
+		return
+	fi
+
+	# we should have an output file now
+	if [ ! -f "./testout.pcap" ]; then
+		test_step_failed "No output file!"
+		return
+	fi
+
+	# use tshark to filter out all packets the capture filter should have rejected
+	$TSHARK -r ./testout.pcap -w ./testout2.pcap -Y '!(icmp || icmpv6)' > ./testout.txt 2>&1
+	if [ $? -ne 0 ]; then
+		echo
+		capture_test_output_print ./testout.txt
+		test_step_failed "Problem running TShark!"
+		return
+	fi
+
+	# ok, we got a capture file, does it contain exactly 0 packets?
+	$CAPINFOS ./testout2.pcap > ./testout.txt
+	grep -Ei 'Number of packets:[[:blank:]]+0' ./testout.txt > /dev/null
+	if [ $? -eq 0 ]; then
+		test_step_ok
+	else
+		echo
+		capture_test_output_print ./testout.txt
+		test_step_failed "Capture file should contain zero packets!"
+		return
+	fi
+}
+
 wireshark_capture_suite() {
 	# k: start capture immediately
 	# WIRESHARK_QUIT_AFTER_CAPTURE needs to be set.
@@ -515,6 +572,7 @@ dumpcap_capture_suite() {
 	# read (display) filters intentionally doesn't work with dumpcap!
 	#test_step_add "Capture read filter (${TRAFFIC_CAPTURE_DURATION}s)" capture_step_read_filter
 	test_step_add "Capture snapshot length 68 bytes (${TRAFFIC_CAPTURE_DURATION}s)" capture_step_snapshot
+	test_step_add "Capture filter with --tpacket-v3 (${TRAFFIC_CAPTURE_DURATION}s)" capture_step_tpacket_v3_filter
 }
 
 capture_cleanup_step() {
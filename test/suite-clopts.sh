@@ -184,6 +184,34 @@ clopts_step_nonexisting_file() {
 }
 
 
+# --demand-dissection must give the same fields as a full dissection
+test_demand_dissection() {
+	$TSHARK -r "${CAPTURE_DIR}http.pcap" -T fields "$@" > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status: $RETURNVALUE"
+		return
+	fi
+	$TSHARK -r "${CAPTURE_DIR}http.pcap" -T fields --demand-dissection "$@" > ./testout2.txt 2> /dev/null
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status with --demand-dissection: $RETURNVALUE"
+	elif ! diff ./testout.txt ./testout2.txt > /dev/null; then
+		diff ./testout.txt ./testout2.txt
+		test_step_failed "output differs with --demand-dissection"
+	else
+		test_step_ok
+	fi
+	rm -f ./testout.txt ./testout2.txt
+}
+
+clopts_suite_tshark_demand_dissection() {
+	test_step_add "--demand-dissection with -e ip.src" "test_demand_dissection -e ip.src -e tcp.srcport"
+	test_step_add "--demand-dissection with -e frame.protocols" "test_demand_dissection -e frame.protocols"
+	test_step_add "--demand-dissection with a frame.protocols filter" "test_demand_dissection -e frame.number -Y frame.protocols~http"
+}
+
+
 # check exit status of all invalid single char TShark options (must be 1)
 clopts_suite_tshark_invalid_chars() {
 	for index in A B C E F H J K M N O R T U W X Y Z a b c d e f i j k m o r s t u w y z
@@ -371,6 +399,7 @@ clopt_suite() {
 	test_suite_add "Interface-specific TShark single char options" clopts_suite_tshark_interface_chars
 	test_suite_add "Capture filter/interface options tests" clopts_suite_tshark_capture_options
 	test_suite_add "Dump glossaries" clopts_suite_dump_glossaries
+	test_suite_add "TShark --demand-dissection" clopts_suite_tshark_demand_dissection
 	test_step_add  "Valid name resolution options -N (1s)" clopts_step_valid_name_resolving
 	#test_remark_add "Options currently unchecked: S, V, l, n, p, q and x"
 }
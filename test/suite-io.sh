@@ -143,6 +143,43 @@ io_step_rawshark_pcap_stdin() {
 }
 
 
+# write a compressed file with editcap and read it back
+io_step_compressed_round_trip() {
+	# over 1 MiB, so that Zstandard and LZ4 files have more than one frame
+	$MERGECAP -a -F pcap -w ./testout.pcap \
+		"${CAPTURE_DIR}wpa-test-decode.pcap.gz" \
+		"${CAPTURE_DIR}wpa-test-decode.pcap.gz" > ./testout.txt 2>&1
+	if [ $? -ne 0 ]; then
+		cat ./testout.txt
+		test_step_failed "mergecap failed"
+		return
+	fi
+
+	$EDITCAP --compress $1 ./testout.pcap ./testout2.pcap > ./testout.txt 2>&1
+	RETURNVALUE=$?
+	if grep -q "can't write" ./testout.txt; then
+		test_step_skipped
+		return
+	fi
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		cat ./testout.txt
+		test_step_failed "exit status of editcap: $RETURNVALUE"
+		return
+	fi
+
+	# the packets, read in order and read by seeking to them, must be
+	# the same as the ones we compressed
+	for pass in "" "-2"; do
+		$TSHARK -r ./testout.pcap $pass -x > ./testout.txt 2>&1
+		$TSHARK -r ./testout2.pcap $pass -x > ./testout2.txt 2>&1
+		if ! diff ./testout.txt ./testout2.txt > /dev/null; then
+			test_step_failed "packets differ after $1 compression ${pass:+(with $pass)}"
+			return
+		fi
+	done
+	test_step_ok
+}
+
 wireshark_io_suite() {
 	# Q: quit after cap, k: start capture immediately
 	DUT="$WIRESHARK"
@@ -169,6 +206,12 @@ dumpcap_io_suite() {
 	test_step_add "Input file" io_step_input_file
 }
 
+editcap_io_suite() {
+	test_step_add "gzip round trip" "io_step_compressed_round_trip gzip"
+	test_step_add "Zstandard round trip" "io_step_compressed_round_trip zstd"
+	test_step_add "LZ4 round trip" "io_step_compressed_round_trip lz4"
+}
+
 rawshark_io_suite() {
 	test_step_add "Rawshark pcap stdin" io_step_rawshark_pcap_stdin
 }
@@ -187,6 +230,7 @@ io_suite() {
 	test_suite_add "TShark file I/O" tshark_io_suite
 	#test_suite_add "Wireshark file I/O" wireshark_gtk_io_suite
 	#test_suite_add "Dumpcap file I/O" dumpcap_io_suite
+	test_suite_add "Editcap compressed file I/O" editcap_io_suite
 	test_suite_add "Rawshark file I/O" rawshark_io_suite
 }
 #
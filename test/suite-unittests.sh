@@ -36,6 +36,8 @@ TOOL_SEARCH_PATHS="
 	$WS_BIN_PATH
 	$SOURCE_DIR/epan
 	$SOURCE_DIR/epan/wmem
+	$SOURCE_DIR/wiretap
+	$SOURCE_DIR/wsutil
 	$SOURCE_DIR/tools
 "
 
@@ -64,6 +66,18 @@ check_dut() {
 	fi
 }
 
+unittests_step_color_filters_test() {
+	check_dut color_filters_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
+unittests_step_conversation_test() {
+	check_dut conversation_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	check_dut exntest
 	ARGS=
@@ -88,12 +102,24 @@ unittests_step_tvbtest() {
 	unittests_step_test
 }
 
+unittests_step_wiretap_test() {
+	check_dut wiretap_test
+	ARGS="--verbose ${CAPTURE_DIR}wpa-test-decode.pcap.gz ${CAPTURE_DIR}dhcp.pcap ${CAPTURE_DIR}dhcp.pcapng"
+	unittests_step_test
+}
+
 unittests_step_wmem_test() {
 	check_dut wmem_test
 	ARGS=--verbose
 	unittests_step_test
 }
 
+unittests_step_ws_memmem_test() {
+	check_dut ws_memmem_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_ftsanity() {
 	check_dut ftsanity.py
 	ARGS=$TSHARK_PATH
@@ -113,11 +139,15 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "color_filters_test" unittests_step_color_filters_test
+	test_step_add "conversation_test" unittests_step_conversation_test
 	test_step_add "exntest" unittests_step_exntest
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
+	test_step_add "wiretap_test" unittests_step_wiretap_test
 	test_step_add "wmem_test" unittests_step_wmem_test
+	test_step_add "ws_memmem_test" unittests_step_ws_memmem_test
 	test_step_add "ftsanity.py" unittests_step_ftsanity
 	test_step_add "field count" unittests_step_fieldcount
 }
@@ -461,9 +461,63 @@ wslua_step_tvb_test() {
 	fi
 }
 
+# count the packets heur_some, in heuristic_order.lua, accepts with the
+# given options
+heuristic_order_count() {
+	$TSHARK -r ./testin.pcap -X lua_script:$TESTS_DIR/lua/heuristic_order.lua \
+		-o udp.try_heuristic_first:TRUE "$@" -Y heur_some 2> testout.txt | wc -l
+}
+
+wslua_step_heuristic_order_test() {
+	if [ $HAVE_LUA -ne 0 ]; then
+		test_step_skipped
+		return
+	fi
+
+	# 3000 packets from one UDP conversation, so that the heuristic list
+	# gets reordered after 1024 of them
+	for i in `seq 3000`; do
+		echo "0000 de ad be ef"
+	done > testin.txt
+	$TEXT2PCAP -u 40000,40001 testin.txt testin.pcap > testout.txt 2>&1
+	if [ $? -ne 0 ]; then
+		cat testout.txt
+		test_step_failed "text2pcap failed"
+		return
+	fi
+
+	# heur_some is tried first, and gets every fourth packet
+	COUNT=`heuristic_order_count`
+	if [ "$COUNT" -ne 750 ]; then
+		cat testout.txt
+		test_step_failed "heur_some got $COUNT packets, expected 750"
+		return
+	fi
+
+	# heur_all has accepted more packets after 1024 lookups, so it's
+	# tried first from then on
+	COUNT=`heuristic_order_count -o protocols.heuristic_reorder:TRUE`
+	if [ "$COUNT" -ne 255 ]; then
+		cat testout.txt
+		test_step_failed "heur_some got $COUNT packets with reordering, expected 255"
+		return
+	fi
+
+	# heur_all accepted the first packet of the conversation, so it's
+	# tried first for all the others
+	COUNT=`heuristic_order_count -o protocols.heuristic_conversation_memo:TRUE`
+	if [ "$COUNT" -ne 0 ]; then
+		cat testout.txt
+		test_step_failed "heur_some got $COUNT packets with the conversation memo, expected 0"
+		return
+	fi
+	test_step_ok
+}
+
 wslua_cleanup_step() {
 	rm -f ./testout.txt
 	rm -f ./testin.txt
+	rm -f ./testin.pcap
 }
 
 wslua_suite() {
@@ -474,6 +528,7 @@ wslua_suite() {
 	test_step_add "wslua field/fieldinfo" wslua_step_field_test
 	test_step_add "wslua file" wslua_step_file_test
 	test_step_add "wslua globals" wslua_step_globals_test
+	test_step_add "wslua heuristic dissector order" wslua_step_heuristic_order_test
 	test_step_add "wslua gregex" wslua_step_gregex_test
 	test_step_add "wslua int64" wslua_step_int64_test
 	test_step_add "wslua listener" wslua_step_listener_test
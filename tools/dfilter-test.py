@@ -26,6 +26,7 @@ import types
 import unittest
 
 # Import each test class so unittest.main() can find them
+from dftestlib.bytecode import testBytecode
 from dftestlib.bytes_type import testBytes
 from dftestlib.bytes_ether import testBytesEther
 from dftestlib.bytes_ipv6 import testBytesIPv6
@@ -33,6 +34,8 @@ from dftestlib.double import testDouble
 from dftestlib.integer import testInteger
 from dftestlib.integer_1byte import testInteger1Byte
 from dftestlib.ipv4 import testIPv4
+from dftestlib.layers import testLayers
+from dftestlib.membership import testMembership
 from dftestlib.range_method import testRange
 from dftestlib.scanner import testScanner
 from dftestlib.string_type import testString
@@ -0,0 +1,105 @@
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+from dftestlib import dftest
+
+class testBytecode(dftest.DFTest):
+    """Check what the syntax tree optimizations in gencode.c compile
+    display filters to, by looking at the instructions dftest dumps."""
+
+    trace_file = "nfs.pcap"
+
+    def test_or_to_in_1(self):
+        dfilter = "ip.src == 172.25.100.14 || ip.src == 172.25.100.15 || " \
+            "ip.src == 172.25.100.16"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 1, output)
+        self.assertEqual(insns.count("ANY_EQ"), 0, output)
+        self.assertEqual(insns.count("READ_TREE"), 1, output)
+        self.assertIn("{3 values}", output)
+
+    def test_or_to_in_2(self):
+        dfilter = "ip.src in {172.25.100.14 172.25.100.15} || " \
+            "ip.src == 172.25.100.16"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 1, output)
+        self.assertEqual(insns.count("ANY_EQ"), 0, output)
+        self.assertIn("{3 values}", output)
+
+    def test_or_to_in_3(self):
+        # Still matches the same packets as the ORs did
+        dfilter = "ip.src == 172.25.100.14 || ip.src == 172.25.100.16"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_no_or_to_in_field_rhs(self):
+        dfilter = "172.25.100.14 == ip.src || 172.25.100.15 == ip.src"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 0, output)
+        self.assertEqual(insns.count("ANY_EQ"), 2, output)
+
+    def test_no_or_to_in_field_field(self):
+        dfilter = "ip.src == ip.dst || ip.src == 172.25.100.14"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 0, output)
+        self.assertEqual(insns.count("ANY_EQ"), 2, output)
+
+    def test_no_or_to_in_mixed_fields(self):
+        dfilter = "ip.src == 172.25.100.14 || ip.dst == 172.25.100.15"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 0, output)
+        self.assertEqual(insns.count("ANY_EQ"), 2, output)
+
+    def test_no_in_set_double(self):
+        # Merged into one set, but there's no hash table for floating
+        # point values, so it's tested a member at a time
+        dfilter = "ntp.rootdelay == 0.0625 || ntp.rootdelay == 0.125"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertEqual(insns.count("ANY_IN"), 0, output)
+        self.assertEqual(insns.count("ANY_EQ"), 2, output)
+
+    def test_not_not_1(self):
+        (insns, output) = self.runDFTest("!!ip")
+        self.assertEqual(insns.count("NOT"), 0, output)
+        self.assertEqual(insns.count("CHECK_EXISTS"), 1, output)
+
+    def test_not_not_2(self):
+        (insns, output) = self.runDFTest("!ip")
+        self.assertEqual(insns.count("NOT"), 1, output)
+
+    def test_not_not_3(self):
+        (insns, output) = self.runDFTest("!!!ip")
+        self.assertEqual(insns.count("NOT"), 1, output)
+
+    def test_cost_and(self):
+        # The existence test is cheaper, so it's done first
+        dfilter = "frame contains 01:02:03 && ip"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertLess(insns.index("CHECK_EXISTS"),
+            insns.index("ANY_CONTAINS"), output)
+
+    def test_cost_or(self):
+        dfilter = "frame matches \"abc\" || ip.src == 172.25.100.14"
+        (insns, output) = self.runDFTest(dfilter)
+        self.assertLess(insns.index("ANY_EQ"),
+            insns.index("ANY_MATCHES"), output)
+
+    def test_cost_same(self):
+        # Tests that cost the same are left in the order they were given
+        dfilter = "udp && tcp"
+        (insns, output) = self.runDFTest(dfilter)
+        exists = [L.split()[2] for L in output.split("\n")
+            if "CHECK_EXISTS" in L]
+        self.assertEqual(exists, ["udp", "tcp"], output)
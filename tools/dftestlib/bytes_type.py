@@ -27,3 +27,39 @@ class testBytes(dftest.DFTest):
     def test_ipv6_2(self):
         dfilter = "arp.dst.hw == 00:00"
         self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_1(self):
+        dfilter = r'arp.dst.hw matches "\\x00d"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_2(self):
+        dfilter = r'arp.dst.hw matches "\\x00e"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_3(self):
+        dfilter = r'arp.dst.hw matches "^\\x00[a-z]$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_4(self):
+        dfilter = r'arp.dst.hw matches "\\x00?d+"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_5(self):
+        dfilter = 'arp.dst.hw matches "d{2}"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_6(self):
+        dfilter = r'arp.dst.hw matches "(\\x00|\\x01)d"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_7(self):
+        dfilter = r'arp.dst.hw matches "\\x01|e"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_8(self):
+        dfilter = 'arp.dst.hw matches "d$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_9(self):
+        dfilter = 'arp.dst.hw matches "e$"'
+        self.assertDFilterCount(dfilter, 0)
@@ -24,6 +24,7 @@ from dftestlib import util
 # The binaries to use. We assume we are running
 # from the top of the wireshark distro
 TSHARK = os.path.join(os.getenv("WS_BIN_PATH", "."), "tshark")
+DFTEST = os.path.join(os.getenv("WS_BIN_PATH", "."), "dftest")
 
 class DFTest(unittest.TestCase):
     """Base class for all tests in this dfilter-test collection."""
@@ -54,23 +55,25 @@ class DFTest(unittest.TestCase):
                     pass
 
 
-    def runDFilter(self, dfilter):
+    def runDFilter(self, dfilter, two_pass=False):
         # Create the tshark command
         cmdv = [TSHARK,
                 "-n",       # No name resolution
                 "-r",       # Next arg is trace file to read
-                self.trace_file,
-                "-Y",       # packet display filter (used to be -R)
+                self.trace_file]
+        if two_pass:
+            cmdv.append("-2")   # Filter in a second pass
+        cmdv += ["-Y",      # packet display filter (used to be -R)
                 dfilter]
 
         (status, output) = util.exec_cmdv(cmdv)
         return status, output
 
 
-    def assertDFilterCount(self, dfilter, expected_count):
+    def assertDFilterCount(self, dfilter, expected_count, two_pass=False):
         """Run a display filter and expect a certain number of packets."""
 
-        (status, output) = self.runDFilter(dfilter)
+        (status, output) = self.runDFilter(dfilter, two_pass)
 
         # tshark must succeed
         self.assertEqual(status, util.SUCCESS, output)
@@ -89,3 +92,19 @@ class DFTest(unittest.TestCase):
 
         # tshark must succeed
         self.assertNotEqual(status, util.SUCCESS, output)
+
+    def runDFTest(self, dfilter):
+        """Compile a display filter with dftest and return the names
+        of the instructions it was compiled to, in order."""
+
+        (status, output) = util.exec_cmdv([DFTEST, dfilter])
+
+        # dftest must succeed
+        self.assertEqual(status, util.SUCCESS, output)
+
+        # The constants are dumped first, then the instructions, one
+        # per line, each starting with its 5-digit number
+        (constants, sep, code) = output.partition("Instructions:\n")
+        self.assertTrue(sep, output)
+        insns = [L.split()[1] for L in code.split("\n") if L != ""]
+        return insns, output
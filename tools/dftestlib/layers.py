@@ -0,0 +1,46 @@
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+from dftestlib import dftest
+
+class testLayers(dftest.DFTest):
+    """Filters on protocols whose items are added by other dissectors
+    calling their helper routines, so that they never show up as a
+    layer of the frame.  The second pass of "-2" must not skip the
+    frames they are in."""
+    trace_file = "ikev1-certs.pcap"
+
+    def test_layered_1(self):
+        dfilter = "isakmp"
+        self.assertDFilterCount(dfilter, 10)
+
+    def test_layered_2(self):
+        dfilter = "isakmp"
+        self.assertDFilterCount(dfilter, 10, two_pass=True)
+
+    def test_helper_1(self):
+        # The certificate request's CA name is dissected by
+        # dissect_x509if_Name(), called straight from ISAKMP.
+        dfilter = "x509if"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_helper_2(self):
+        dfilter = "x509if"
+        self.assertDFilterCount(dfilter, 1, two_pass=True)
+
+    def test_helper_3(self):
+        dfilter = "x509if || nfs"
+        self.assertDFilterCount(dfilter, 1, two_pass=True)
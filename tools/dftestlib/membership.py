@@ -0,0 +1,93 @@
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+from dftestlib import dftest
+
+class testMembership(dftest.DFTest):
+    """Sets of constants are looked up in a hash set; sets that
+    mix in fields, or have only one item, are compared item by item."""
+    trace_file = "nfs.pcap"
+
+    def test_single_1(self):
+        dfilter = "ip.src in {172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_ipv4_1(self):
+        dfilter = "ip.src in {172.25.100.14 10.0.0.1}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_ipv4_2(self):
+        dfilter = "ip.src in {10.0.0.1 10.0.0.2}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_ipv4_3(self):
+        dfilter = "ip.addr in {198.95.230.20 10.0.0.1}"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_netmask_1(self):
+        dfilter = "ip.src in {172.25.0.0/16 10.0.0.0/8}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_netmask_2(self):
+        dfilter = "ip.src in {172.26.0.0/16 198.95.231.0/24}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_netmask_3(self):
+        # Subnets and plain addresses in the same set
+        dfilter = "ip.src in {10.0.0.0/8 198.95.230.20 172.25.100.0/24}"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_netmask_4(self):
+        # Overlapping subnets
+        dfilter = "ip.src in {172.0.0.0/8 172.25.0.0/16 172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_integer_1(self):
+        dfilter = "udp.srcport in {1023 0x801}"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_integer_2(self):
+        dfilter = "ip.ttl in {0xfc 65}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_integer_3(self):
+        dfilter = "ip.ttl in {63 65 253}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_duplicates_1(self):
+        dfilter = "ip.src in {172.25.100.14 172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_duplicates_2(self):
+        dfilter = "udp.dstport in {2049 2049 0x801}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_duplicates_3(self):
+        dfilter = "ip.src in {172.25.0.0/16 172.25.0.0/16 172.25.100.14}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_mixed_1(self):
+        # Constants and fields in the same set
+        dfilter = "udp.srcport in {udp.dstport 1023}"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_mixed_2(self):
+        dfilter = "ip.src in {ip.dst 10.0.0.1}"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_mixed_3(self):
+        dfilter = "ip.dst in {172.25.0.0/16 ip.src}"
+        self.assertDFilterCount(dfilter, 1)
@@ -140,6 +140,106 @@ class testString(dftest.DFTest):
         dfilter = 'http.request.method contains 48:45:41:44' # "HEAD"
         self.assertDFilterCount(dfilter, 1)
 
+    def test_matches_1(self):
+        dfilter = 'http.request.method matches "^HEAD$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_2(self):
+        dfilter = 'http.request.method matches "^HEA$"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_escape_1(self):
+        dfilter = r'http.host matches "update\\.microsoft\\.com$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_escape_2(self):
+        dfilter = r'http.host matches "update\\.microsoft\\.org"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_escape_3(self):
+        dfilter = r'http.request.uri matches "\\.cab\\?\\d{10}$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_escape_4(self):
+        dfilter = r'http.request.uri matches "\\.cab\\?\\d{11}"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_escape_5(self):
+        dfilter = r'http.user_agent matches "Industry\\sUpdate\\s\\w+$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_class_1(self):
+        dfilter = r'http.host matches "^[a-z]+\\.microsoft"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_class_2(self):
+        dfilter = 'http.user_agent matches "[[:upper:]][a-z]+ Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_class_3(self):
+        dfilter = 'http.user_agent matches "Update [^C]ontrol"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_class_4(self):
+        dfilter = 'http.user_agent matches "Update []C]ontrol"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_quantifier_1(self):
+        dfilter = 'http.user_agent matches "Industx?ry"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_quantifier_2(self):
+        dfilter = 'http.user_agent matches "Industrx*y"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_quantifier_3(self):
+        dfilter = 'http.user_agent matches "Up{1,2}date"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_quantifier_4(self):
+        dfilter = 'http.user_agent matches "Up{2}date"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_quantifier_5(self):
+        dfilter = 'http.user_agent matches "Control+$"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_quantifier_6(self):
+        dfilter = 'http.user_agent matches "Controll+"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_group_1(self):
+        dfilter = 'http.user_agent matches "Industry (Update|Upgrade) Control"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_group_2(self):
+        dfilter = 'http.user_agent matches "Industry (Upgrade|Downgrade) Control"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_group_3(self):
+        dfilter = 'http.user_agent matches "In(du(s)+)try"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_group_4(self):
+        dfilter = 'http.user_agent matches "Industry (Big )?Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_group_5(self):
+        dfilter = 'http.user_agent matches "Industry (Big )+Update"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_alternation_1(self):
+        dfilter = 'http.user_agent matches "Downgrade|Update"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_matches_alternation_2(self):
+        dfilter = 'http.user_agent matches "Downgrade|Upgrade"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_matches_option_1(self):
+        dfilter = 'http.user_agent matches "(?i)industry update"'
+        self.assertDFilterCount(dfilter, 1)
+
     def test_contains_fail_0(self):
         dfilter = 'http.user_agent contains "update"'
         self.assertDFilterCount(dfilter, 0)
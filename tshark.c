@@ -40,6 +40,14 @@
 #include <signal.h>
 #endif
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
 #ifdef HAVE_LIBCAP
 # include <sys/capability.h>
 #endif
@@ -61,6 +69,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/privileges.h>
 #include <wsutil/report_err.h>
+#include <wsutil/tempfile.h>
 #include <ws_version_info.h>
 #include <wiretap/wtap_opttypes.h>
 #include <wiretap/pcapng.h>
@@ -142,6 +151,20 @@ static frame_data *prev_cap;
 static frame_data prev_cap_frame;
 
 static gboolean perform_two_pass_analysis;
+#ifndef _WIN32
+static guint second_pass_workers;
+
+/* TShark-only long option; see the comments in capture_opts.h */
+#define LONGOPT_SECOND_PASS_WORKERS (LONGOPT_DISABLE_HEURISTIC + 1)
+#endif
+
+/* TShark-only long option; see the comments in capture_opts.h */
+#define LONGOPT_PROFILE_DISSECTORS (LONGOPT_DISABLE_HEURISTIC + 2)
+#define LONGOPT_DEMAND_DISSECTION (LONGOPT_DISABLE_HEURISTIC + 3)
+#define LONGOPT_NO_READ_AHEAD (LONGOPT_DISABLE_HEURISTIC + 4)
+
+/* Don't read records in a separate thread in single-pass mode */
+static gboolean no_read_ahead;
 
 /*
  * The way the packet decode is to be written.
@@ -162,6 +185,7 @@ static gint print_summary = -1;    /* TRUE if we're to print packet summary info
 static gboolean print_details;     /* TRUE if we're to print packet details information */
 static gboolean print_hex;         /* TRUE if we're to print hex/ascci information */
 static gboolean line_buffered;
+static gboolean demand_dissection; /* TRUE if we're to dissect only as deep as needed */
 static gboolean really_quiet = FALSE;
 
 static print_format_e print_format = PR_FMT_TEXT;
@@ -291,6 +315,145 @@ list_read_capture_types(void) {
   g_free(captypes);
 }
 
+/*
+ * Print the counters gathered by --profile-dissectors.
+ */
+static void
+print_dissector_profile(void)
+{
+  GPtrArray *profiles;
+  guint      i;
+
+  profiles = dissector_profile_get();
+
+  printf("\n");
+  printf("================================================================================================================\n");
+  printf("Dissector Profile (times in microseconds)\n");
+  printf("%-16s %10s %10s %12s %12s %12s %12s %10s %10s\n",
+         "Protocol", "Calls", "Accepted", "Inclusive", "Exclusive",
+         "Bytes", "Wmem bytes", "Heur tries", "Heur hits");
+  for (i = 0; i < profiles->len; i++) {
+    const dissector_profile_t *profile = (const dissector_profile_t *)g_ptr_array_index(profiles, i);
+
+    printf("%-16s %10" G_GINT64_MODIFIER "u %10" G_GINT64_MODIFIER "u"
+           " %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u"
+           " %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u"
+           " %10" G_GINT64_MODIFIER "u %10" G_GINT64_MODIFIER "u\n",
+           proto_get_protocol_short_name(find_protocol_by_id(profile->proto_id)),
+           profile->calls, profile->accepted,
+           profile->time_inclusive, profile->time_exclusive,
+           profile->bytes, profile->wmem_bytes,
+           profile->heur_tries, profile->heur_accepts);
+  }
+  printf("================================================================================================================\n");
+
+  g_ptr_array_free(profiles, TRUE);
+
+  profiles = heur_dissector_list_stats_get();
+
+  printf("\n");
+  printf("================================================================================================================\n");
+  printf("Heuristic Dissector Lists\n");
+  printf("%-24s %12s %12s %12s %12s %12s %10s\n",
+         "List", "Lookups", "Accepts", "Memo hits", "Tries", "Skipped", "Reorders");
+  for (i = 0; i < profiles->len; i++) {
+    const heur_dissector_list_stats_t *stats = (const heur_dissector_list_stats_t *)g_ptr_array_index(profiles, i);
+
+    printf("%-24s %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u"
+           " %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u"
+           " %12" G_GINT64_MODIFIER "u %10" G_GINT64_MODIFIER "u\n",
+           stats->list_name, stats->lookups, stats->accepts,
+           stats->memo_hits, stats->tries, stats->skipped, stats->reorders);
+  }
+  printf("================================================================================================================\n");
+
+  g_ptr_array_free(profiles, TRUE);
+}
+
+/*
+ * Frame fields that are filled in from the layers the packet was
+ * dissected into, so that they'd be wrong if we stopped early.
+ */
+static const char *demand_layer_fields[] = {
+  "frame.protocols",
+  "frame.coloring_rule.name",
+  "frame.coloring_rule.string"
+};
+
+/* Returns FALSE if the field needs the packets dissected in full */
+static gboolean
+demand_field(const int hfid)
+{
+  header_field_info *hfinfo;
+  gsize              i;
+
+  hfinfo = proto_registrar_get_nth(hfid);
+  if (hfinfo == NULL)
+    return FALSE;
+  for (i = 0; i < G_N_ELEMENTS(demand_layer_fields); i++) {
+    if (strcmp(hfinfo->abbrev, demand_layer_fields[i]) == 0)
+      return FALSE;
+  }
+  dissector_demand_field(hfid);
+  return TRUE;
+}
+
+static gboolean
+demand_dfilter_fields(dfilter_t *dfcode)
+{
+  const int *fields;
+  int        num_fields;
+  int        i;
+
+  fields = dfilter_interesting_fields(dfcode, &num_fields);
+  for (i = 0; i < num_fields; i++) {
+    if (!demand_field(fields[i]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * For --demand-dissection: tell libwireshark which protocols the filters
+ * and the "-e" fields come from, so that it can stop dissecting each
+ * packet once it has reached all of them.  Returns FALSE, demanding
+ * nothing, if something else needs the packets dissected in full.
+ */
+static gboolean
+setup_demand_dissection(dfilter_t *rfcode, dfilter_t *dfcode, gboolean exporting_pdus)
+{
+  gsize i;
+
+  /* Summary lines, column fields and full trees need every layer */
+  if (print_packet_info &&
+      (output_action != WRITE_FIELDS || output_fields_has_cols(output_fields)))
+    return FALSE;
+
+  /* So do taps and PDU export */
+  if (exporting_pdus || tap_listeners_require_dissection() ||
+      (union_of_tap_listener_flags() & (TL_REQUIRES_PROTO_TREE|TL_REQUIRES_COLUMNS)))
+    return FALSE;
+
+  dissector_demand_protocol(proto_get_id_by_filter_name("frame"));
+  if ((rfcode && !demand_dfilter_fields(rfcode)) ||
+      (dfcode && !demand_dfilter_fields(dfcode))) {
+    dissector_demand_clear();
+    return FALSE;
+  }
+  if (print_packet_info) {
+    for (i = 0; i < output_fields_num_fields(output_fields); i++) {
+      header_field_info *hfinfo;
+
+      hfinfo = proto_registrar_get_byname(output_fields_get_field(output_fields, i));
+      if (hfinfo == NULL || !demand_field(hfinfo->id)) {
+        dissector_demand_clear();
+        return FALSE;
+      }
+    }
+  }
+  return TRUE;
+}
+
 static void
 print_usage(FILE *output)
 {
@@ -352,6 +515,16 @@ print_usage(FILE *output)
   fprintf(output, "                           enable dissection of heuristic protocol\n");
   fprintf(output, "  --disable-heuristic <short_name>\n");
   fprintf(output, "                           disable dissection of heuristic protocol\n");
+  fprintf(output, "  --profile-dissectors      print the time and memory each protocol's\n");
+  fprintf(output, "                           dissectors used when done\n");
+  fprintf(output, "  --demand-dissection      with -T fields, stop dissecting each packet once\n");
+  fprintf(output, "                           the protocols of the fields and filters are reached\n");
+  fprintf(output, "  --no-read-ahead          don't read the file in a separate thread\n");
+#ifndef _WIN32
+  fprintf(output, "  --second-pass-workers <count>\n");
+  fprintf(output, "                           with -2, split the second pass across count\n");
+  fprintf(output, "                           worker processes\n");
+#endif
 
   /*fprintf(output, "\n");*/
   fprintf(output, "Output:\n");
@@ -536,6 +709,12 @@ main(int argc, char *argv[])
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'v'},
     LONGOPT_CAPTURE_COMMON
+    {"profile-dissectors", no_argument, NULL, LONGOPT_PROFILE_DISSECTORS},
+    {"demand-dissection", no_argument, NULL, LONGOPT_DEMAND_DISSECTION},
+    {"no-read-ahead", no_argument, NULL, LONGOPT_NO_READ_AHEAD},
+#ifndef _WIN32
+    {"second-pass-workers", required_argument, NULL, LONGOPT_SECOND_PASS_WORKERS},
+#endif
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -1349,6 +1528,20 @@ main(int argc, char *argv[])
     case LONGOPT_DISABLE_HEURISTIC: /* disable heuristic dissection of protocol */
       disable_heur_slist = g_slist_append(disable_heur_slist, optarg);
       break;
+    case LONGOPT_PROFILE_DISSECTORS: /* count what each dissector costs */
+      dissector_profiling_enable(TRUE);
+      break;
+    case LONGOPT_DEMAND_DISSECTION: /* dissect only as deep as the fields and filters need */
+      demand_dissection = TRUE;
+      break;
+    case LONGOPT_NO_READ_AHEAD: /* read the file in the main thread */
+      no_read_ahead = TRUE;
+      break;
+#ifndef _WIN32
+    case LONGOPT_SECOND_PASS_WORKERS: /* split the second pass across processes */
+      second_pass_workers = get_positive_int(optarg, "second pass worker count");
+      break;
+#endif
 
     default:
     case '?':        /* Bad flag - print usage message */
@@ -1477,6 +1670,13 @@ main(int argc, char *argv[])
     return 1;
   }
 
+#ifndef _WIN32
+  if (second_pass_workers != 0 && !perform_two_pass_analysis) {
+    cmdarg_err("--second-pass-workers requires -2.");
+    return 1;
+  }
+#endif
+
 #ifdef HAVE_LIBPCAP
   if (list_link_layer_types) {
     /* We're supposed to list the link-layer types for an interface;
@@ -1856,6 +2056,13 @@ main(int argc, char *argv[])
       tap_listeners_require_dissection();
   tshark_debug("tshark: do_dissection = %s", do_dissection ? "TRUE" : "FALSE");
 
+  if (demand_dissection && do_dissection &&
+      !setup_demand_dissection(rfcode, dfcode, pdu_export_arg != NULL)) {
+    cmdarg_err("--demand-dissection only works with -T fields and no column fields,\n"
+               "taps, PDU export or fields that depend on every layer, such as\n"
+               "frame.protocols; dissecting packets in full.");
+  }
+
   if (cf_name) {
     tshark_debug("tshark: Opening capture file: %s", cf_name);
     /*
@@ -2022,6 +2229,8 @@ main(int argc, char *argv[])
 
   draw_tap_listeners(TRUE);
   funnel_dump_all_text_windows();
+  if (dissector_profiling_enabled())
+    print_dissector_profile();
   epan_free(cfile.epan);
   epan_cleanup();
 
@@ -2165,6 +2374,23 @@ tshark_get_frame_ts(void *data, guint32 frame_num)
   return NULL;
 }
 
+/* Names of the interfaces the read-ahead thread has handed us records
+   for, indexed by interface ID, or NULL if we're not reading ahead; the
+   thread adds interfaces to the wtap as it reads, so we can't look at
+   the wtap's list of interfaces while it's running. */
+static GPtrArray *read_ahead_interface_names;
+
+static const char *
+tshark_get_interface_name(void *data, guint32 interface_id)
+{
+  if (read_ahead_interface_names != NULL) {
+    if (interface_id < read_ahead_interface_names->len)
+      return (const char *)g_ptr_array_index(read_ahead_interface_names, interface_id);
+    return "unknown";
+  }
+  return cap_file_get_interface_name(data, interface_id);
+}
+
 static epan_t *
 tshark_epan_new(capture_file *cf)
 {
@@ -2172,7 +2398,7 @@ tshark_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = tshark_get_frame_ts;
-  epan->get_interface_name = cap_file_get_interface_name;
+  epan->get_interface_name = tshark_get_interface_name;
   epan->get_user_comment = NULL;
 
   return epan;
@@ -2710,6 +2936,7 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
      */
     if (edt && cf->dfcode) {
       if (dfilter_apply_edt(cf->dfcode, edt)) {
+        prev_dis->flags.passed_dfilter = 1;
         g_slist_foreach(edt->pi.dependent_frames, find_and_mark_frame_depended_upon, cf->frames);
       }
     }
@@ -2727,6 +2954,37 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
   return passed;
 }
 
+/*
+ * If the first pass showed that a frame has none of the protocols the
+ * display filter needs, and nothing else wants to see it, account for it
+ * as a frame that failed the filter and return TRUE, so that the second
+ * pass needn't read or dissect it.
+ */
+static gboolean
+skip_packet_second_pass(capture_file *cf, frame_data *fdata)
+{
+  const int *required_protos;
+  int        num_required_protos;
+
+  if (cf->dfcode == NULL || fdata->flags.dependent_of_displayed ||
+      tap_listeners_require_dissection())
+    return FALSE;
+
+  required_protos = dfilter_required_protocols(cf->dfcode, &num_required_protos);
+  if (required_protos == NULL ||
+      frame_may_have_protocols(fdata, required_protos, num_required_protos))
+    return FALSE;
+
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &ref, prev_dis);
+  if (ref == fdata) {
+    ref_frame = *fdata;
+    ref = &ref_frame;
+  }
+  prev_cap = fdata;
+  return TRUE;
+}
+
 static gboolean
 process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fdata,
                struct wtap_pkthdr *phdr, Buffer *buf,
@@ -2827,6 +3085,614 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
   return passed || fdata->flags.dependent_of_displayed;
 }
 
+#ifndef _WIN32
+/*
+ * A worker process running the second pass over a contiguous range of
+ * frames.
+ *
+ * Once the first pass is done, the dissectors have built the conversation,
+ * reassembly and sequence analysis state the second pass relies on, so
+ * dissecting a frame again doesn't depend on having just dissected the
+ * frames before it.  The dissection engine isn't thread-safe, so rather
+ * than using threads we fork; each worker gets a copy-on-write view of
+ * that state and its own epan_dissect_t.  The first worker prints straight
+ * to the standard output, the others print to temporary files, which we
+ * copy out in frame order as the workers finish.
+ */
+typedef struct {
+  guint32     first;        /* first frame of the range */
+  guint32     last;         /* last frame of the range */
+  frame_data *prev_dis;     /* last frame displayed before the range */
+  guint32     cum_bytes;    /* cumulative byte count before the range */
+  pid_t       pid;
+  int         out_fd;       /* temporary file, or -1 for the standard output */
+  int         status_fd;    /* read side of the pipe carrying the result */
+} second_pass_worker;
+
+/*
+ * Can the second pass be split across worker processes?  Anything a
+ * worker does other than printing packets is lost when it exits.
+ */
+static gboolean
+second_pass_workers_usable(capture_file *cf, wtap_dumper *pdh)
+{
+  if (second_pass_workers < 2 || cf->count < 2)
+    return FALSE;
+  if (pdh != NULL || !print_packet_info)
+    return FALSE;
+
+  /* Taps gather their statistics in the process that runs them. */
+  if (tap_listeners_require_dissection())
+    return FALSE;
+
+  /* So do the dissector profiling counters. */
+  if (dissector_profiling_enabled())
+    return FALSE;
+
+  /* JSON output puts a separator between packets and PostScript output
+     numbers its pages, so the output for a range depends on the ranges
+     before it. */
+  if (output_action == WRITE_JSON ||
+      (output_action == WRITE_TEXT && print_format == PR_FMT_PS))
+    return FALSE;
+  return TRUE;
+}
+
+/*
+ * Run in the worker process: dissect and print the worker's range, then
+ * send the parent the error, if any, that stopped us.  Doesn't return.
+ */
+static void
+second_pass_worker_run(capture_file *cf, epan_dissect_t *edt,
+                       second_pass_worker *worker, int status_fd,
+                       guint tap_flags)
+{
+  struct wtap_pkthdr phdr;
+  Buffer       buf;
+  frame_data  *fdata;
+  guint32      framenum;
+  int          err = 0;
+  gchar       *err_info = NULL;
+  guint32      err_info_len;
+
+  if (worker->out_fd != -1) {
+    if (dup2(worker->out_fd, 1) == -1) {
+      show_print_file_io_error(errno);
+      _exit(2);
+    }
+    ws_close(worker->out_fd);
+  }
+
+  /* We share the file position of the random-access descriptor with our
+     parent and the other workers; get a descriptor of our own. */
+  wtap_fdclose(cf->wth);
+  if (wtap_fdreopen(cf->wth, cf->filename, &err)) {
+    /* Pick up where the frames before our range left off. */
+    prev_dis = worker->prev_dis;
+    prev_cap = worker->first > 1 ?
+        frame_data_sequence_find(cf->frames, worker->first - 1) : NULL;
+    cum_bytes = worker->cum_bytes;
+
+    wtap_phdr_init(&phdr);
+    ws_buffer_init(&buf, 1500);
+    for (framenum = worker->first; framenum <= worker->last; framenum++) {
+      fdata = frame_data_sequence_find(cf->frames, framenum);
+      if (skip_packet_second_pass(cf, fdata))
+        continue;
+      if (!wtap_seek_read(cf->wth, fdata->file_off, &phdr, &buf, &err,
+                          &err_info))
+        break;
+      process_packet_second_pass(cf, edt, fdata, &phdr, &buf, tap_flags);
+    }
+    ws_buffer_free(&buf);
+    wtap_phdr_cleanup(&phdr);
+  }
+
+  if (fflush(stdout) == EOF) {
+    show_print_file_io_error(errno);
+    _exit(2);
+  }
+
+  err_info_len = err_info != NULL ? (guint32)strlen(err_info) : 0;
+  if (ws_write(status_fd, &err, sizeof err) != sizeof err ||
+      ws_write(status_fd, &err_info_len, sizeof err_info_len) != sizeof err_info_len ||
+      (err_info_len != 0 &&
+       ws_write(status_fd, err_info, err_info_len) != (ssize_t)err_info_len))
+    _exit(2);
+  _exit(0);
+}
+
+static gboolean
+second_pass_read_status(int fd, void *buf, size_t len)
+{
+  guint8  *p = (guint8 *)buf;
+  ssize_t  got;
+
+  while (len != 0) {
+    got = ws_read(fd, p, (unsigned int)len);
+    if (got == -1 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return FALSE;
+    p += got;
+    len -= got;
+  }
+  return TRUE;
+}
+
+/*
+ * Kill the workers from the given one on and clean up after them.
+ */
+static void
+second_pass_workers_stop(second_pass_worker *workers, guint from,
+                         guint num_workers)
+{
+  guint i;
+
+  for (i = from; i < num_workers; i++) {
+    if (workers[i].pid > 0) {
+      kill(workers[i].pid, SIGKILL);
+      while (waitpid(workers[i].pid, NULL, 0) == -1 && errno == EINTR)
+        ;
+    }
+    if (workers[i].status_fd != -1)
+      ws_close(workers[i].status_fd);
+    if (workers[i].out_fd != -1)
+      ws_close(workers[i].out_fd);
+  }
+}
+
+/*
+ * Copy a worker's output from its temporary file to the standard output.
+ */
+static gboolean
+second_pass_copy_output(int fd, char *copy_buf, size_t copy_buf_len)
+{
+  ssize_t got;
+
+  if (ws_lseek64(fd, 0, SEEK_SET) == -1)
+    return FALSE;
+  while ((got = ws_read(fd, copy_buf, (unsigned int)copy_buf_len)) != 0) {
+    if (got == -1) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    if (fwrite(copy_buf, 1, got, stdout) != (size_t)got)
+      return FALSE;
+  }
+  return fflush(stdout) != EOF;
+}
+
+#define SECOND_PASS_COPY_BUF_SIZE (1024 * 1024)
+
+/*
+ * Run the second pass over all frames in worker processes.  Returns 0,
+ * or the error that stopped a worker, with *err_info set as
+ * wtap_seek_read() would have set it; as with a single pass, the output
+ * then ends with the frame before the one that couldn't be read.
+ */
+static int
+second_pass_run_workers(capture_file *cf, epan_dissect_t *edt,
+                        guint tap_flags, gchar **err_info)
+{
+  second_pass_worker *workers;
+  guint        num_workers, i, j;
+  guint32      framenum;
+  frame_data  *fdata, *dis;
+  guint32      bytes;
+  int          status_pipe[2];
+  char        *tmpname;
+  char        *copy_buf;
+  int          err = 0;
+  guint32      err_info_len;
+  int          status;
+  gboolean     ok;
+
+  num_workers = MIN(second_pass_workers, cf->count);
+  workers = g_new0(second_pass_worker, num_workers);
+  for (i = 0; i < num_workers; i++) {
+    workers[i].first = (guint32)(((guint64)cf->count * i) / num_workers) + 1;
+    workers[i].last = (guint32)(((guint64)cf->count * (i + 1)) / num_workers);
+    workers[i].out_fd = -1;
+    workers[i].status_fd = -1;
+  }
+
+  /*
+   * Work out the delta-displayed time and cumulative byte state each
+   * range starts with.  The display filter results are the ones from the
+   * first pass, which is as close as we can get without dissecting the
+   * frames before the range again.
+   */
+  dis = NULL;
+  bytes = cum_bytes;
+  for (framenum = 1, i = 0; i < num_workers; framenum++) {
+    if (framenum == workers[i].first) {
+      workers[i].prev_dis = dis;
+      workers[i].cum_bytes = bytes;
+      i++;
+    }
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (cf->dfcode == NULL || fdata->flags.passed_dfilter) {
+      dis = fdata;
+      bytes = fdata->flags.ref_time ? fdata->pkt_len : bytes + fdata->pkt_len;
+    }
+  }
+
+  /* Don't let the workers print the preamble again. */
+  fflush(stdout);
+
+  for (i = 0; i < num_workers; i++) {
+    if (i != 0) {
+      workers[i].out_fd = create_tempfile(&tmpname, "tshark", NULL);
+      if (workers[i].out_fd == -1) {
+        cmdarg_err("Couldn't create a temporary file for a second pass worker: %s.",
+                   g_strerror(errno));
+        second_pass_workers_stop(workers, 0, num_workers);
+        exit(2);
+      }
+      ws_unlink(tmpname);
+    }
+    if (pipe(status_pipe) == -1 || (workers[i].pid = fork()) == -1) {
+      cmdarg_err("Couldn't start a second pass worker: %s.", g_strerror(errno));
+      second_pass_workers_stop(workers, 0, num_workers);
+      exit(2);
+    }
+    if (workers[i].pid == 0) {
+      /* Child; the other workers' descriptors are none of its business. */
+      for (j = 0; j < i; j++) {
+        ws_close(workers[j].status_fd);
+        if (workers[j].out_fd != -1)
+          ws_close(workers[j].out_fd);
+      }
+      ws_close(status_pipe[0]);
+      second_pass_worker_run(cf, edt, &workers[i], status_pipe[1], tap_flags);
+    }
+    ws_close(status_pipe[1]);
+    workers[i].status_fd = status_pipe[0];
+  }
+
+  copy_buf = (char *)g_malloc(SECOND_PASS_COPY_BUF_SIZE);
+  for (i = 0; i < num_workers; i++) {
+    /* The worker sends its status once it's done printing. */
+    ok = second_pass_read_status(workers[i].status_fd, &err, sizeof err) &&
+         second_pass_read_status(workers[i].status_fd, &err_info_len, sizeof err_info_len);
+    if (ok && err_info_len != 0) {
+      *err_info = (gchar *)g_malloc(err_info_len + 1);
+      ok = second_pass_read_status(workers[i].status_fd, *err_info, err_info_len);
+      (*err_info)[err_info_len] = '\0';
+    }
+    ws_close(workers[i].status_fd);
+    workers[i].status_fd = -1;
+    while (waitpid(workers[i].pid, &status, 0) == -1 && errno == EINTR)
+      ;
+    workers[i].pid = 0;
+
+    if (workers[i].out_fd != -1) {
+      if (!second_pass_copy_output(workers[i].out_fd, copy_buf,
+                                   SECOND_PASS_COPY_BUF_SIZE)) {
+        show_print_file_io_error(errno);
+        second_pass_workers_stop(workers, i, num_workers);
+        exit(2);
+      }
+      ws_close(workers[i].out_fd);
+      workers[i].out_fd = -1;
+    }
+
+    if (!ok) {
+      /* The worker has already reported whatever went wrong, unless it
+         was killed. */
+      if (WIFSIGNALED(status) && WTERMSIG(status) != SIGPIPE)
+        cmdarg_err("A second pass worker was terminated by signal %d.",
+                   WTERMSIG(status));
+      second_pass_workers_stop(workers, i + 1, num_workers);
+      exit(2);
+    }
+    if (err != 0) {
+      /* The frames after the one that couldn't be read don't matter. */
+      second_pass_workers_stop(workers, i + 1, num_workers);
+      break;
+    }
+  }
+  g_free(copy_buf);
+  g_free(workers);
+
+  return err;
+}
+#endif /* _WIN32 */
+
+/*
+ * Reading ahead in single-pass mode.
+ *
+ * A thread reads records into batches while we dissect and print the
+ * records of the batch before; this overlaps reading, and decompressing,
+ * the file with dissection.  The dissection and printing stay in the main
+ * thread, as the printed output is generated from the protocol tree and
+ * columns of the packet being dissected.  Nothing but the reader thread
+ * touches the wtap while it's running.
+ *
+ * Reading can also add interfaces, and, from pcapng name resolution
+ * blocks, host names.  The names are looked up in the reader thread and
+ * handed over with the batch; the host names are added to the name
+ * resolution tables in the main thread, which uses those tables while
+ * dissecting, just before the record that followed them in the file.
+ */
+#define READ_AHEAD_BATCHES     4
+#define READ_AHEAD_BATCH_SIZE  256
+
+/* A host name from a name resolution block */
+typedef struct {
+  guint        before;      /* index in the batch of the record it came before */
+  gboolean     is_ipv6;
+  guint32      ipv4_addr;
+  struct e_in6_addr ipv6_addr;
+  gchar       *name;
+} read_ahead_host;
+
+typedef struct {
+  wtap_batch  *batch;
+  GPtrArray   *new_interface_names; /* interfaces first seen in this batch */
+  GArray      *hosts;               /* read_ahead_hosts, in file order */
+  guint        next_host;
+  gboolean     done;        /* the reader thread has stopped after this batch */
+  int          err;
+  gchar       *err_info;
+} read_ahead_batch;
+
+typedef struct {
+  capture_file     *cf;
+  GThread          *thread;          /* NULL if we read in this thread */
+  GAsyncQueue      *free_batches;
+  GAsyncQueue      *full_batches;
+  read_ahead_batch *cur;             /* batch we're handing out records from */
+  guint             next;            /* next record in that batch */
+  guint             num_interfaces;  /* interfaces the reader thread has seen */
+  gint              stop;
+  read_ahead_batch  batches[READ_AHEAD_BATCHES];
+} read_ahead;
+
+/* Batch the reader thread is filling; only used by that thread */
+static read_ahead_batch *read_ahead_filling;
+
+static void
+read_ahead_add_host(read_ahead_host *host)
+{
+  host->before = read_ahead_filling->batch->count;
+  g_array_append_val(read_ahead_filling->hosts, *host);
+}
+
+static void
+read_ahead_new_ipv4(const guint addr, const gchar *name)
+{
+  read_ahead_host host;
+
+  memset(&host, 0, sizeof host);
+  host.ipv4_addr = addr;
+  host.name = g_strdup(name);
+  read_ahead_add_host(&host);
+}
+
+static void
+read_ahead_new_ipv6(const void *addrp, const gchar *name)
+{
+  read_ahead_host host;
+
+  memset(&host, 0, sizeof host);
+  host.is_ipv6 = TRUE;
+  memcpy(&host.ipv6_addr, addrp, sizeof host.ipv6_addr);
+  host.name = g_strdup(name);
+  read_ahead_add_host(&host);
+}
+
+/* Add the host names that came before the given record of the batch
+   we're handing out records from. */
+static void
+read_ahead_replay_hosts(read_ahead_batch *rab, guint before)
+{
+  read_ahead_host *host;
+
+  while (rab->next_host < rab->hosts->len) {
+    host = &g_array_index(rab->hosts, read_ahead_host, rab->next_host);
+    if (host->before > before)
+      break;
+    if (host->is_ipv6)
+      add_ipv6_name(&host->ipv6_addr, host->name);
+    else
+      add_ipv4_name(host->ipv4_addr, host->name);
+    g_free(host->name);
+    rab->next_host++;
+  }
+}
+
+static void
+read_ahead_batch_clear(read_ahead_batch *rab)
+{
+  guint i;
+
+  for (i = rab->next_host; i < rab->hosts->len; i++)
+    g_free(g_array_index(rab->hosts, read_ahead_host, i).name);
+  g_array_set_size(rab->hosts, 0);
+  rab->next_host = 0;
+  g_ptr_array_set_size(rab->new_interface_names, 0);
+}
+
+static gpointer
+read_ahead_thread(gpointer data)
+{
+  read_ahead                  *ra = (read_ahead *)data;
+  read_ahead_batch            *rab;
+  wtapng_iface_descriptions_t *idb_info;
+  guint                        num_interfaces;
+
+  do {
+    rab = (read_ahead_batch *)g_async_queue_pop(ra->free_batches);
+    if (g_atomic_int_get(&ra->stop)) {
+      rab->batch->count = 0;
+      rab->done = TRUE;
+    } else {
+      read_ahead_filling = rab;
+      wtap_read_batch(ra->cf->wth, rab->batch, &rab->err, &rab->err_info);
+      read_ahead_filling = NULL;
+
+      /* Look up the names of the interfaces that were added. */
+      idb_info = wtap_file_get_idb_info(ra->cf->wth);
+      num_interfaces = idb_info->interface_data->len;
+      g_free(idb_info);
+      while (ra->num_interfaces < num_interfaces) {
+        g_ptr_array_add(rab->new_interface_names,
+                        (gpointer)cap_file_get_interface_name(ra->cf, ra->num_interfaces));
+        ra->num_interfaces++;
+      }
+      rab->done = rab->err != 0 || rab->batch->count < rab->batch->size;
+    }
+    g_async_queue_push(ra->full_batches, rab);
+  } while (!rab->done);
+  return NULL;
+}
+
+static void
+read_ahead_start(read_ahead *ra, capture_file *cf)
+{
+  wtapng_iface_descriptions_t *idb_info;
+  guint i;
+
+  memset(ra, 0, sizeof *ra);
+  ra->cf = cf;
+  if (no_read_ahead)
+    return;
+#if !GLIB_CHECK_VERSION(2,31,0)
+  if (!g_thread_supported())
+    return;
+#endif
+  ra->free_batches = g_async_queue_new();
+  ra->full_batches = g_async_queue_new();
+  for (i = 0; i < READ_AHEAD_BATCHES; i++) {
+    ra->batches[i].batch = wtap_batch_new(READ_AHEAD_BATCH_SIZE);
+    ra->batches[i].new_interface_names = g_ptr_array_new();
+    ra->batches[i].hosts = g_array_new(FALSE, FALSE, sizeof (read_ahead_host));
+    g_async_queue_push(ra->free_batches, &ra->batches[i]);
+  }
+
+  /* The interfaces described in the file's header */
+  read_ahead_interface_names = g_ptr_array_new();
+  idb_info = wtap_file_get_idb_info(cf->wth);
+  ra->num_interfaces = idb_info->interface_data->len;
+  g_free(idb_info);
+  for (i = 0; i < ra->num_interfaces; i++)
+    g_ptr_array_add(read_ahead_interface_names, (gpointer)cap_file_get_interface_name(cf, i));
+
+  wtap_set_cb_new_ipv4(cf->wth, read_ahead_new_ipv4);
+  wtap_set_cb_new_ipv6(cf->wth, read_ahead_new_ipv6);
+#if GLIB_CHECK_VERSION(2,31,0)
+  ra->thread = g_thread_try_new("Read ahead", read_ahead_thread, ra, NULL);
+#else
+  ra->thread = g_thread_create(read_ahead_thread, ra, TRUE, NULL);
+#endif
+  if (ra->thread == NULL) {
+    /* Read in this thread instead. */
+    wtap_set_cb_new_ipv4(cf->wth, add_ipv4_name);
+    wtap_set_cb_new_ipv6(cf->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+    g_ptr_array_free(read_ahead_interface_names, TRUE);
+    read_ahead_interface_names = NULL;
+    for (i = 0; i < READ_AHEAD_BATCHES; i++) {
+      wtap_batch_free(ra->batches[i].batch);
+      g_ptr_array_free(ra->batches[i].new_interface_names, TRUE);
+      g_array_free(ra->batches[i].hosts, TRUE);
+    }
+    g_async_queue_unref(ra->free_batches);
+    g_async_queue_unref(ra->full_batches);
+  }
+}
+
+/*
+ * Get the next record; it stays valid until the next call.  Returns FALSE
+ * at the end of the file or on a read error, with *err and *err_info set
+ * as wtap_read() would set them.
+ */
+static gboolean
+read_ahead_next(read_ahead *ra, gint64 *data_offset,
+                struct wtap_pkthdr **phdr, guint8 **pd,
+                int *err, gchar **err_info)
+{
+  wtap_batch_rec *rec;
+  guint           i;
+
+  if (ra->thread == NULL) {
+    if (!wtap_read(ra->cf->wth, err, err_info, data_offset))
+      return FALSE;
+    *phdr = wtap_phdr(ra->cf->wth);
+    *pd = wtap_buf_ptr(ra->cf->wth);
+    return TRUE;
+  }
+
+  for (;;) {
+    if (ra->cur != NULL) {
+      read_ahead_replay_hosts(ra->cur, ra->next);
+      if (ra->next < ra->cur->batch->count) {
+        rec = &ra->cur->batch->recs[ra->next];
+        ra->next++;
+        *data_offset = rec->data_offset;
+        *phdr = &rec->phdr;
+        *pd = ws_buffer_start_ptr(&rec->buf);
+        return TRUE;
+      }
+      if (ra->cur->done) {
+        *err = ra->cur->err;
+        *err_info = ra->cur->err_info;
+        ra->cur->err = 0;
+        ra->cur->err_info = NULL;
+        ra->next = 0;
+        ra->cur->batch->count = 0;
+        return FALSE;
+      }
+      read_ahead_batch_clear(ra->cur);
+      g_async_queue_push(ra->free_batches, ra->cur);
+    }
+    ra->cur = (read_ahead_batch *)g_async_queue_pop(ra->full_batches);
+    ra->next = 0;
+    for (i = 0; i < ra->cur->new_interface_names->len; i++)
+      g_ptr_array_add(read_ahead_interface_names,
+                      g_ptr_array_index(ra->cur->new_interface_names, i));
+  }
+}
+
+/*
+ * Stop the reader thread, if we haven't read everything it has to give,
+ * and free everything.
+ */
+static void
+read_ahead_stop(read_ahead *ra)
+{
+  guint i;
+
+  if (ra->thread == NULL)
+    return;
+
+  /* Hand batches back until the thread notices it's to stop. */
+  g_atomic_int_set(&ra->stop, 1);
+  while (ra->cur == NULL || !ra->cur->done) {
+    if (ra->cur != NULL)
+      g_async_queue_push(ra->free_batches, ra->cur);
+    ra->cur = (read_ahead_batch *)g_async_queue_pop(ra->full_batches);
+  }
+  g_thread_join(ra->thread);
+  ra->thread = NULL;
+  g_ptr_array_free(read_ahead_interface_names, TRUE);
+  read_ahead_interface_names = NULL;
+  wtap_set_cb_new_ipv4(ra->cf->wth, add_ipv4_name);
+  wtap_set_cb_new_ipv6(ra->cf->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+
+  for (i = 0; i < READ_AHEAD_BATCHES; i++) {
+    wtap_batch_free(ra->batches[i].batch);
+    read_ahead_batch_clear(&ra->batches[i]);
+    g_ptr_array_free(ra->batches[i].new_interface_names, TRUE);
+    g_array_free(ra->batches[i].hosts, TRUE);
+    g_free(ra->batches[i].err_info);
+  }
+  g_async_queue_unref(ra->free_batches);
+  g_async_queue_unref(ra->full_batches);
+}
+
 static int
 load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3037,8 +3903,20 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
     }
 
-    for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
+    framenum = 1;
+#ifndef _WIN32
+    if (second_pass_workers_usable(cf, pdh)) {
+      tshark_debug("tshark: running the second pass in %u workers", second_pass_workers);
+      err = second_pass_run_workers(cf, edt, tap_flags, &err_info);
+      framenum = cf->count + 1;
+    }
+#endif
+    for (; err == 0 && framenum <= cf->count; framenum++) {
       fdata = frame_data_sequence_find(cf->frames, framenum);
+      if (skip_packet_second_pass(cf, fdata)) {
+        tshark_debug("tshark: frame #%d can't match the display filter", framenum);
+        continue;
+      }
       if (wtap_seek_read(cf->wth, fdata->file_off, &phdr, &buf, &err,
                          &err_info)) {
         tshark_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
@@ -3141,6 +4019,10 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   }
   else {
     /* !perform_two_pass_analysis */
+    read_ahead          ra;
+    struct wtap_pkthdr *whdr;
+    guint8             *pd;
+
     framenum = 0;
 
     tshark_debug("tshark: perform one pass analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
@@ -3163,20 +4045,19 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
     }
 
-    while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+    read_ahead_start(&ra, cf);
+    while (read_ahead_next(&ra, &data_offset, &whdr, &pd, &err, &err_info)) {
       framenum++;
 
       tshark_debug("tshark: processing packet #%d", framenum);
 
-      if (process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth),
-                         tap_flags)) {
+      if (process_packet(cf, edt, data_offset, whdr, pd, tap_flags)) {
         /* Either there's no read filtering or this packet passed the
            filter, so, if we're writing to a capture file, write
            this packet out. */
         if (pdh != NULL) {
           tshark_debug("tshark: writing packet #%d to outfile", framenum);
-          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth), &err, &err_info)) {
+          if (!wtap_dump(pdh, whdr, pd, &err, &err_info)) {
             /* Error writing to a capture file */
             tshark_debug("tshark: error writing to a capture file (%d)", err);
             switch (err) {
@@ -3254,6 +4135,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
         break;
       }
     }
+    read_ahead_stop(&ra);
 
     if (edt) {
       epan_dissect_free(edt);
@@ -3905,6 +4787,9 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   gchar *err_info;
   char   err_msg[2048+1];
 
+  /* Decompress compressed files while we dissect. */
+  wtap_set_readahead(TRUE);
+
   wth = wtap_open_offline(fname, type, err, &err_info, perform_two_pass_analysis);
   if (wth == NULL)
     goto fail;
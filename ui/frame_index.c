@@ -0,0 +1,305 @@
+/* frame_index.c
+ * Saving the frames of a capture file, so that it needn't be read again
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
+
+#include <epan/frame_data.h>
+#include <epan/frame_data_sequence.h>
+
+#include "frame_index.h"
+
+/*
+ * Index files are a cache local to this machine, so they're written in
+ * host byte order; the magic number tells us if that's not ours.
+ */
+#define FRAME_INDEX_DIR         "frame-index"
+#define FRAME_INDEX_SUFFIX      ".fidx"
+#define FRAME_INDEX_MAGIC       0x57534658      /* "WSFX" */
+#define FRAME_INDEX_VERSION     1
+#define FRAME_INDEX_MAX_TOTAL   (G_GINT64_CONSTANT(2) * 1024 * 1024 * 1024)
+
+struct frame_index_hdr {
+    guint32 magic;
+    guint32 version;
+    gint64  file_size;          /* size of the capture file */
+    gint64  file_mtime;         /* modification time of the capture file */
+    gint32  file_type_subtype;  /* WTAP_FILE_TYPE_SUBTYPE_ of the capture file */
+    gint32  file_encap;         /* WTAP_ENCAP_ of the capture file */
+    guint32 count;              /* number of frames */
+    guint32 encap_count;        /* number of link-layer types */
+    /* followed by encap_count gint32 link-layer types, then the frames */
+};
+
+#define FRAME_INDEX_HAS_TS          0x0001
+#define FRAME_INDEX_HAS_COMMENT     0x0002
+
+struct frame_index_rec {
+    gint64  file_off;
+    gint64  ts_secs;
+    gint32  ts_nsecs;
+    guint32 pkt_len;
+    guint32 cap_len;
+    gint16  tsprec;
+    guint16 flags;              /* FRAME_INDEX_ flags */
+};
+
+static gboolean
+frame_index_stat(const capture_file *cf, gint64 *size, gint64 *mtime)
+{
+    ws_statb64 st;
+
+    if (ws_stat64(cf->filename, &st) == -1 || !S_ISREG(st.st_mode))
+        return FALSE;
+    *size = (gint64)st.st_size;
+    *mtime = (gint64)st.st_mtime;
+    return TRUE;
+}
+
+/* Directory that index files are kept in; the result must be g_free()d */
+static gchar *
+frame_index_dir(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "wireshark",
+                            FRAME_INDEX_DIR, NULL);
+}
+
+/* Path of the index file for a capture file; the result must be g_free()d */
+static gchar *
+frame_index_path(const capture_file *cf)
+{
+    gchar *abs_path, *cwd, *hash, *name, *dir, *index_path;
+
+    if (g_path_is_absolute(cf->filename)) {
+        abs_path = g_strdup(cf->filename);
+    } else {
+        cwd = g_get_current_dir();
+        abs_path = g_build_filename(cwd, cf->filename, NULL);
+        g_free(cwd);
+    }
+    hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, abs_path, -1);
+    g_free(abs_path);
+    name = g_strconcat(hash, FRAME_INDEX_SUFFIX, NULL);
+    g_free(hash);
+    dir = frame_index_dir();
+    index_path = g_build_filename(dir, name, NULL);
+    g_free(dir);
+    g_free(name);
+    return index_path;
+}
+
+gboolean
+frame_index_load(capture_file *cf)
+{
+    struct frame_index_hdr  hdr;
+    struct frame_index_rec  rec;
+    struct wtap_pkthdr      phdr;
+    gint64                  size, mtime;
+    gchar                  *index_path;
+    FILE                   *fp;
+    GArray                 *linktypes;
+    frame_data_sequence    *frames;
+    frame_data              fdlocal;
+    guint64                 comment_count = 0;
+    gint64                  datalen = 0;
+    guint32                 cum_bytes = 0;
+    gint32                  encap;
+    guint32                 i;
+
+    if (cf->count != 0 || !frame_index_stat(cf, &size, &mtime))
+        return FALSE;
+
+    index_path = frame_index_path(cf);
+    fp = ws_fopen(index_path, "rb");
+    if (fp == NULL) {
+        g_free(index_path);
+        return FALSE;
+    }
+
+    if (fread(&hdr, sizeof hdr, 1, fp) != 1 ||
+        hdr.magic != FRAME_INDEX_MAGIC ||
+        hdr.version != FRAME_INDEX_VERSION ||
+        hdr.file_size != size || hdr.file_mtime != mtime ||
+        hdr.file_type_subtype != cf->cd_t ||
+        hdr.count == 0 || hdr.encap_count == 0) {
+        fclose(fp);
+        g_free(index_path);
+        return FALSE;
+    }
+
+    linktypes = g_array_sized_new(FALSE, FALSE, (guint) sizeof(int), hdr.encap_count);
+    for (i = 0; i < hdr.encap_count; i++) {
+        if (fread(&encap, sizeof encap, 1, fp) != 1)
+            goto fail;
+        g_array_append_val(linktypes, encap);
+    }
+
+    /* Build the frames exactly as reading the records would have */
+    frames = new_frame_data_sequence();
+    memset(&phdr, 0, sizeof phdr);
+    for (i = 1; i <= hdr.count; i++) {
+        if (fread(&rec, sizeof rec, 1, fp) != 1) {
+            free_frame_data_sequence(frames);
+            goto fail;
+        }
+        phdr.presence_flags = (rec.flags & FRAME_INDEX_HAS_TS) ? WTAP_HAS_TS : 0;
+        phdr.ts.secs = (time_t)rec.ts_secs;
+        phdr.ts.nsecs = rec.ts_nsecs;
+        phdr.len = rec.pkt_len;
+        phdr.caplen = rec.cap_len;
+        phdr.pkt_tsprec = rec.tsprec;
+        frame_data_init(&fdlocal, i, &phdr, rec.file_off, cum_bytes);
+        fdlocal.flags.has_phdr_comment = (rec.flags & FRAME_INDEX_HAS_COMMENT) ? 1 : 0;
+        frame_data_sequence_add(frames, &fdlocal);
+
+        cum_bytes = fdlocal.cum_bytes;
+        if (fdlocal.flags.has_phdr_comment)
+            comment_count++;
+        datalen = rec.file_off + rec.cap_len;
+    }
+    fclose(fp);
+
+#if GLIB_CHECK_VERSION(2,18,0)
+    /* mark it as recently used, so that it's the last to be removed */
+    g_utime(index_path, NULL);
+#endif
+    g_free(index_path);
+
+    free_frame_data_sequence(cf->frames);
+    cf->frames = frames;
+    cf->count = hdr.count;
+    g_array_free(cf->linktypes, TRUE);
+    cf->linktypes = linktypes;
+    cf->lnk_t = hdr.file_encap;
+    cf->packet_comment_count = comment_count;
+    cf->f_datalen = datalen;
+    return TRUE;
+
+fail:
+    g_array_free(linktypes, TRUE);
+    fclose(fp);
+    g_free(index_path);
+    return FALSE;
+}
+
+void
+frame_index_save(capture_file *cf)
+{
+    struct frame_index_hdr  hdr;
+    struct frame_index_rec  rec;
+    gchar                  *index_dir, *index_path, *tmp_path;
+    FILE                   *fp;
+    frame_data             *fdata;
+    gboolean                ok;
+    gint32                  encap;
+    guint32                 i;
+
+    if (cf->count == 0 || cf->linktypes == NULL || cf->linktypes->len == 0)
+        return;
+
+    /* Don't write an index that would be removed again straight away */
+    if ((gint64)sizeof hdr + cf->linktypes->len * (gint64)sizeof encap +
+        cf->count * (gint64)sizeof rec > FRAME_INDEX_MAX_TOTAL)
+        return;
+
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = FRAME_INDEX_MAGIC;
+    hdr.version = FRAME_INDEX_VERSION;
+    if (!frame_index_stat(cf, &hdr.file_size, &hdr.file_mtime))
+        return;
+    hdr.file_type_subtype = cf->cd_t;
+    hdr.file_encap = cf->lnk_t;
+    hdr.count = cf->count;
+    hdr.encap_count = cf->linktypes->len;
+
+    /*
+     * Write to a temporary file and rename it, so that nobody sees
+     * a partial index.  If we can't write to the cache directory,
+     * we just don't save the index.
+     */
+    index_dir = frame_index_dir();
+    if (g_mkdir_with_parents(index_dir, 0700) == -1) {
+        g_free(index_dir);
+        return;
+    }
+    index_path = frame_index_path(cf);
+    tmp_path = g_strconcat(index_path, ".tmp", NULL);
+    fp = ws_fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        g_free(tmp_path);
+        g_free(index_path);
+        g_free(index_dir);
+        return;
+    }
+
+    ok = fwrite(&hdr, sizeof hdr, 1, fp) == 1;
+    for (i = 0; ok && i < cf->linktypes->len; i++) {
+        encap = g_array_index(cf->linktypes, gint, i);
+        ok = fwrite(&encap, sizeof encap, 1, fp) == 1;
+    }
+    memset(&rec, 0, sizeof rec);
+    for (i = 1; ok && i <= cf->count; i++) {
+        fdata = frame_data_sequence_find(cf->frames, i);
+        rec.file_off = fdata->file_off;
+        rec.ts_secs = (gint64)fdata->abs_ts.secs;
+        rec.ts_nsecs = fdata->abs_ts.nsecs;
+        rec.pkt_len = fdata->pkt_len;
+        rec.cap_len = fdata->cap_len;
+        rec.tsprec = fdata->tsprec;
+        rec.flags = 0;
+        if (fdata->flags.has_ts)
+            rec.flags |= FRAME_INDEX_HAS_TS;
+        if (fdata->flags.has_phdr_comment)
+            rec.flags |= FRAME_INDEX_HAS_COMMENT;
+        ok = fwrite(&rec, sizeof rec, 1, fp) == 1;
+    }
+    if (fclose(fp) != 0)
+        ok = FALSE;
+    if (!ok || ws_rename(tmp_path, index_path) != 0)
+        ws_unlink(tmp_path);
+    else
+        trim_cache_dir(index_dir, FRAME_INDEX_SUFFIX, FRAME_INDEX_MAX_TOTAL);
+    g_free(tmp_path);
+    g_free(index_path);
+    g_free(index_dir);
+}
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,86 @@
+/* frame_index.h
+ * Saving the frames of a capture file, so that it needn't be read again
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include "cfile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ *  Frame index files.
+ *
+ *  A frame index file holds what reading a capture file tells us about
+ *  each of its frames: the offset, lengths, time stamp and flags that
+ *  frame_data_init() fills in from the record header, along with the
+ *  link-layer types of the file.  Nothing that depends on dissection, and
+ *  so on the dissector preferences, is saved.  Index files go in a
+ *  "wireshark/frame-index" directory in the user's cache directory, are
+ *  named after a hash of the capture file's absolute path, and record the
+ *  size, modification time and file type of the capture file, and are
+ *  ignored if any of those have changed.
+ */
+
+/** Fill in the frames of a capture file that has just been opened, and
+ *  that nothing has been read from yet, from its frame index file.
+ *
+ *  On success, cf->frames, cf->count, cf->linktypes, cf->lnk_t,
+ *  cf->packet_comment_count and cf->f_datalen are set as reading the
+ *  whole file would have set them; the frames haven't been added to the
+ *  packet list, and haven't been dissected.
+ *
+ *  @param cf The capture file
+ *  @return TRUE if there was an up-to-date index file, FALSE otherwise,
+ *  in which case the capture file is left alone.
+ */
+gboolean frame_index_load(capture_file *cf);
+
+/** Save the frames of a capture file that has been read from start to
+ *  end, without a read filter, in its frame index file.  The index
+ *  files are kept under a total size by removing the least recently
+ *  used ones.  Errors are ignored; there's just no index file.
+ *
+ *  @param cf The capture file
+ */
+void frame_index_save(capture_file *cf);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
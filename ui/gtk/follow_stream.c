@@ -172,7 +172,10 @@ static void follow_stream_cb(register_follow_t* follower, follow_read_stream_fun
     gtk_follow_info_t *gtk_follow_info;
     GString *msg;
     gboolean is_follow = FALSE;
-    guint32 ignore_stream;
+    int stream_num = -1;
+    follow_stream_frames_func stream_frames;
+    const guint32 *frames = NULL;
+    guint32 num_frames = 0;
     char  stream_window_title[256];
 
     is_follow = proto_is_frame_protocol(cfile.edt->pi.layers, proto_get_protocol_filter_name(get_follow_proto_id(follower)));
@@ -191,7 +194,7 @@ static void follow_stream_cb(register_follow_t* follower, follow_read_stream_fun
 
     /* Create a new filter that matches all packets in the TCP stream,
        and set the display filter entry accordingly */
-    follow_filter = get_follow_conv_func(follower)(&cfile.edt->pi, &ignore_stream);
+    follow_filter = get_follow_conv_func(follower)(&cfile.edt->pi, &stream_num);
     if (!follow_filter) {
         simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
                       "Error creating filter for this stream.\n"
@@ -243,8 +246,17 @@ static void follow_stream_cb(register_follow_t* follower, follow_read_stream_fun
     gtk_entry_set_text(GTK_ENTRY(filter_te), follow_filter);
 
     /* Run the display filter so it goes in effect - even if it's the
-       same as the previous display filter. */
-    main_filter_packets(&cfile, follow_filter, TRUE);
+       same as the previous display filter.  If the follower knows which
+       frames are in the stream, only dissect those. */
+    stream_frames = get_follow_stream_frames_func(follower);
+    if (stream_frames && stream_num >= 0)
+        num_frames = stream_frames(stream_num, &frames);
+    if (num_frames > 0) {
+        cf_filter_frames(&cfile, follow_filter, follow_info, frames, num_frames);
+        main_filter_packets(&cfile, follow_filter, FALSE);
+    } else {
+        main_filter_packets(&cfile, follow_filter, TRUE);
+    }
 
     remove_tap_listener(follow_info);
 
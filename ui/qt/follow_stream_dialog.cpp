@@ -940,8 +940,22 @@ bool FollowStreamDialog::follow(QString previous_filter, bool use_stream_index,
     updateWidgets(true);
 
     /* Run the display filter so it goes in effect - even if it's the
-       same as the previous display filter. */
-    emit updateFilter(follow_filter, TRUE);
+       same as the previous display filter.  If the follower knows which
+       frames are in the stream, only dissect those. */
+    follow_stream_frames_func stream_frames = get_follow_stream_frames_func(follower_);
+    const guint32 *frames = NULL;
+    guint32 num_frames = 0;
+
+    if (stream_frames && stream_num >= 0) {
+        num_frames = stream_frames(stream_num, &frames);
+    }
+    if (num_frames > 0) {
+        cf_filter_frames(cap_file_.capFile(), follow_filter.toUtf8().data(),
+                         &follow_info_, frames, num_frames);
+        emit updateFilter(follow_filter, FALSE);
+    } else {
+        emit updateFilter(follow_filter, TRUE);
+    }
 
     removeTapListeners();
 
@@ -33,6 +33,7 @@
 #include <epan/epan_dissect.h>
 #include <epan/packet.h>
 #include <epan/tap.h>
+#include <epan/follow.h>
 
 #include <epan/dissectors/packet-tcp.h>
 
@@ -118,6 +119,10 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
     struct segment current;
     GString    *error_string;
     tcp_scan_t  ts;
+    register_follow_t *follower;
+    follow_stream_frames_func stream_frames;
+    const guint32 *frames = NULL;
+    guint32     num_frames = 0;
 
     g_log(NULL, G_LOG_LEVEL_DEBUG, "graph_segment_list_get()");
 
@@ -156,7 +161,17 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
         g_string_free(error_string, TRUE);
         exit(1);   /* XXX: fix this */
     }
-    cf_retap_packets(cf);
+    /* Only the frames of the stream are interesting, so if TCP has
+     * indexed them there is no need to look at the others.
+     */
+    follower = get_follow_by_name("TCP");
+    stream_frames = follower ? get_follow_stream_frames_func(follower) : NULL;
+    if (stream_frames)
+        num_frames = stream_frames(tg->stream, &frames);
+    if (num_frames > 0)
+        cf_retap_frames(cf, &ts, frames, num_frames);
+    else
+        cf_retap_packets(cf);
     remove_tap_listener(&ts);
 }
 
@@ -697,6 +697,18 @@ heuristic_uses_extension(unsigned int i, const char *extension)
 	return FALSE;	/* it's not one of them */
 }
 
+/*
+ * Whether to decompress compressed files, while reading them sequentially,
+ * in a separate thread.
+ */
+static gboolean readahead = FALSE;
+
+void
+wtap_set_readahead(gboolean enable)
+{
+	readahead = enable;
+}
+
 /* Opens a file and prepares a wtap struct.
    If "do_random" is TRUE, it opens the file twice; the second open
    allows the application to do random-access I/O without moving
@@ -815,6 +827,7 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 			g_free(wth);
 			return NULL;
 		}
+		file_set_readahead(wth->fh, readahead);
 	}
 
 	if (do_random) {
@@ -829,6 +842,7 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 
 	/* initialization */
 	wth->file_encap = WTAP_ENCAP_UNKNOWN;
+	wth->subtype_read_batch = NULL;
 	wth->subtype_sequential_close = NULL;
 	wth->subtype_close = NULL;
 	wth->file_tsprec = WTAP_TSPREC_USEC;
@@ -2151,17 +2165,17 @@ wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment_types)
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err);
 
-static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
-static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
+static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename, int *err);
+static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd, int *err);
 static int wtap_dump_file_close(wtap_dumper *wdh);
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
                       GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                       GArray* nrb_hdrs, int *err)
 {
@@ -2171,11 +2185,11 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2218,37 +2232,33 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 wtap_dumper *
 wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-	       int snaplen, gboolean compressed, int *err)
+	       int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-		  int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		  int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		  GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
 
-	/* In case "fopen()" fails but doesn't set "errno", set "errno"
-	   to a generic "the open failed" error. */
-	errno = WTAP_ERR_CANT_OPEN;
-	fh = wtap_dump_file_open(wdh, filename);
+	fh = wtap_dump_file_open(wdh, filename, err);
 	if (fh == NULL) {
-		*err = errno;
 		g_free(wdh);
 		return NULL;	/* can't create file */
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2262,15 +2272,15 @@ wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 wtap_dumper *
 wtap_dump_open_tempfile(char **filenamep, const char *pfx,
 			int file_type_subtype, int encap,
-			int snaplen, gboolean compressed, int *err)
+			int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_tempfile_ng(filenamep, pfx, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 			   int file_type_subtype, int encap,
-			   int snaplen, gboolean compressed,
+			   int snaplen, wtap_compression_type compression_type,
 			   GArray* shb_hdrs,
 			   wtapng_iface_descriptions_t *idb_inf,
 			   GArray* nrb_hdrs, int *err)
@@ -2284,7 +2294,7 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	*filenamep = NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2298,19 +2308,15 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 	}
 	*filenamep = tmpname;
 
-	/* In case "fopen()" fails but doesn't set "errno", set "errno"
-	   to a generic "the open failed" error. */
-	errno = WTAP_ERR_CANT_OPEN;
-	fh = wtap_dump_file_fdopen(wdh, fd);
+	fh = wtap_dump_file_fdopen(wdh, fd, err);
 	if (fh == NULL) {
-		*err = errno;
 		ws_close(fd);
 		g_free(wdh);
 		return NULL;	/* can't create file */
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		wtap_dump_file_close(wdh);
@@ -2323,37 +2329,33 @@ wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
 
 wtap_dumper *
 wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-		 gboolean compressed, int *err)
+		 wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-		    gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+		    wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
 		    GArray* nrb_hdrs, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
 
-	/* In case "fopen()" fails but doesn't set "errno", set "errno"
-	   to a generic "the open failed" error. */
-	errno = WTAP_ERR_CANT_OPEN;
-	fh = wtap_dump_file_fdopen(wdh, fd);
+	fh = wtap_dump_file_fdopen(wdh, fd, err);
 	if (fh == NULL) {
-		*err = errno;
 		g_free(wdh);
 		return NULL;	/* can't create standard I/O stream */
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2363,14 +2365,14 @@ wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 
 wtap_dumper *
 wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-		      gboolean compressed, int *err)
+		      wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compressed, NULL, NULL, NULL, err);
+	return wtap_dump_open_stdout_ng(file_type_subtype, encap, snaplen, compression_type, NULL, NULL, NULL, err);
 }
 
 wtap_dumper *
 wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-			 gboolean compressed, GArray* shb_hdrs,
+			 wtap_compression_type compression_type, GArray* shb_hdrs,
 			 wtapng_iface_descriptions_t *idb_inf,
 			 GArray* nrb_hdrs, int *err)
 {
@@ -2378,7 +2380,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 	WFILE_T fh;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdrs, idb_inf, nrb_hdrs, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2398,19 +2400,15 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 	}
 #endif
 
-	/* In case "fopen()" fails but doesn't set "errno", set "errno"
-	   to a generic "the open failed" error. */
-	errno = WTAP_ERR_CANT_OPEN;
-	fh = wtap_dump_file_fdopen(wdh, 1);
+	fh = wtap_dump_file_fdopen(wdh, 1, err);
 	if (fh == NULL) {
-		*err = errno;
 		g_free(wdh);
 		return NULL;	/* can't create standard I/O stream */
 	}
 	wdh->fh = fh;
 	wdh->is_stdout = TRUE;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2419,7 +2417,7 @@ wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
 }
 
 static gboolean
-wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2442,8 +2440,11 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support this for this file_type_subtype,
+	   and was this type of compression built in? */
+	if(compression_type != WTAP_UNCOMPRESSED &&
+	   (!wtap_dump_can_compress(file_type_subtype) ||
+	    !wtap_can_write_compression_type(compression_type))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2453,7 +2454,7 @@ wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int
 }
 
 static wtap_dumper *
-wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean compressed, int *err)
+wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2466,20 +2467,20 @@ wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen, gboolean comp
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
 
 static gboolean
-wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if(compression_type != WTAP_UNCOMPRESSED) {
 		cant_seek = TRUE;
 	} else {
 		fd = ws_fileno((FILE *)wdh->fh);
@@ -2524,13 +2525,24 @@ wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 void
 wtap_dump_flush(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		gzwfile_flush((GZWFILE_T)wdh->fh);
-	} else
+		break;
 #endif
-	{
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		framewfile_flush((FRAMEWFILE_T)wdh->fh);
+		break;
+#endif
+
+	default:
 		fflush((FILE *)wdh->fh);
+		break;
 	}
 }
 
@@ -2583,52 +2595,110 @@ wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinfo_lists)
 	return TRUE;
 }
 
-/* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
-static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
+gboolean
+wtap_can_write_compression_type(wtap_compression_type compression_type)
 {
-	if(wdh->compressed) {
-		return gzwfile_open(filename);
-	} else {
-		return ws_fopen(filename, "wb");
+	switch (compression_type) {
+
+	case WTAP_UNCOMPRESSED:
+		return TRUE;
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return TRUE;
+#endif
+
+	default:
+		return FALSE;
 	}
 }
-#else
+
+/* internally open a file for writing (compressed or not); on failure,
+   *err is set to an errno or WTAP_ERR_ value */
 static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
+wtap_dump_file_open(wtap_dumper *wdh, const char *filename, int *err)
 {
-	return ws_fopen(filename, "wb");
-}
-#endif
+	WFILE_T fh;
+
+	/* In case "fopen()" fails but doesn't set "errno", set "errno"
+	   to a generic "the open failed" error. */
+	errno = WTAP_ERR_CANT_OPEN;
+	switch (wdh->compression_type) {
 
-/* internally open a file for writing (compressed or not) */
 #ifdef HAVE_ZLIB
-static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
-{
-	if(wdh->compressed) {
-		return gzwfile_fdopen(fd);
-	} else {
-		return ws_fdopen(fd, "wb");
+	case WTAP_GZIP_COMPRESSED:
+		fh = gzwfile_open(filename);
+		break;
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_open(filename, wdh->compression_type, err);
+#endif
+
+	default:
+		fh = ws_fopen(filename, "wb");
+		break;
 	}
+	if (fh == NULL)
+		*err = errno;
+	return fh;
 }
-#else
+
+/* internally open a file for writing (compressed or not); on failure,
+   *err is set to an errno or WTAP_ERR_ value */
 static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
+wtap_dump_file_fdopen(wtap_dumper *wdh, int fd, int *err)
 {
-	return ws_fdopen(fd, "wb");
-}
+	WFILE_T fh;
+
+	/* In case "fopen()" fails but doesn't set "errno", set "errno"
+	   to a generic "the open failed" error. */
+	errno = WTAP_ERR_CANT_OPEN;
+	switch (wdh->compression_type) {
+
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
+		fh = gzwfile_fdopen(fd);
+		break;
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_fdopen(fd, wdh->compression_type, err);
 #endif
 
+	default:
+		fh = ws_fdopen(fd, "wb");
+		break;
+	}
+	if (fh == NULL)
+		*err = errno;
+	return fh;
+}
+
 /* internally writing raw bytes (compressed or not) */
 gboolean
 wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err)
 {
 	size_t nwritten;
 
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_ZLIB
-	if (wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2637,9 +2707,24 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 			*err = gzwfile_geterr((GZWFILE_T)wdh->fh);
 			return FALSE;
 		}
-	} else
+		break;
 #endif
-	{
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		nwritten = framewfile_write((FRAMEWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		/*
+		 * framewfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = framewfile_geterr((FRAMEWFILE_T)wdh->fh);
+			return FALSE;
+		}
+		break;
+#endif
+
+	default:
 		errno = WTAP_ERR_CANT_WRITE;
 		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
 		/*
@@ -2653,6 +2738,7 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 				*err = WTAP_ERR_SHORT_WRITE;
 			return FALSE;
 		}
+		break;
 	}
 	return TRUE;
 }
@@ -2661,16 +2747,24 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
+
 #ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	case WTAP_GZIP_COMPRESSED:
 		/*
 		 * Tell gzwfile_close() whether to close the descriptor
 		 * or not.
 		 */
 		return gzwfile_close((GZWFILE_T)wdh->fh, wdh->is_stdout);
-	} else
 #endif
-	{
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	case WTAP_ZSTD_COMPRESSED:
+	case WTAP_LZ4_COMPRESSED:
+		return framewfile_close((FRAMEWFILE_T)wdh->fh, wdh->is_stdout);
+#endif
+
+	default:
 		/*
 		 * Don't close the standard output.
 		 *
@@ -2685,12 +2779,10 @@ wtap_dump_file_close(wtap_dumper *wdh)
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == fseek((FILE *)wdh->fh, (long)offset, whence)) {
 			*err = errno;
@@ -2706,12 +2798,10 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_ZLIB
-	if(wdh->compressed) {
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == (rval = ftell((FILE *)wdh->fh))) {
 			*err = errno;
@@ -46,15 +46,39 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
+#include <glib/gstdio.h>
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#include <time.h>
+#define USE_MMAP
+#endif
+
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
 /*
  * See RFC 1952 for a description of the gzip file format.
  *
+ * See RFC 8478 for a description of the Zstandard frame format, and
+ * https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md for a
+ * description of the LZ4 frame format.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: http://tukaani.org/xz/
@@ -71,6 +95,12 @@
 const char *compressed_file_extension_table[] = {
 #ifdef HAVE_ZLIB
     "gz",
+#endif
+#ifdef HAVE_ZSTD
+    "zst",
+#endif
+#ifdef HAVE_LZ4
+    "lz4",
 #endif
     NULL
 };
@@ -78,14 +108,34 @@ const char *compressed_file_extension_table[] = {
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
-/* values for wtap_reader compression */
+/*
+ * Largest piece of a memory-mapped file we hand out as the output
+ * buffer at once.  We check that the file hasn't been truncated before
+ * handing out each piece, so keep them small enough for that to be
+ * done often.
+ */
+#define MAP_CHUNK_SIZE 0x400000
+
+/*
+ * Files modified less than this many seconds ago may still be being
+ * written, so we don't map them.
+ */
+#define MAP_MIN_AGE 5
+
+/* values for wtap_reader compression; they're saved in fast seek index files */
 typedef enum {
-    UNKNOWN,       /* unknown - look for a gzip header */
-    UNCOMPRESSED,  /* uncompressed - copy input directly */
+    UNKNOWN = 0,       /* unknown - look for a gzip header */
 #ifdef HAVE_ZLIB
-    ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    ZLIB = 2,          /* decompress a zlib stream */
+    GZIP_AFTER_HEADER = 3,
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD = 4,          /* decompress a Zstandard frame */
 #endif
+#ifdef HAVE_LZ4
+    LZ4 = 5,           /* decompress an LZ4 frame */
+#endif
+    UNCOMPRESSED = 1   /* uncompressed - copy input directly */
 } compression_t;
 
 struct wtap_reader {
@@ -116,10 +166,27 @@ struct wtap_reader {
     /* zlib inflate stream */
     z_stream strm;             /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;   /* TRUE if we aren't supposed to check the CRC */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd_ds;     /* Zstandard stream, allocated when first needed */
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_decompressionContext_t lz4_dctx; /* LZ4 context, allocated when first needed */
 #endif
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    char *path;                /* pathname, if opened with file_open() */
+    gboolean is_random;        /* TRUE if this is the random access stream */
+    gboolean save_fast_seek_index; /* TRUE if the fast seek points should be saved on close */
+    guint fast_seek_loaded;    /* number of fast seek points loaded from the index file */
+    /* memory-mapped uncompressed file */
+    gboolean try_map;          /* TRUE if we may map the file once we know it's uncompressed */
+    unsigned char *map;        /* start of the mapping, or NULL if not mapped */
+    gint64 map_size;           /* size of the mapping */
+    /* decompression in a separate thread */
+    gboolean want_readahead;   /* TRUE if we should decompress in a separate thread */
+    struct readahead *ra;      /* readahead state, or NULL if not doing readahead */
 };
 
 static int     /* gz_load */
@@ -128,6 +195,17 @@ raw_read(FILE_T state, unsigned char *buf, unsigned int count, guint *have)
     ssize_t ret;
 
     *have = 0;
+    /*
+     * While the file is mapped we don't move the file descriptor's
+     * offset, so if we're reading past the end of the mapping (the
+     * file has grown since we mapped it), go to the right place first.
+     */
+    if (state->map != NULL &&
+        ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
     do {
         ret = ws_read(state->fd, buf + *have, count - *have);
         if (ret <= 0)
@@ -158,6 +236,27 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/* Make sure there are at least n bytes at next_in, unless we hit the
+   end of the file first.  Return -1, and set state->err, on error. */
+static int
+fill_in_buffer_min(FILE_T state, guint n)
+{
+    guint got;
+
+    if (state->err)
+        return -1;
+    if (state->avail_in >= n || state->eof)
+        return 0;
+    if (state->avail_in != 0)
+        memmove(state->in, state->next_in, state->avail_in);
+    state->next_in = state->in;
+    if (raw_read(state, state->in + state->avail_in,
+                 state->size - state->avail_in, &got) == -1)
+        return -1;
+    state->avail_in += got;
+    return 0;
+}
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -248,6 +347,297 @@ fast_seek_reset(
 #endif
 }
 
+/*
+ * Fast seek index files.
+ *
+ * Building the fast seek points for a compressed file means decompressing
+ * all of it, so, if the program asked for it with
+ * file_set_save_fast_seek_index(), we save the points, with their windows,
+ * in an index file when the random access stream of a compressed file is
+ * closed.  The points are loaded again the next time the file is opened
+ * for random access.  Index files go in a "wireshark/fast-seek" directory
+ * in the user's cache directory, rather than next to the capture files,
+ * and are named after a hash of the capture file's absolute path.  The
+ * index file records the size and modification time of the capture file,
+ * and is ignored if either has changed.
+ *
+ * The index files together are kept under FAST_SEEK_INDEX_MAX_TOTAL
+ * bytes by removing the least recently used ones whenever one is saved.
+ * Setting the WIRESHARK_NO_FAST_SEEK_INDEX environment variable turns
+ * index files off altogether.
+ *
+ * Index files are a cache local to this machine, so they're written in
+ * host byte order; the magic number tells us if that's not ours.
+ */
+#define FAST_SEEK_INDEX_DIR      "fast-seek"
+#define FAST_SEEK_INDEX_SUFFIX   ".gzidx"
+#define FAST_SEEK_INDEX_MAGIC    0x57534758     /* "WSGX" */
+#define FAST_SEEK_INDEX_VERSION  1
+#define FAST_SEEK_INDEX_MAX_TOTAL (G_GINT64_CONSTANT(256) * 1024 * 1024)
+#define FAST_SEEK_INDEX_DISABLE_ENV "WIRESHARK_NO_FAST_SEEK_INDEX"
+
+struct fast_seek_index_hdr {
+    guint32 magic;
+    guint32 version;
+    guint32 winsize;       /* ZLIB_WINSIZE */
+    guint32 count;         /* number of points */
+    gint64 file_size;      /* size of the capture file */
+    gint64 file_mtime;     /* modification time of the capture file */
+};
+
+struct fast_seek_index_rec {
+    gint64 out;
+    gint64 in;
+    guint32 compression;
+    gint32 bits;
+    guint32 adler;
+    guint32 total_out;
+    /* followed by ZLIB_WINSIZE bytes of window if compression is ZLIB */
+};
+
+static gboolean
+fast_seek_index_disabled(void)
+{
+    return g_getenv(FAST_SEEK_INDEX_DISABLE_ENV) != NULL;
+}
+
+static gboolean
+fast_seek_index_stat(FILE_T state, gint64 *size, gint64 *mtime)
+{
+    ws_statb64 st;
+
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return FALSE;
+    *size = (gint64)st.st_size;
+    *mtime = (gint64)st.st_mtime;
+    return TRUE;
+}
+
+/* Directory that index files are kept in; the result must be g_free()d */
+static gchar *
+fast_seek_index_dir(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "wireshark",
+                            FAST_SEEK_INDEX_DIR, NULL);
+}
+
+/* Path of the index file for a capture file; the result must be g_free()d */
+static gchar *
+fast_seek_index_path(FILE_T state)
+{
+    gchar *abs_path, *cwd, *hash, *name, *dir, *index_path;
+
+    if (g_path_is_absolute(state->path)) {
+        abs_path = g_strdup(state->path);
+    } else {
+        cwd = g_get_current_dir();
+        abs_path = g_build_filename(cwd, state->path, NULL);
+        g_free(cwd);
+    }
+    hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, abs_path, -1);
+    g_free(abs_path);
+    name = g_strconcat(hash, FAST_SEEK_INDEX_SUFFIX, NULL);
+    g_free(hash);
+    dir = fast_seek_index_dir();
+    index_path = g_build_filename(dir, name, NULL);
+    g_free(dir);
+    g_free(name);
+    return index_path;
+}
+
+/* Is this a compression type that this build can seek in? */
+static gboolean
+fast_seek_index_compression_ok(guint32 compression)
+{
+    switch (compression) {
+
+    case UNCOMPRESSED:
+#ifdef HAVE_ZLIB
+    case ZLIB:
+    case GZIP_AFTER_HEADER:
+#endif
+#ifdef HAVE_ZSTD
+    case ZSTD:
+#endif
+#ifdef HAVE_LZ4
+    case LZ4:
+#endif
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+static void
+fast_seek_index_load(FILE_T state)
+{
+    struct fast_seek_index_hdr hdr;
+    struct fast_seek_index_rec rec;
+    struct fast_seek_point *item, *last = NULL;
+    gint64 size, mtime;
+    gchar *index_path;
+    FILE *fp;
+    guint32 i;
+
+    if (state->path == NULL || state->fast_seek == NULL ||
+        state->fast_seek->len != 0 || fast_seek_index_disabled() ||
+        !fast_seek_index_stat(state, &size, &mtime))
+        return;
+
+    index_path = fast_seek_index_path(state);
+    fp = ws_fopen(index_path, "rb");
+    if (fp == NULL) {
+        g_free(index_path);
+        return;
+    }
+
+    if (fread(&hdr, sizeof hdr, 1, fp) != 1 ||
+        hdr.magic != FAST_SEEK_INDEX_MAGIC ||
+        hdr.version != FAST_SEEK_INDEX_VERSION ||
+        hdr.winsize != ZLIB_WINSIZE ||
+        hdr.file_size != size || hdr.file_mtime != mtime) {
+        fclose(fp);
+        g_free(index_path);
+        return;
+    }
+
+    for (i = 0; i < hdr.count; i++) {
+        if (fread(&rec, sizeof rec, 1, fp) != 1)
+            break;
+        if (!fast_seek_index_compression_ok(rec.compression))
+            break;
+        if (rec.in < 0 || rec.in > size || (last != NULL && rec.out <= last->out))
+            break;
+#ifndef HAVE_INFLATEPRIME
+        if (rec.bits != 0)
+            break;
+#endif
+        item = g_new(struct fast_seek_point, 1);
+        item->out = rec.out;
+        item->in = rec.in;
+        item->compression = (compression_t)rec.compression;
+#ifdef HAVE_ZLIB
+        if (item->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            item->data.zlib.bits = rec.bits;
+#endif
+            item->data.zlib.adler = rec.adler;
+            item->data.zlib.total_out = rec.total_out;
+            if (fread(item->data.zlib.window, ZLIB_WINSIZE, 1, fp) != 1) {
+                g_free(item);
+                break;
+            }
+        }
+#endif
+        g_ptr_array_add(state->fast_seek, item);
+        last = item;
+    }
+    fclose(fp);
+    state->fast_seek_loaded = state->fast_seek->len;
+
+#if GLIB_CHECK_VERSION(2,18,0)
+    /* mark it as recently used, so that it's the last to be evicted */
+    if (state->fast_seek_loaded != 0)
+        g_utime(index_path, NULL);
+#endif
+    g_free(index_path);
+}
+
+static void
+fast_seek_index_save(FILE_T state)
+{
+    struct fast_seek_index_hdr hdr;
+    struct fast_seek_index_rec rec;
+    struct fast_seek_point *item;
+    gboolean compressed = FALSE;
+    gchar *index_dir, *index_path, *tmp_path;
+    FILE *fp;
+    gboolean ok;
+    guint i;
+
+    if (state->path == NULL || state->fast_seek == NULL ||
+        state->fast_seek->len <= state->fast_seek_loaded ||
+        fast_seek_index_disabled())
+        return;
+
+    /* Only compressed files have points that are worth saving. */
+    for (i = 0; i < state->fast_seek->len; i++) {
+        item = (struct fast_seek_point *)state->fast_seek->pdata[i];
+        if (item->compression != UNCOMPRESSED) {
+            compressed = TRUE;
+            break;
+        }
+    }
+    if (!compressed)
+        return;
+
+    memset(&hdr, 0, sizeof hdr);
+    hdr.magic = FAST_SEEK_INDEX_MAGIC;
+    hdr.version = FAST_SEEK_INDEX_VERSION;
+    hdr.winsize = ZLIB_WINSIZE;
+    hdr.count = state->fast_seek->len;
+    if (!fast_seek_index_stat(state, &hdr.file_size, &hdr.file_mtime))
+        return;
+
+    /*
+     * Write to a temporary file and rename it, so that nobody sees
+     * a partial index.  If we can't write to the cache directory,
+     * we just don't save the index.
+     */
+    index_dir = fast_seek_index_dir();
+    if (g_mkdir_with_parents(index_dir, 0700) == -1) {
+        g_free(index_dir);
+        return;
+    }
+    index_path = fast_seek_index_path(state);
+    tmp_path = g_strconcat(index_path, ".tmp", NULL);
+    fp = ws_fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        g_free(tmp_path);
+        g_free(index_path);
+        g_free(index_dir);
+        return;
+    }
+
+    ok = (fwrite(&hdr, sizeof hdr, 1, fp) == 1);
+    for (i = 0; ok && i < state->fast_seek->len; i++) {
+        item = (struct fast_seek_point *)state->fast_seek->pdata[i];
+        memset(&rec, 0, sizeof rec);
+        rec.out = item->out;
+        rec.in = item->in;
+        rec.compression = item->compression;
+#ifdef HAVE_ZLIB
+        if (item->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+            rec.bits = item->data.zlib.bits;
+#endif
+            rec.adler = item->data.zlib.adler;
+            rec.total_out = item->data.zlib.total_out;
+        }
+#endif
+        ok = (fwrite(&rec, sizeof rec, 1, fp) == 1);
+#ifdef HAVE_ZLIB
+        if (ok && item->compression == ZLIB)
+            ok = (fwrite(item->data.zlib.window, ZLIB_WINSIZE, 1, fp) == 1);
+#endif
+    }
+    if (fclose(fp) != 0)
+        ok = FALSE;
+#ifdef _WIN32
+    /* rename() doesn't replace an existing file on Windows */
+    if (ok && ws_remove(index_path) == -1 && errno != ENOENT)
+        ok = FALSE;
+#endif
+    if (!ok || ws_rename(tmp_path, index_path) != 0)
+        ws_unlink(tmp_path);
+    else
+        trim_cache_dir(index_dir, FAST_SEEK_INDEX_SUFFIX, FAST_SEEK_INDEX_MAX_TOTAL);
+    g_free(tmp_path);
+    g_free(index_path);
+    g_free(index_dir);
+}
+
 #ifdef HAVE_ZLIB
 
 /* Get next byte from input, or -1 if end or error.
@@ -560,6 +950,215 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*
+ * Zstandard and LZ4 files are sequences of frames, each of which can
+ * be decompressed on its own; the first four bytes of a frame are a
+ * magic number saying what sort of frame it is.  We look for a frame
+ * magic number whenever we'd look for a gzip header, so concatenated
+ * frames, even of different types, are handled the same way that
+ * concatenated gzip streams are, and we add a fast seek point at the
+ * start of each frame, which means that, for files written with
+ * reasonably small frames, as we write them, seeking doesn't require
+ * decompressing anything before the frame containing the target.
+ *
+ * Skippable frames, with magic numbers 0x184D2A50 through 0x184D2A5F,
+ * are used by both formats for metadata; we just skip them.
+ */
+#ifdef HAVE_ZSTD
+static const unsigned char zstd_magic[4] = { 0x28, 0xB5, 0x2F, 0xFD };
+#endif
+#ifdef HAVE_LZ4
+static const unsigned char lz4_magic[4] = { 0x04, 0x22, 0x4D, 0x18 };
+#endif
+
+#define IS_SKIPPABLE_FRAME(p) \
+    (((p)[0] & 0xF0) == 0x50 && (p)[1] == 0x2A && (p)[2] == 0x4D && (p)[3] == 0x18)
+
+/* Skip len bytes of input.  Return -1, and set state->err, on error
+   or if the file ends first. */
+static int
+frame_skip(FILE_T state, guint32 len)
+{
+    guint n;
+
+    while (len) {
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            return -1;
+        if (state->avail_in == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            return -1;
+        }
+        n = state->avail_in > len ? len : state->avail_in;
+        state->avail_in -= n;
+        state->next_in += n;
+        len -= n;
+    }
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* Get the Zstandard stream ready to decompress a new frame. */
+static int
+zstd_reset(FILE_T state)
+{
+    if (state->zstd_ds == NULL) {
+        state->zstd_ds = ZSTD_createDStream();
+        if (state->zstd_ds == NULL) {
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+    if (ZSTD_isError(ZSTD_initDStream(state->zstd_ds))) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Set up to decompress the Zstandard frame at next_in. */
+static int
+zstd_start(FILE_T state)
+{
+    if (zstd_reset(state) == -1)
+        return -1;
+    state->compression = ZSTD;
+    state->is_compressed = TRUE;
+    if (state->fast_seek)
+        fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, ZSTD);
+    return 0;
+}
+
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_outBuffer output;
+    ZSTD_inBuffer input;
+    size_t ret = 1;
+    size_t had;
+
+    output.dst = buf;
+    output.size = count;
+    output.pos = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input, if there's any */
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            break;
+
+        input.src = state->next_in;
+        input.size = state->avail_in;
+        input.pos = 0;
+        had = output.pos;
+        ret = ZSTD_decompressStream(state->zstd_ds, &output, &input);
+        state->next_in += input.pos;
+        state->avail_in -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+        if (input.size == 0 && output.pos == had) {
+            /* EOF in the middle of a frame, with nothing left to flush */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+    } while (output.pos < output.size && ret != 0);
+
+    state->next = buf;
+    state->have = (guint)output.pos;
+
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+#endif
+
+#ifdef HAVE_LZ4
+static int
+lz4_create_context(FILE_T state)
+{
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION))) {
+        state->lz4_dctx = NULL;
+        state->err = ENOMEM;
+        state->err_info = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Set up to decompress the LZ4 frame at next_in. */
+static int
+lz4_start(FILE_T state)
+{
+    /* A context that has finished a frame is ready for the next one. */
+    if (state->lz4_dctx == NULL && lz4_create_context(state) == -1)
+        return -1;
+    state->compression = LZ4;
+    state->is_compressed = TRUE;
+    if (state->fast_seek)
+        fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, LZ4);
+    return 0;
+}
+
+/* Throw away any partly-decompressed frame, after a seek. */
+static int
+lz4_reset(FILE_T state)
+{
+    if (state->lz4_dctx != NULL) {
+        (void)LZ4F_freeDecompressionContext(state->lz4_dctx);
+        state->lz4_dctx = NULL;
+    }
+    return lz4_create_context(state);
+}
+
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    size_t ret = 1;
+    size_t in_size, out_size;
+    unsigned int got = 0;
+
+    /* fill output buffer up to end of frame or error */
+    do {
+        /* get more input, if there's any */
+        if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+            break;
+
+        in_size = state->avail_in;
+        out_size = count - got;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + got, &out_size,
+                              state->next_in, &in_size, NULL);
+        state->next_in += in_size;
+        state->avail_in -= (guint)in_size;
+        got += (unsigned int)out_size;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+        if (in_size == 0 && out_size == 0) {
+            /* EOF in the middle of a frame, with nothing left to flush */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+    } while (got < count && ret != 0);
+
+    state->next = buf;
+    state->have = got;
+
+    if (ret == 0)
+        state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+}
+#endif
+
 static int
 gz_head(FILE_T state)
 {
@@ -670,6 +1269,34 @@ gz_head(FILE_T state)
         }
     }
 #endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    /* look for a Zstandard, LZ4, or skippable frame */
+    if (state->have == 0) {
+        if (fill_in_buffer_min(state, 8) == -1)
+            return -1;
+#ifdef HAVE_ZSTD
+        if (state->avail_in >= 4 && memcmp(state->next_in, zstd_magic, 4) == 0)
+            return zstd_start(state);
+#endif
+#ifdef HAVE_LZ4
+        if (state->avail_in >= 4 && memcmp(state->next_in, lz4_magic, 4) == 0)
+            return lz4_start(state);
+#endif
+        if (state->avail_in >= 8 && IS_SKIPPABLE_FRAME(state->next_in)) {
+            guint32 len;
+
+            len = (guint32)state->next_in[4] |
+                  (guint32)state->next_in[5] << 8 |
+                  (guint32)state->next_in[6] << 16 |
+                  (guint32)state->next_in[7] << 24;
+            state->avail_in -= 8;
+            state->next_in += 8;
+            state->is_compressed = TRUE;
+            /* stay in UNKNOWN, to look at what follows the frame */
+            return frame_skip(state, len);
+        }
+    }
+#endif
 #ifdef HAVE_LIBXZ
     /* { 0xFD, '7', 'z', 'X', 'Z', 0x00 } */
     /* FD 37 7A 58 5A 00 */
@@ -691,76 +1318,937 @@ gz_head(FILE_T state)
     return 0;
 }
 
-static int /* gz_make */
-fill_out_buffer(FILE_T state)
+/*
+ * Memory-map an uncompressed regular file, so that the output buffer can
+ * point straight into the mapping rather than having data read() into it.
+ * This saves a system call and a copy per buffer, and makes seeking
+ * within the mapped part of the file free.  Failure isn't an error; we
+ * just keep reading the file the normal way.
+ *
+ * Touching a page of the mapping that's past the end of the file gets
+ * us a SIGBUS, so we only map files that don't look like they're still
+ * being written (such as a live capture's file), and map_check() makes
+ * sure the file hasn't shrunk before we use the mapping.
+ */
+static void
+file_map(FILE_T state)
 {
-    if (state->compression == UNKNOWN) {           /* look for gzip header */
-        if (gz_head(state) == -1)
-            return -1;
-        if (state->have)                /* got some data from gz_head() */
-            return 0;
+#ifdef USE_MMAP
+    ws_statb64 st;
+    void *map;
+
+    state->try_map = FALSE;
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return;
+    if (st.st_size <= 0 || (guint64)st.st_size > G_MAXSIZE)
+        return;
+    if (st.st_mtime > time(NULL) - MAP_MIN_AGE)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    state->map = (unsigned char *)map;
+    state->map_size = st.st_size;
+#else
+    state->try_map = FALSE;
+#endif
+}
+
+static void
+file_unmap(FILE_T state)
+{
+#ifdef USE_MMAP
+    if (state->map == NULL)
+        return;
+
+    /*
+     * If the output buffer points into the mapping, discard it and
+     * arrange to read what's left of it from the file.
+     */
+    if (state->next >= state->map && state->next <= state->map + state->map_size) {
+        state->raw_pos -= state->have;
+        state->have = 0;
+        state->next = state->out;
+        if (state->fd != -1)
+            (void)ws_lseek64(state->fd, state->raw_pos, SEEK_SET);
+    }
+    munmap(state->map, (size_t)state->map_size);
+    state->map = NULL;
+    state->map_size = 0;
+#else
+    state->map = NULL;
+#endif
+}
+
+/*
+ * If the file is mapped, make the mapping match the file as it is now.
+ * If the file has shrunk, touching the part of the mapping past its end
+ * would get us a SIGBUS, so unmap it and go back to reading it; if it
+ * has grown, map it again, so that the part that was added is handed out
+ * from the mapping as well.  Returns TRUE if the file is (still) mapped.
+ */
+static gboolean
+map_check(FILE_T state)
+{
+#ifdef USE_MMAP
+    ws_statb64 st;
+    void *map;
+
+    if (state->map == NULL)
+        return FALSE;
+    if (ws_fstat64(state->fd, &st) == -1 || st.st_size < state->map_size) {
+        file_unmap(state);
+        return FALSE;
+    }
+    if (st.st_size > state->map_size && (guint64)st.st_size <= G_MAXSIZE) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+        if (map != MAP_FAILED) {
+            /* the output buffer may point into the old mapping */
+            if (state->next >= state->map && state->next <= state->map + state->map_size)
+                state->next = (unsigned char *)map + (state->next - state->map);
+            munmap(state->map, (size_t)state->map_size);
+            state->map = (unsigned char *)map;
+            state->map_size = st.st_size;
+        }
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/*
+ * Make the output buffer the part of the mapping that starts at
+ * the given offset.  As the file is uncompressed and was opened at
+ * its beginning, file offsets and uncompressed offsets are the same.
+ */
+static void
+map_fill(FILE_T state, gint64 offset)
+{
+    gint64 left = state->map_size - offset;
+
+    state->next = state->map + offset;
+    state->have = left > MAP_CHUNK_SIZE ? MAP_CHUNK_SIZE : (guint)left;
+    state->raw_pos = offset + state->have;
+}
+
+static void readahead_init(FILE_T state);
+static int readahead_fill_out_buffer(FILE_T state);
+
+static int /* gz_make */
+fill_out_buffer(FILE_T state)
+{
+    if (state->want_readahead && state->compression == UNKNOWN &&
+        state->pos == 0 && state->raw_pos == state->start && state->avail_in == 0)
+        readahead_init(state);
+    if (state->ra != NULL)                          /* another thread decompresses */
+        return readahead_fill_out_buffer(state);
+    if (state->compression == UNKNOWN) {           /* look for gzip header */
+        if (gz_head(state) == -1)
+            return -1;
+        if (state->have)                /* got some data from gz_head() */
+            return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+        if (state->try_map && !state->is_compressed)
+            file_map(state);
+        /* check the file's size every time we move on to another chunk */
+        if (state->map != NULL && map_check(state) &&
+            state->raw_pos < state->map_size) {
+            map_fill(state, state->raw_pos);
+            return 0;
+        }
         if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
             return -1;
         state->next = state->out;
     }
 #ifdef HAVE_ZLIB
-    else if (state->compression == ZLIB) {      /* decompress */
-        zlib_read(state, state->out, state->size << 1);
+    else if (state->compression == ZLIB) {      /* decompress */
+        zlib_read(state, state->out, state->size << 1);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {      /* decompress */
+        zstd_read(state, state->out, state->size << 1);
+    }
+#endif
+#ifdef HAVE_LZ4
+    else if (state->compression == LZ4) {       /* decompress */
+        lz4_read(state, state->out, state->size << 1);
+    }
+#endif
+    return 0;
+}
+
+static int
+gz_skip(FILE_T state, gint64 len)
+{
+    guint n;
+
+    /* skip over len bytes or reach end-of-file, whichever comes first */
+    while (len)
+        if (state->have) {
+            /* We have stuff in the output buffer; skip over
+               it. */
+            n = (gint64)state->have > len ? (unsigned)len : state->have;
+            state->have -= n;
+            state->next += n;
+            state->pos += n;
+            len -= n;
+        } else if (state->err) {
+            /* We have nothing in the output buffer, and
+               we have an error that may not have been
+               reported yet; that means we can't generate
+               any more data into the output buffer, so
+               return an error indication. */
+            return -1;
+        } else if (state->eof && state->avail_in == 0) {
+            /* We have nothing in the output buffer, and
+               we're at the end of the input; just return. */
+            break;
+        } else {
+            /* We have nothing in the output buffer, and
+               we can generate more data; get more output,
+               looking for header if required. */
+            if (fill_out_buffer(state) == -1)
+                return -1;
+        }
+    return 0;
+}
+
+static void
+gz_reset(FILE_T state)
+{
+    state->have = 0;              /* no output data available */
+    state->eof = FALSE;           /* not at end of file */
+    state->compression = UNKNOWN; /* look for gzip header */
+
+    state->seek_pending = FALSE;  /* no seek request pending */
+    state->err = 0;               /* clear error */
+    state->err_info = NULL;
+    state->pos = 0;               /* no uncompressed data yet */
+    state->avail_in = 0;          /* no input data yet */
+}
+
+/*
+ * Decompression readahead.
+ *
+ * Inflating a compressed file is about as expensive as dissecting it, so,
+ * if asked to, we decompress a compressed file in a separate thread.
+ *
+ * That thread reads the file through an inner FILE_T, on a dup of the
+ * file's descriptor, which does all the work described above; it copies
+ * the uncompressed data into a bounded set of chunks, which the outer
+ * FILE_T then hands out as its output buffer.  Reads and short forward
+ * skips just consume chunks; other seeks stop the thread, seek the inner
+ * FILE_T and start the thread again.
+ *
+ * The inner FILE_T keeps fast seek points in an array of its own, and
+ * copies of new points travel with the chunks, so that the fast seek
+ * array shared with the random access FILE_T is only ever touched by
+ * the thread reading the outer FILE_T.
+ *
+ * Files written by bgzip, and other BGZF writers, are sequences of
+ * small gzip members whose headers give their compressed size, so
+ * the thread can find the members without inflating them.  For those
+ * files, whenever the inner FILE_T is between members, the thread just
+ * collects a chunk's worth of whole members and hands the chunk to a
+ * pool of workers that inflate chunks concurrently; chunks stay queued
+ * in file order, and the reader waits for the one at the head of the
+ * queue to be finished.
+ */
+#define RA_CHUNK_SIZE   (256 * 1024)
+#define RA_NUM_CHUNKS   16
+
+#ifdef HAVE_ZLIB
+/*
+ * BGZF members hold at most 64 KiB, compressed or not; see the SAM/BAM
+ * format specification.
+ */
+#define BGZF_MAX_BLOCK  65536
+#define RA_RAW_SIZE     (2 * RA_CHUNK_SIZE)
+
+struct bgzf_member {
+    guint raw_off;             /* offset of the member in the chunk's raw data */
+    guint hdr_len;             /* length of its gzip header */
+    guint len;                 /* length of the whole member */
+    guint out_off;             /* offset of its data in the chunk's data */
+    guint isize;               /* amount of uncompressed data */
+};
+#endif
+
+struct readahead_chunk {
+    unsigned char *data;
+    guint len;                 /* amount of uncompressed data */
+    gint64 out;                /* offset of that data in uncompressed data */
+    gint64 raw_pos;            /* position in file after producing this chunk */
+    gboolean is_compressed;    /* inner FILE_T's is_compressed */
+    gboolean eof;              /* TRUE if end of input file reached after this data */
+    int err;                   /* error after this data, if any */
+    const char *err_info;
+    GPtrArray *points;         /* copies of fast seek points found for this chunk */
+#ifdef HAVE_ZLIB
+    unsigned char *raw;        /* BGZF members to be inflated by a worker */
+    guint raw_len;
+    GArray *members;           /* a struct bgzf_member for each of them */
+    gboolean pending;          /* TRUE until a worker has inflated them */
+#endif
+};
+
+struct readahead {
+    FILE_T inner;              /* the stream the thread reads */
+    guint points_copied;       /* number of inner fast seek points copied so far */
+    struct readahead_chunk chunks[RA_NUM_CHUNKS];
+    struct readahead_chunk *cur; /* chunk being read, or NULL */
+    GThread *thread;           /* decompression thread, or NULL if not started */
+    GMutex *mtx;               /* protects everything below */
+    GCond *cond;
+    GQueue free_chunks;        /* chunks available for the thread to fill */
+    GQueue full_chunks;        /* filled chunks, in file order */
+    gboolean stop;             /* TRUE if the thread should exit */
+    gboolean done;             /* TRUE if the thread has exited or is about to */
+#ifdef HAVE_ZLIB
+    GThreadPool *pool;         /* workers inflating BGZF chunks, or NULL */
+    guint in_flight;           /* number of chunks handed to the workers */
+#endif
+};
+
+static void
+readahead_copy_points(struct readahead *ra, struct readahead_chunk *chunk)
+{
+    FILE_T inner = ra->inner;
+    struct fast_seek_point *point;
+
+    while (ra->points_copied < inner->fast_seek->len) {
+        point = (struct fast_seek_point *)inner->fast_seek->pdata[ra->points_copied++];
+        g_ptr_array_add(chunk->points, g_memdup(point, sizeof *point));
+    }
+}
+
+/*
+ * Produce a chunk of uncompressed data from the inner stream.
+ * Returns TRUE if there will be no more data, because of EOF or an error.
+ */
+static gboolean
+readahead_fill_chunk(struct readahead *ra, struct readahead_chunk *chunk)
+{
+    FILE_T inner = ra->inner;
+    guint n;
+
+    chunk->len = 0;
+    chunk->eof = FALSE;
+    chunk->err = 0;
+    chunk->err_info = NULL;
+
+    if (inner->seek_pending) {
+        inner->seek_pending = FALSE;
+        (void)gz_skip(inner, inner->skip);
+    }
+
+    chunk->out = inner->pos;
+    while (chunk->len < RA_CHUNK_SIZE) {
+        if (inner->have) {
+            n = MIN(inner->have, RA_CHUNK_SIZE - chunk->len);
+            memcpy(chunk->data + chunk->len, inner->next, n);
+            inner->next += n;
+            inner->have -= n;
+            inner->pos += n;
+            chunk->len += n;
+        } else if (inner->err || (inner->eof && inner->avail_in == 0)) {
+            break;
+        } else if (fill_out_buffer(inner) == -1) {
+            break;
+        }
+    }
+
+    /*
+     * Errors and EOF only count once the data before them has
+     * been handed out, as is the case when reading directly.
+     */
+    if (inner->have == 0) {
+        chunk->err = inner->err;
+        chunk->err_info = inner->err_info;
+        chunk->eof = inner->eof && inner->avail_in == 0;
+    }
+    chunk->raw_pos = inner->raw_pos;
+    chunk->is_compressed = inner->is_compressed;
+
+    readahead_copy_points(ra, chunk);
+    return chunk->err != 0 || chunk->eof;
+}
+
+#ifdef HAVE_ZLIB
+/*
+ * If the stream is between gzip members, and the next one is a BGZF
+ * member, get the length of its header and of the whole member.
+ */
+static gboolean
+bgzf_member_at(FILE_T state, guint *hdr_len, guint *member_len)
+{
+    const unsigned char *p;
+    guint xlen, off, slen;
+
+    if (state->compression != UNKNOWN || state->have != 0 ||
+        state->seek_pending || state->err)
+        return FALSE;
+    if (fill_in_buffer_min(state, 12) == -1 || state->avail_in < 12)
+        return FALSE;
+    p = state->next_in;
+    /* gzip magic, deflate, and FEXTRA as the only flag */
+    if (p[0] != 31 || p[1] != 139 || p[2] != 8 || p[3] != 4)
+        return FALSE;
+    xlen = p[10] | (p[11] << 8);
+    if (12 + xlen > state->size ||
+        fill_in_buffer_min(state, 12 + xlen) == -1 || state->avail_in < 12 + xlen)
+        return FALSE;
+    p = state->next_in;
+
+    /* look for the "BC" subfield, which has the member size minus 1 */
+    for (off = 12; off + 4 <= 12 + xlen; off += 4 + slen) {
+        slen = p[off + 2] | (p[off + 3] << 8);
+        if (p[off] == 'B' && p[off + 1] == 'C' && slen == 2 && off + 6 <= 12 + xlen) {
+            *hdr_len = 12 + xlen;
+            *member_len = (p[off + 4] | (p[off + 5] << 8)) + 1;
+            /* there has to be room for the trailer */
+            return *member_len >= *hdr_len + 8;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Collect whole BGZF members from the inner stream into a chunk, for a
+ * worker to inflate.  Returns TRUE if there will be no more data,
+ * because of EOF or an error.
+ */
+static gboolean
+bgzf_collect_chunk(struct readahead *ra, struct readahead_chunk *chunk)
+{
+    FILE_T inner = ra->inner;
+    struct bgzf_member member;
+    const unsigned char *trailer;
+    guint hdr_len, member_len, left, n;
+
+    chunk->len = 0;
+    chunk->eof = FALSE;
+    chunk->err = 0;
+    chunk->err_info = NULL;
+    chunk->raw_len = 0;
+    g_array_set_size(chunk->members, 0);
+    chunk->out = inner->pos;
+
+    /* any member can be added while there's room for the largest one */
+    while (chunk->len <= RA_CHUNK_SIZE - BGZF_MAX_BLOCK &&
+           chunk->raw_len <= RA_RAW_SIZE - BGZF_MAX_BLOCK &&
+           bgzf_member_at(inner, &hdr_len, &member_len)) {
+        if (chunk->members->len == 0) {
+            /* the start of a chunk makes a good place to seek to */
+            fast_seek_header(inner, inner->raw_pos - inner->avail_in + hdr_len,
+                             inner->pos, GZIP_AFTER_HEADER);
+        }
+
+        member.raw_off = chunk->raw_len;
+        member.hdr_len = hdr_len;
+        member.len = member_len;
+        member.out_off = chunk->len;
+        for (left = member_len; left != 0; left -= n) {
+            if (inner->avail_in == 0 && fill_in_buffer(inner) == -1)
+                break;
+            if (inner->avail_in == 0) {
+                /* EOF */
+                inner->err = WTAP_ERR_SHORT_READ;
+                inner->err_info = NULL;
+                break;
+            }
+            n = MIN(inner->avail_in, left);
+            memcpy(chunk->raw + chunk->raw_len, inner->next_in, n);
+            inner->next_in += n;
+            inner->avail_in -= n;
+            chunk->raw_len += n;
+        }
+        if (inner->err)
+            break;
+
+        trailer = chunk->raw + member.raw_off + member_len - 4;
+        member.isize = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((guint)trailer[3] << 24);
+        if (member.isize > BGZF_MAX_BLOCK) {
+            inner->err = WTAP_ERR_DECOMPRESS;
+            inner->err_info = "BGZF block too large";
+            break;
+        }
+        g_array_append_val(chunk->members, member);
+        chunk->len += member.isize;
+        inner->pos += member.isize;
+        inner->is_compressed = TRUE;
+    }
+
+    if (inner->err) {
+        chunk->err = inner->err;
+        chunk->err_info = inner->err_info;
+    } else if (fill_in_buffer_min(inner, 1) != -1 &&
+               inner->eof && inner->avail_in == 0) {
+        chunk->eof = TRUE;
+    } else if (inner->err) {
+        chunk->err = inner->err;
+        chunk->err_info = inner->err_info;
+    }
+    chunk->raw_pos = inner->raw_pos;
+    chunk->is_compressed = inner->is_compressed;
+    chunk->pending = chunk->members->len != 0;
+
+    readahead_copy_points(ra, chunk);
+    return chunk->err != 0 || chunk->eof;
+}
+
+/*
+ * Worker: inflate the members collected in a chunk.
+ */
+static void
+bgzf_inflate_chunk(gpointer data, gpointer user_data)
+{
+    struct readahead_chunk *chunk = (struct readahead_chunk *)data;
+    struct readahead *ra = (struct readahead *)user_data;
+    struct bgzf_member *member;
+    const unsigned char *raw, *trailer;
+    guint32 crc;
+    z_stream strm;
+    int ret;
+    guint i;
+
+    memset(&strm, 0, sizeof strm);
+    if (inflateInit2(&strm, -15) != Z_OK) {   /* raw inflate */
+        chunk->len = 0;
+        chunk->err = ENOMEM;
+        chunk->err_info = NULL;
+    } else {
+        for (i = 0; i < chunk->members->len; i++) {
+            member = &g_array_index(chunk->members, struct bgzf_member, i);
+            raw = chunk->raw + member->raw_off;
+            trailer = raw + member->len - 8;
+
+            inflateReset(&strm);
+            strm.next_in = raw + member->hdr_len;
+            strm.avail_in = member->len - member->hdr_len - 8;
+            strm.next_out = chunk->data + member->out_off;
+            strm.avail_out = member->isize;
+            ret = inflate(&strm, Z_FINISH);
+            if (ret != Z_STREAM_END) {
+                chunk->err = WTAP_ERR_DECOMPRESS;
+                chunk->err_info = "invalid compressed data";
+            } else if (strm.total_out != member->isize) {
+                chunk->err = WTAP_ERR_DECOMPRESS;
+                chunk->err_info = "length field wrong";
+            } else if (!ra->inner->dont_check_crc) {
+                crc = (guint32)crc32(0L, chunk->data + member->out_off, member->isize);
+                if (crc != (trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((guint32)trailer[3] << 24))) {
+                    chunk->err = WTAP_ERR_DECOMPRESS;
+                    chunk->err_info = "bad CRC";
+                }
+            }
+            if (chunk->err) {
+                /* hand out the data before the bad member, then the error */
+                chunk->len = member->out_off;
+                chunk->eof = FALSE;
+                break;
+            }
+        }
+        inflateEnd(&strm);
+    }
+
+    g_mutex_lock(ra->mtx);
+    chunk->pending = FALSE;
+    ra->in_flight--;
+    g_cond_broadcast(ra->cond);
+    g_mutex_unlock(ra->mtx);
+}
+#endif
+
+static gpointer
+readahead_thread(gpointer data)
+{
+    struct readahead *ra = (struct readahead *)data;
+    struct readahead_chunk *chunk;
+    gboolean last = FALSE;
+#ifdef HAVE_ZLIB
+    guint hdr_len, member_len;
+#endif
+
+    while (!last) {
+        g_mutex_lock(ra->mtx);
+        while (!ra->stop && g_queue_is_empty(&ra->free_chunks))
+            g_cond_wait(ra->cond, ra->mtx);
+        if (ra->stop) {
+            ra->done = TRUE;
+            g_cond_broadcast(ra->cond);
+            g_mutex_unlock(ra->mtx);
+            break;
+        }
+        chunk = (struct readahead_chunk *)g_queue_pop_head(&ra->free_chunks);
+        g_mutex_unlock(ra->mtx);
+
+#ifdef HAVE_ZLIB
+        if (ra->pool != NULL && bgzf_member_at(ra->inner, &hdr_len, &member_len))
+            last = bgzf_collect_chunk(ra, chunk);
+        else
+#endif
+            last = readahead_fill_chunk(ra, chunk);
+
+        g_mutex_lock(ra->mtx);
+        g_queue_push_tail(&ra->full_chunks, chunk);
+#ifdef HAVE_ZLIB
+        if (chunk->pending) {
+            ra->in_flight++;
+            g_thread_pool_push(ra->pool, chunk, NULL);
+        }
+#endif
+        if (last)
+            ra->done = TRUE;
+        g_cond_broadcast(ra->cond);
+        g_mutex_unlock(ra->mtx);
+    }
+    return NULL;
+}
+
+static gboolean
+readahead_start_thread(struct readahead *ra)
+{
+    ra->stop = FALSE;
+    ra->done = FALSE;
+#if GLIB_CHECK_VERSION(2,31,0)
+    ra->thread = g_thread_try_new("File readahead", readahead_thread, ra, NULL);
+#else
+    ra->thread = g_thread_create(readahead_thread, ra, TRUE, NULL);
+#endif
+    return ra->thread != NULL;
+}
+
+/*
+ * Make the thread exit, if it's running, and wait for the workers to
+ * finish the chunks they have.  Chunks already filled stay queued.
+ */
+static void
+readahead_stop_thread(struct readahead *ra)
+{
+    if (ra->thread == NULL)
+        return;
+    g_mutex_lock(ra->mtx);
+    ra->stop = TRUE;
+    g_cond_broadcast(ra->cond);
+    g_mutex_unlock(ra->mtx);
+    g_thread_join(ra->thread);
+    ra->thread = NULL;
+#ifdef HAVE_ZLIB
+    g_mutex_lock(ra->mtx);
+    while (ra->in_flight != 0)
+        g_cond_wait(ra->cond, ra->mtx);
+    g_mutex_unlock(ra->mtx);
+#endif
+}
+
+/*
+ * Hand the fast seek points found while producing a chunk over to the
+ * fast seek array of the outer stream, if it has one.
+ */
+static void
+readahead_take_points(FILE_T state, struct readahead_chunk *chunk)
+{
+    struct fast_seek_point *point, *last;
+    guint i;
+
+    for (i = 0; i < chunk->points->len; i++) {
+        point = (struct fast_seek_point *)chunk->points->pdata[i];
+        last = NULL;
+        if (state->fast_seek && state->fast_seek->len != 0)
+            last = (struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1];
+        /*
+         * The random access stream may have added points of its own
+         * meanwhile; keep the array sorted.
+         */
+        if (state->fast_seek && (last == NULL || last->out < point->out))
+            g_ptr_array_add(state->fast_seek, point);
+        else
+            g_free(point);
+    }
+    g_ptr_array_set_size(chunk->points, 0);
+}
+
+static int
+readahead_fill_out_buffer(FILE_T state)
+{
+    struct readahead *ra = state->ra;
+    struct readahead_chunk *chunk;
+
+    g_mutex_lock(ra->mtx);
+    if (ra->cur != NULL) {
+        g_queue_push_tail(&ra->free_chunks, ra->cur);
+        g_cond_broadcast(ra->cond);
+        ra->cur = NULL;
+    }
+    for (;;) {
+        chunk = (struct readahead_chunk *)g_queue_peek_head(&ra->full_chunks);
+        if (chunk != NULL) {
+#ifdef HAVE_ZLIB
+            if (chunk->pending) {
+                /* a worker is still inflating it */
+                g_cond_wait(ra->cond, ra->mtx);
+                continue;
+            }
+#endif
+            break;
+        }
+        if (ra->thread != NULL && !ra->done) {
+            g_cond_wait(ra->cond, ra->mtx);
+            continue;
+        }
+
+        /*
+         * The thread has stopped, either at the end of the input, in
+         * which case there might be more by now, or because we asked
+         * it to; start it again.
+         */
+        g_mutex_unlock(ra->mtx);
+        readahead_stop_thread(ra);
+        if (!readahead_start_thread(ra)) {
+            /* No thread; do the work ourselves. */
+            chunk = (struct readahead_chunk *)g_queue_pop_head(&ra->free_chunks);
+            readahead_fill_chunk(ra, chunk);
+            g_queue_push_tail(&ra->full_chunks, chunk);
+        }
+        g_mutex_lock(ra->mtx);
+    }
+    chunk = (struct readahead_chunk *)g_queue_pop_head(&ra->full_chunks);
+    g_mutex_unlock(ra->mtx);
+
+    readahead_take_points(state, chunk);
+    ra->cur = chunk;
+    state->next = chunk->data;
+    state->have = chunk->len;
+    state->raw_pos = chunk->raw_pos;
+    state->is_compressed = chunk->is_compressed;
+    if (chunk->err) {
+        state->err = chunk->err;
+        state->err_info = chunk->err_info;
+    }
+    if (chunk->eof)
+        state->eof = TRUE;
+    return 0;
+}
+
+/*
+ * Seek, given an offset relative to the current position, while doing
+ * readahead.
+ */
+static gint64
+readahead_seek(FILE_T state, gint64 offset, int *err)
+{
+    struct readahead *ra = state->ra;
+    struct readahead_chunk *chunk;
+    gint64 target = state->pos + offset;
+
+    if (target < 0) {                        /* before start of file! */
+        *err = EINVAL;
+        return -1;
+    }
+
+    /*
+     * Is the target within the chunk we're reading?
+     */
+    if (ra->cur != NULL && target >= ra->cur->out &&
+        target <= ra->cur->out + ra->cur->len) {
+        state->next = ra->cur->data + (target - ra->cur->out);
+        state->have = (guint)(ra->cur->out + ra->cur->len - target);
+        state->pos = target;
+        return target;
+    }
+
+    /*
+     * Is it a short skip forward?  If so, just read our way there;
+     * the thread is probably already decompressing that data.
+     */
+    if (offset > 0 && offset <= SPAN) {
+        state->seek_pending = TRUE;
+        state->skip = offset;
+        return target;
+    }
+
+    /*
+     * No.  Stop the thread, throw away what it's read ahead and seek
+     * the inner stream to the target; the thread will be started again
+     * on the next read.
+     */
+    readahead_stop_thread(ra);
+    if (ra->cur != NULL) {
+        g_queue_push_tail(&ra->free_chunks, ra->cur);
+        ra->cur = NULL;
+    }
+    while ((chunk = (struct readahead_chunk *)g_queue_pop_head(&ra->full_chunks)) != NULL) {
+        readahead_take_points(state, chunk);
+        g_queue_push_tail(&ra->free_chunks, chunk);
+    }
+    state->have = 0;
+    state->next = NULL;
+    state->eof = FALSE;
+    state->err = 0;
+    state->err_info = NULL;
+    if (file_seek(ra->inner, target, SEEK_SET, err) == -1)
+        return -1;
+    state->pos = target;
+    return target;
+}
+
+/* Is this the start of a file that's worth decompressing in another thread? */
+static gboolean
+readahead_magic_ok(const unsigned char *magic)
+{
+    if (magic[0] == 31 && magic[1] == 139)
+        return TRUE;
+#ifdef HAVE_ZSTD
+    if (memcmp(magic, zstd_magic, 4) == 0)
+        return TRUE;
+#endif
+#ifdef HAVE_LZ4
+    if (memcmp(magic, lz4_magic, 4) == 0)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+/*
+ * Set up readahead for a stream on which nothing has been read yet, if
+ * it's a compressed file we can seek on.
+ */
+static void
+readahead_init(FILE_T state)
+{
+    struct readahead *ra;
+    unsigned char magic[18];
+    ssize_t got;
+    FILE_T inner;
+    int fd;
+    guint i;
+
+    state->want_readahead = FALSE;
+#if !GLIB_CHECK_VERSION(2,31,0)
+    if (!g_thread_supported())
+        return;
+#endif
+    /* Peek at the magic number; this also makes sure we can seek. */
+    if (ws_lseek64(state->fd, state->start, SEEK_SET) == -1)
+        return;
+    got = ws_read(state->fd, magic, sizeof magic);
+    if (got < 4 || !readahead_magic_ok(magic)) {
+        (void)ws_lseek64(state->fd, state->start, SEEK_SET);
+        return;
+    }
+    if (ws_lseek64(state->fd, state->start, SEEK_SET) == -1)
+        return;
+
+    if ((fd = ws_dup(state->fd)) == -1)
+        return;
+    if ((inner = file_fdopen(fd)) == NULL) {
+        ws_close(fd);
+        return;
+    }
+#ifdef HAVE_ZLIB
+    inner->dont_check_crc = state->dont_check_crc;
+#endif
+    inner->fast_seek = g_ptr_array_new();
+
+    ra = g_new0(struct readahead, 1);
+    ra->inner = inner;
+    for (i = 0; i < RA_NUM_CHUNKS; i++) {
+        ra->chunks[i].data = (unsigned char *)g_malloc(RA_CHUNK_SIZE);
+        ra->chunks[i].points = g_ptr_array_new();
+    }
+#if GLIB_CHECK_VERSION(2,31,0)
+    ra->mtx = g_new(GMutex, 1);
+    g_mutex_init(ra->mtx);
+    ra->cond = g_new(GCond, 1);
+    g_cond_init(ra->cond);
+#else
+    ra->mtx = g_mutex_new();
+    ra->cond = g_cond_new();
+#endif
+    g_queue_init(&ra->free_chunks);
+    g_queue_init(&ra->full_chunks);
+    for (i = 0; i < RA_NUM_CHUNKS; i++)
+        g_queue_push_tail(&ra->free_chunks, &ra->chunks[i]);
+
+#ifdef HAVE_ZLIB
+    /*
+     * Does it start with a BGZF member, with a "BC" extra subfield?
+     * If so, and we have more than one processor, inflate its members
+     * in parallel.
+     */
+    if (got == sizeof magic && magic[0] == 31 && magic[1] == 139 &&
+        magic[3] == 4 && magic[12] == 'B' && magic[13] == 'C') {
+#if GLIB_CHECK_VERSION(2,36,0)
+        guint nworkers = g_get_num_processors();
+#else
+        guint nworkers = 4;
+#endif
+
+        if (nworkers > RA_NUM_CHUNKS - 2)
+            nworkers = RA_NUM_CHUNKS - 2;
+        if (nworkers > 1)
+            ra->pool = g_thread_pool_new(bgzf_inflate_chunk, ra, nworkers, FALSE, NULL);
+        if (ra->pool != NULL) {
+            for (i = 0; i < RA_NUM_CHUNKS; i++) {
+                ra->chunks[i].raw = (unsigned char *)g_malloc(RA_RAW_SIZE);
+                ra->chunks[i].members = g_array_new(FALSE, FALSE, sizeof (struct bgzf_member));
+            }
+        }
     }
 #endif
-    return 0;
+
+    state->ra = ra;
 }
 
-static int
-gz_skip(FILE_T state, gint64 len)
+static void
+fast_seek_point_free(gpointer data, gpointer user_data _U_)
 {
-    guint n;
-
-    /* skip over len bytes or reach end-of-file, whichever comes first */
-    while (len)
-        if (state->have) {
-            /* We have stuff in the output buffer; skip over
-               it. */
-            n = (gint64)state->have > len ? (unsigned)len : state->have;
-            state->have -= n;
-            state->next += n;
-            state->pos += n;
-            len -= n;
-        } else if (state->err) {
-            /* We have nothing in the output buffer, and
-               we have an error that may not have been
-               reported yet; that means we can't generate
-               any more data into the output buffer, so
-               return an error indication. */
-            return -1;
-        } else if (state->eof && state->avail_in == 0) {
-            /* We have nothing in the output buffer, and
-               we're at the end of the input; just return. */
-            break;
-        } else {
-            /* We have nothing in the output buffer, and
-               we can generate more data; get more output,
-               looking for header if required. */
-            if (fill_out_buffer(state) == -1)
-                return -1;
-        }
-    return 0;
+    g_free(data);
 }
 
 static void
-gz_reset(FILE_T state)
+readahead_free(FILE_T state)
 {
-    state->have = 0;              /* no output data available */
-    state->eof = FALSE;           /* not at end of file */
-    state->compression = UNKNOWN; /* look for gzip header */
+    struct readahead *ra = state->ra;
+    guint i;
 
-    state->seek_pending = FALSE;  /* no seek request pending */
-    state->err = 0;               /* clear error */
-    state->err_info = NULL;
-    state->pos = 0;               /* no uncompressed data yet */
-    state->avail_in = 0;          /* no input data yet */
+    if (ra == NULL)
+        return;
+    readahead_stop_thread(ra);
+#ifdef HAVE_ZLIB
+    if (ra->pool != NULL) {
+        g_thread_pool_free(ra->pool, FALSE, TRUE);
+        for (i = 0; i < RA_NUM_CHUNKS; i++) {
+            g_free(ra->chunks[i].raw);
+            g_array_free(ra->chunks[i].members, TRUE);
+        }
+    }
+#endif
+    for (i = 0; i < RA_NUM_CHUNKS; i++) {
+        g_ptr_array_foreach(ra->chunks[i].points, fast_seek_point_free, NULL);
+        g_ptr_array_free(ra->chunks[i].points, TRUE);
+        g_free(ra->chunks[i].data);
+    }
+    g_queue_clear(&ra->free_chunks);
+    g_queue_clear(&ra->full_chunks);
+#if GLIB_CHECK_VERSION(2,31,0)
+    g_mutex_clear(ra->mtx);
+    g_free(ra->mtx);
+    g_cond_clear(ra->cond);
+    g_free(ra->cond);
+#else
+    g_mutex_free(ra->mtx);
+    g_cond_free(ra->cond);
+#endif
+    g_ptr_array_foreach(ra->inner->fast_seek, fast_seek_point_free, NULL);
+    g_ptr_array_free(ra->inner->fast_seek, TRUE);
+    file_close(ra->inner);
+    g_free(ra);
+    state->ra = NULL;
 }
 
 FILE_T
@@ -782,6 +2270,20 @@ file_fdopen(int fd)
 
     state->fast_seek_cur = NULL;
     state->fast_seek = NULL;
+    state->path = NULL;
+    state->is_random = FALSE;
+    state->save_fast_seek_index = FALSE;
+    state->fast_seek_loaded = 0;
+
+    /* not mapped; file_open() will allow it for regular files */
+    state->try_map = FALSE;
+    state->map = NULL;
+    state->map_size = 0;
+    state->next = NULL;
+
+    /* no readahead unless asked for */
+    state->want_readahead = FALSE;
+    state->ra = NULL;
 
     /* open the file with the appropriate mode (or just use fd) */
     state->fd = fd;
@@ -841,6 +2343,12 @@ file_fdopen(int fd)
 
     /* for now, assume we should check the crc */
     state->dont_check_crc = FALSE;
+#endif
+#ifdef HAVE_ZSTD
+    state->zstd_ds = NULL;
+#endif
+#ifdef HAVE_LZ4
+    state->lz4_dctx = NULL;
 #endif
     /* return stream */
     return state;
@@ -874,6 +2382,15 @@ file_open(const char *path)
         return NULL;
     }
 
+    /*
+     * We're reading this file from its beginning, so, if it turns
+     * out to be uncompressed, we can read it through a mapping.
+     */
+    ft->try_map = TRUE;
+
+    /* Remember where the file is, for its fast seek index. */
+    ft->path = g_strdup(path);
+
 #ifdef HAVE_ZLIB
     /*
      * If this file's name ends in ".caz", it's probably a compressed
@@ -899,9 +2416,24 @@ file_open(const char *path)
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+    stream->is_random = random_flag;
+    if (random_flag)
+        fast_seek_index_load(stream);
+}
+
+void
+file_set_save_fast_seek_index(FILE_T stream, gboolean save)
+{
+    stream->save_fast_seek_index = save;
+}
+
+void
+file_set_readahead(FILE_T stream, gboolean readahead)
+{
+    stream->want_readahead = readahead;
 }
 
 gint64
@@ -935,10 +2467,36 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         offset += file->skip;
     file->seek_pending = FALSE;
 
+    if (file->ra != NULL)
+        return readahead_seek(file, offset, err);
+
+    /*
+     * Is the file memory-mapped, and are we seeking within the mapping?
+     */
+    if (file->map != NULL && file->compression == UNCOMPRESSED &&
+        !file->is_compressed && file->pos + offset < file->map_size &&
+        map_check(file)) {
+        /*
+         * Yes.  Just point the output buffer at the new position.
+         */
+        if (file->pos + offset < 0) {        /* before start of file! */
+            *err = EINVAL;
+            return -1;
+        }
+        map_fill(file, file->pos + offset);
+        file->pos += offset;
+        file->eof = FALSE;
+        file->err = 0;
+        file->err_info = NULL;
+        file->avail_in = 0;
+        return file->pos;
+    }
+
     /*
      * Are we seeking backwards and, if so, do we have data in the buffer?
      */
-    if (offset < 0 && file->next) {
+    if (offset < 0 && file->next && file->next >= file->out &&
+        file->next <= file->out + (file->size << 1)) {
         /*
          * Yes.
          *
@@ -1002,6 +2560,18 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off = here->in;
             off2 = here->out;
         } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            off = here->in;
+            off2 = here->out;
+        } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            off = here->in;
+            off2 = here->out;
+        } else
 #endif
         {
             off2 = (file->pos + offset);
@@ -1054,6 +2624,26 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             strm->adler = crc32(0L, Z_NULL, 0);
             file->compression = ZLIB;
         } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            /* the point is at the start of a frame */
+            if (zstd_reset(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
+            file->compression = ZSTD;
+        } else
+#endif
+#ifdef HAVE_LZ4
+        if (here->compression == LZ4) {
+            /* the point is at the start of a frame */
+            if (lz4_reset(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
+            file->compression = LZ4;
+        } else
 #endif
             file->compression = here->compression;
 
@@ -1084,12 +2674,18 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
     {
         /*
          * Yes.  Just seek there within the file.
+         *
+         * Seek to an absolute offset computed from raw_pos rather than
+         * relative to the file descriptor's offset, as that isn't moved
+         * while the file is mapped.
          */
-        if (ws_lseek64(file->fd, offset - file->have, SEEK_CUR) == -1) {
+        gint64 raw_target = file->raw_pos + (offset - file->have);
+
+        if (ws_lseek64(file->fd, raw_target, SEEK_SET) == -1) {
             *err = errno;
             return -1;
         }
-        file->raw_pos += (offset - file->have);
+        file->raw_pos = raw_target;
         file->have = 0;
         file->eof = FALSE;
         file->seek_pending = FALSE;
@@ -1416,11 +3012,26 @@ file_clearerr(FILE_T stream)
     stream->err = 0;
     stream->err_info = NULL;
     stream->eof = FALSE;
+
+    /*
+     * If the readahead thread stopped at the end of the input or at
+     * an error, clear that on the inner stream as well, so that the
+     * thread, once started again, tries to read more.
+     */
+    if (stream->ra != NULL && stream->ra->done) {
+        readahead_stop_thread(stream->ra);
+        file_clearerr(stream->ra->inner);
+    }
 }
 
 void
 file_fdclose(FILE_T file)
 {
+    file_unmap(file);
+    if (file->ra != NULL) {
+        readahead_stop_thread(file->ra);
+        file_fdclose(file->ra->inner);
+    }
     ws_close(file->fd);
     file->fd = -1;
 }
@@ -1433,6 +3044,15 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
     file->fd = fd;
+    file->try_map = (file->start == 0);
+    if (file->ra != NULL) {
+        FILE_T inner = file->ra->inner;
+
+        if ((inner->fd = ws_dup(fd)) == -1)
+            return FALSE;
+        if (ws_lseek64(inner->fd, inner->raw_pos, SEEK_SET) == -1)
+            return FALSE;
+    }
     return TRUE;
 }
 
@@ -1441,7 +3061,13 @@ file_close(FILE_T file)
 {
     int fd = file->fd;
 
+    /* save the fast seek points for the next time the file is opened */
+    if (file->is_random && file->save_fast_seek_index && fd != -1)
+        fast_seek_index_save(file);
+
     /* free memory and close file */
+    file_unmap(file);
+    readahead_free(file);
     if (file->size) {
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
@@ -1449,7 +3075,16 @@ file_close(FILE_T file)
         g_free(file->out);
         g_free(file->in);
     }
+#ifdef HAVE_ZSTD
+    if (file->zstd_ds != NULL)
+        ZSTD_freeDStream(file->zstd_ds);
+#endif
+#ifdef HAVE_LZ4
+    if (file->lz4_dctx != NULL)
+        (void)LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
     g_free(file->fast_seek_cur);
+    g_free(file->path);
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
@@ -1755,6 +3390,251 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*
+ * Zstandard and LZ4 file writing.
+ *
+ * We collect FRAME_DATA_SIZE bytes of uncompressed data, the same
+ * distance apart as the fast seek points for gzipped files, and
+ * compress them as one frame, which can be decompressed without
+ * anything that precedes it; the reading code adds a fast seek
+ * point at the start of each frame.  Frames are only cut when they
+ * fill up and when the file is closed, so that flushing after every
+ * packet doesn't turn the file into a series of tiny frames; the data
+ * of the last, unfinished frame only reaches the file when it's closed.
+ */
+#define FRAME_DATA_SIZE     (1024 * 1024)
+
+/* Fast, as we may be writing at capture rates */
+#define FRAME_ZSTD_LEVEL    1
+
+/* internal Zstandard/LZ4 file state data structure for writing */
+struct wtap_frame_writer {
+    int fd;                 /* file descriptor */
+    wtap_compression_type compression_type;
+    unsigned char *in;      /* uncompressed data for the current frame */
+    guint have;             /* amount of data in it */
+    unsigned char *out;     /* compressed frame */
+    size_t out_size;        /* size of the output buffer */
+    int err;                /* error code */
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd_cctx;   /* compression context, reused for every frame */
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_preferences_t lz4_prefs;
+#endif
+};
+
+FRAMEWFILE_T
+framewfile_open(const char *path, wtap_compression_type compression_type,
+                int *err)
+{
+    int fd;
+    FRAMEWFILE_T state;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1) {
+        *err = errno;
+        return NULL;
+    }
+    state = framewfile_fdopen(fd, compression_type, err);
+    if (state == NULL)
+        ws_close(fd);
+    return state;
+}
+
+FRAMEWFILE_T
+framewfile_fdopen(int fd, wtap_compression_type compression_type, int *err)
+{
+    FRAMEWFILE_T state;
+
+    /* allocate wtap_frame_writer structure to return */
+    state = g_new0(struct wtap_frame_writer, 1);
+    state->fd = fd;
+    state->compression_type = compression_type;
+
+    switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->zstd_cctx = ZSTD_createCCtx();
+        if (state->zstd_cctx == NULL)
+            goto nomem;
+        state->out_size = ZSTD_compressBound(FRAME_DATA_SIZE);
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        /* record the content size of each frame, for the benefit of readers */
+        state->lz4_prefs.frameInfo.contentSize = FRAME_DATA_SIZE;
+        state->out_size = LZ4F_compressFrameBound(FRAME_DATA_SIZE, &state->lz4_prefs);
+        break;
+#endif
+
+    default:
+        g_free(state);
+        *err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return NULL;
+    }
+
+    state->in = (unsigned char *)g_try_malloc(FRAME_DATA_SIZE);
+    state->out = (unsigned char *)g_try_malloc(state->out_size);
+    if (state->in == NULL || state->out == NULL)
+        goto nomem;
+
+    /* return stream */
+    return state;
+
+nomem:
+    g_free(state->out);
+    g_free(state->in);
+#ifdef HAVE_ZSTD
+    if (state->zstd_cctx != NULL)
+        ZSTD_freeCCtx(state->zstd_cctx);
+#endif
+    g_free(state);
+    *err = ENOMEM;
+    return NULL;
+}
+
+/* Compress the data we have as one frame and write it out.  Return -1,
+   and set state->err, on failure; return 0 on success. */
+static int
+frame_comp(FRAMEWFILE_T state)
+{
+    size_t len;
+    ssize_t got;
+
+    if (state->have == 0)
+        return 0;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        len = ZSTD_compressCCtx(state->zstd_cctx, state->out, state->out_size,
+                                state->in, state->have, FRAME_ZSTD_LEVEL);
+        if (ZSTD_isError(len)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        state->lz4_prefs.frameInfo.contentSize = state->have;
+        len = LZ4F_compressFrame(state->out, state->out_size,
+                                 state->in, state->have, &state->lz4_prefs);
+        if (LZ4F_isError(len)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+#endif
+
+    default:
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+
+    got = ws_write(state->fd, state->out, (unsigned int)len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    state->have = 0;
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+guint
+framewfile_write(FRAMEWFILE_T state, const void *buf, guint len)
+{
+    guint put = len;
+    guint n;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* copy to the frame buffer, compressing whenever it fills up */
+    do {
+        n = FRAME_DATA_SIZE - state->have;
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->have, buf, n);
+        state->have += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->have == FRAME_DATA_SIZE && frame_comp(state) == -1)
+            return 0;
+    } while (len);
+
+    return put;
+}
+
+/* Data is only written out a whole frame at a time, so there's nothing
+   to flush; returns -1 if there was an earlier error, 0 otherwise. */
+int
+framewfile_flush(FRAMEWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success.
+
+   If is_stdout is true, do all of that except for closing the file
+   descriptor, as with gzwfile_close(). */
+int
+framewfile_close(FRAMEWFILE_T state, gboolean is_stdout)
+{
+    int ret = 0;
+
+    /* flush, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (frame_comp(state) == -1)
+        ret = state->err;
+#ifdef HAVE_ZSTD
+    if (state->zstd_cctx != NULL)
+        ZSTD_freeCCtx(state->zstd_cctx);
+#endif
+    g_free(state->out);
+    g_free(state->in);
+    if (!is_stdout) {
+        if (ws_close(state->fd) == -1 && ret == 0)
+            ret = errno;
+    }
+    g_free(state);
+    return ret;
+}
+
+int
+framewfile_geterr(FRAMEWFILE_T state)
+{
+    return state->err;
+}
+#endif
+
 /*
  * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
  *
@@ -29,6 +29,8 @@
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_set_save_fast_seek_index(FILE_T stream, gboolean save);
+extern void file_set_readahead(FILE_T stream, gboolean readahead);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 extern gboolean file_skip(FILE_T file, gint64 delta, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
@@ -57,4 +59,15 @@ extern int gzwfile_close(GZWFILE_T state, gboolean is_stdout);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_ZLIB */
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+typedef struct wtap_frame_writer *FRAMEWFILE_T;
+
+extern FRAMEWFILE_T framewfile_open(const char *path, wtap_compression_type compression_type, int *err);
+extern FRAMEWFILE_T framewfile_fdopen(int fd, wtap_compression_type compression_type, int *err);
+extern guint framewfile_write(FRAMEWFILE_T state, const void *buf, guint len);
+extern int framewfile_flush(FRAMEWFILE_T state);
+extern int framewfile_close(FRAMEWFILE_T state, gboolean is_stdout);
+extern int framewfile_geterr(FRAMEWFILE_T state);
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
 #endif /* __FILE_H__ */
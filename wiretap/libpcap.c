@@ -64,6 +64,8 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
     gint64 *data_offset);
 static gboolean libpcap_seek_read(wtap *wth, gint64 seek_off,
     struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
+static gboolean libpcap_read_batch(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info);
 static gboolean libpcap_read_packet(wtap *wth, FILE_T fh,
     struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
 static gboolean libpcap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
@@ -269,6 +271,7 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
 	wth->priv = (void *)libpcap;
 	wth->subtype_read = libpcap_read;
 	wth->subtype_seek_read = libpcap_seek_read;
+	wth->subtype_read_batch = libpcap_read_batch;
 	wth->subtype_close = libpcap_close;
 	wth->file_encap = file_encap;
 	wth->snapshot_length = hdr.snaplen;
@@ -621,6 +624,31 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	    wth->frame_buffer, err, err_info);
 }
 
+/*
+ * Read records straight into a batch, rather than into wth->phdr and
+ * wth->frame_buffer and moving them from there.  Returns FALSE if we
+ * stopped before filling the batch, because of an error or because we
+ * got to the end of the file.
+ */
+static gboolean
+libpcap_read_batch(wtap *wth, wtap_batch *batch, int *err, gchar **err_info)
+{
+	wtap_batch_rec *rec;
+
+	while (batch->count < batch->size) {
+		rec = &batch->recs[batch->count];
+		/* See wtap_read() */
+		rec->phdr.pkt_encap = wth->file_encap;
+		rec->phdr.pkt_tsprec = wth->file_tsprec;
+		rec->data_offset = file_tell(wth->fh);
+		if (!libpcap_read_packet(wth, wth->fh, &rec->phdr, &rec->buf,
+		    err, err_info))
+			return FALSE;
+		batch->count++;
+	}
+	return TRUE;
+}
+
 static gboolean
 libpcap_seek_read(wtap *wth, gint64 seek_off, struct wtap_pkthdr *phdr,
     Buffer *buf, int *err, gchar **err_info)
@@ -225,6 +225,115 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
     return TRUE;
 }
 
+/*
+ * Returns TRUE if the pending packet of the first input file should be
+ * written before the pending packet of the second one.
+ *
+ * Packets with identical time stamps are taken from the input file that
+ * comes later in the in_files array first; that's the order the old
+ * linear scan produced, and we don't want merged output to change.
+ */
+static gboolean
+in_file_is_earlier(const merge_in_file_t *l, const merge_in_file_t *r)
+{
+    nstime_t *l_ts = &wtap_phdr(l->wth)->ts;
+    nstime_t *r_ts = &wtap_phdr(r->wth)->ts;
+
+    if (l_ts->secs != r_ts->secs || l_ts->nsecs != r_ts->nsecs)
+        return is_earlier(l_ts, r_ts);
+    return l > r;
+}
+
+/*
+ * Binary min-heap of the input files that have a packet pending, keyed
+ * on the time stamp of that packet, so that picking the next packet to
+ * write is O(log n) in the number of input files rather than O(n).
+ */
+typedef struct {
+    merge_in_file_t **entries;
+    guint             count;
+    gboolean          primed;   /* TRUE once every file has been read from */
+} merge_heap_t;
+
+static void
+merge_heap_init(merge_heap_t *heap, guint in_file_count)
+{
+    heap->entries = g_new(merge_in_file_t *, in_file_count);
+    heap->count   = 0;
+    heap->primed  = FALSE;
+}
+
+static void
+merge_heap_free(merge_heap_t *heap)
+{
+    g_free(heap->entries);
+    heap->entries = NULL;
+    heap->count   = 0;
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *heap, guint i)
+{
+    merge_in_file_t *in_file = heap->entries[i];
+    guint parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!in_file_is_earlier(in_file, heap->entries[parent]))
+            break;
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i] = in_file;
+}
+
+/*
+ * Restore the heap property after the root's key has grown.
+ *
+ * When the input files don't overlap in time - e.g. consecutive ring
+ * buffer files - the new root packet is still the earliest one, so this
+ * costs at most two comparisons and the merge degenerates to appending.
+ */
+static void
+merge_heap_sift_down(merge_heap_t *heap)
+{
+    merge_in_file_t *in_file = heap->entries[0];
+    guint i = 0;
+    guint child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            in_file_is_earlier(heap->entries[child + 1], heap->entries[child]))
+            child++;
+        if (!in_file_is_earlier(heap->entries[child], in_file))
+            break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = in_file;
+}
+
+/*
+ * Read the next packet from an input file, updating its state.
+ * Returns FALSE on a read error, with *err and *err_info set.
+ */
+static gboolean
+merge_read_in_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    if (!wtap_read(in_file->wth, err, err_info, &in_file->data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
+    } else
+        in_file->state = PACKET_PRESENT;
+    return TRUE;
+}
+
 /** Read the next packet, in chronological order, from the set of files to
  * be merged.
  *
@@ -239,6 +348,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap heap of input files with a packet pending
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -246,61 +356,66 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+                  merge_heap_t *heap, int *err, gchar **err_info)
 {
     int i;
-    int ei = -1;
-    nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-    struct wtap_pkthdr *phdr;
+    merge_in_file_t *in_file;
 
-    /*
-     * Make sure we have a packet available from each file, if there are any
-     * packets left in the file in question, and search for the packet
-     * with the earliest time stamp.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        if (in_files[i].state == PACKET_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
+    if (!heap->primed) {
+        /*
+         * Make sure we have a packet available from each file, if there
+         * are any packets left in the file in question, and put the files
+         * that have one on the heap.
+         */
+        for (i = 0; i < in_file_count; i++) {
+            if (in_files[i].state == PACKET_NOT_PRESENT) {
+                if (!merge_read_in_file(&in_files[i], err, err_info))
                     return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = PACKET_PRESENT;
-        }
-
-        if (in_files[i].state == PACKET_PRESENT) {
-            phdr = wtap_phdr(in_files[i].wth);
-            if (is_earlier(&phdr->ts, &tv)) {
-                tv = phdr->ts;
-                ei = i;
             }
+            if (in_files[i].state == PACKET_PRESENT) {
+                heap->entries[heap->count] = &in_files[i];
+                merge_heap_sift_up(heap, heap->count);
+                heap->count++;
+            }
+        }
+        heap->primed = TRUE;
+    } else if (heap->count > 0 &&
+               heap->entries[0]->state == PACKET_NOT_PRESENT) {
+        /*
+         * The packet we returned last time came from the file at the
+         * root of the heap; replace it with that file's next packet.
+         */
+        in_file = heap->entries[0];
+        if (!merge_read_in_file(in_file, err, err_info))
+            return in_file;
+        if (in_file->state == AT_EOF) {
+            heap->count--;
+            heap->entries[0] = heap->entries[heap->count];
         }
+        if (heap->count > 0)
+            merge_heap_sift_down(heap);
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    in_file = heap->entries[0];
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = PACKET_NOT_PRESENT;
+    in_file->state = PACKET_NOT_PRESENT;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    in_file->packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return in_file;
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -973,6 +1088,7 @@ merge_files(int out_fd, const gchar* out_filename, const int file_type,
     gboolean            stop_flag = FALSE;
     GArray             *shb_hdrs = NULL;
     wtapng_iface_descriptions_t *idb_inf = NULL;
+    merge_heap_t        heap;
 
     g_assert(out_fd > 0);
     g_assert(in_file_count > 0);
@@ -1041,6 +1157,8 @@ merge_files(int out_fd, const gchar* out_filename, const int file_type,
     if (cb)
         cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, in_file_count, cb->data);
 
+    merge_heap_init(&heap, in_file_count);
+
     for (;;) {
         *err = 0;
 
@@ -1049,8 +1167,8 @@ merge_files(int out_fd, const gchar* out_filename, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(in_file_count, in_files, &heap,
+                                        err, err_info);
         }
 
         if (in_file == NULL) {
@@ -1110,6 +1228,8 @@ merge_files(int out_fd, const gchar* out_filename, const int file_type,
         }
     }
 
+    merge_heap_free(&heap);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -0,0 +1,481 @@
+/* wiretap_test.c
+ * Tests for reading capture files with Wiretap
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Usage: wiretap_test [GTest options] <gzipped capture file> <pcap file>
+ *            <pcapng file>
+ *
+ * The tests tell whether an index file was rewritten from its inode
+ * number, and change files' modification times, so they're only run
+ * on UN*X.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include <glib.h>
+
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+#include "wtap.h"
+
+#ifndef _WIN32
+/* Scratch directory, used as the cache directory */
+static gchar *tmp_dir;
+
+/* Copy of the capture file in tmp_dir, which we can change the
+ * modification time of */
+static gchar *capture_file;
+
+/* Where the read routines should put the index files */
+static gchar *index_dir;
+
+/* Uncompressed pcap file given on the command line, and our copy of it */
+static gchar *pcap_contents;
+static gsize pcap_length;
+static gchar *pcap_file;
+
+static wtap *
+open_capture(gboolean save_index)
+{
+    wtap  *wth;
+    int    err;
+    gchar *err_info = NULL;
+
+    wth = wtap_open_offline(capture_file, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    if (wth == NULL)
+        g_error("Can't open %s: %s", capture_file, wtap_strerror(err));
+    wtap_set_save_fast_seek_index(wth, save_index);
+    return wth;
+}
+
+/* Read the capture sequentially, returning the offset of its last record */
+static gint64
+read_capture(wtap *wth)
+{
+    int    err;
+    gchar *err_info = NULL;
+    gint64 data_offset, last_offset = -1;
+
+    while (wtap_read(wth, &err, &err_info, &data_offset))
+        last_offset = data_offset;
+    if (err != 0)
+        g_error("Can't read %s: %s", capture_file, wtap_strerror(err));
+    g_assert(last_offset != -1);
+    return last_offset;
+}
+
+/* Read the record at the offset with random access */
+static void
+seek_read_capture(wtap *wth, gint64 offset, Buffer *buf)
+{
+    struct wtap_pkthdr phdr;
+    int                err;
+    gchar             *err_info = NULL;
+
+    wtap_phdr_init(&phdr);
+    if (!wtap_seek_read(wth, offset, &phdr, buf, &err, &err_info))
+        g_error("Can't seek in %s: %s", capture_file, wtap_strerror(err));
+    wtap_phdr_cleanup(&phdr);
+}
+
+/* Path of the one index file in index_dir, or NULL if there isn't one */
+static gchar *
+find_index(void)
+{
+    GDir        *dir;
+    const gchar *name;
+    gchar       *path = NULL;
+
+    dir = g_dir_open(index_dir, 0, NULL);
+    if (dir == NULL)
+        return NULL;
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        if (!g_str_has_suffix(name, ".gzidx"))
+            continue;
+        g_assert(path == NULL);
+        path = g_build_filename(index_dir, name, NULL);
+    }
+    g_dir_close(dir);
+    return path;
+}
+
+static void
+remove_index(void)
+{
+    gchar *path = find_index();
+
+    if (path != NULL) {
+        ws_unlink(path);
+        g_free(path);
+    }
+}
+
+/* Inode number of the index file; it changes whenever the index is
+ * saved, as that's done by renaming a new file over it */
+static ino_t
+index_inode(void)
+{
+    gchar       *path;
+    struct stat  st;
+
+    path = find_index();
+    g_assert(path != NULL);
+    if (stat(path, &st) == -1)
+        g_error("Can't stat %s: %s", path, g_strerror(errno));
+    g_free(path);
+    return st.st_ino;
+}
+
+/*
+ * The points are saved when the file is closed, and loaded, instead of
+ * being rebuilt and saved again, when it's opened again; the same record
+ * is read either way.
+ */
+static void
+test_fast_seek_index_load(void)
+{
+    wtap   *wth;
+    gint64  last_offset;
+    Buffer  buf1, buf2;
+    ino_t   inode;
+
+    remove_index();
+    ws_buffer_init(&buf1, 1500);
+    ws_buffer_init(&buf2, 1500);
+
+    wth = open_capture(TRUE);
+    last_offset = read_capture(wth);
+    seek_read_capture(wth, last_offset, &buf1);
+    wtap_close(wth);
+    inode = index_inode();
+
+    wth = open_capture(TRUE);
+    seek_read_capture(wth, last_offset, &buf2);
+    wtap_close(wth);
+    g_assert(index_inode() == inode);
+
+    g_assert(ws_buffer_length(&buf1) == ws_buffer_length(&buf2));
+    g_assert(memcmp(ws_buffer_start_ptr(&buf1), ws_buffer_start_ptr(&buf2),
+                    ws_buffer_length(&buf1)) == 0);
+    ws_buffer_free(&buf1);
+    ws_buffer_free(&buf2);
+}
+
+/* An index saved for an earlier version of the capture file is ignored */
+static void
+test_fast_seek_index_stale(void)
+{
+    wtap           *wth;
+    gint64          last_offset;
+    Buffer          buf;
+    ino_t           inode;
+    struct utimbuf  times;
+
+    remove_index();
+    ws_buffer_init(&buf, 1500);
+
+    wth = open_capture(TRUE);
+    last_offset = read_capture(wth);
+    wtap_close(wth);
+    inode = index_inode();
+
+    times.actime = times.modtime = 1000000000;
+    if (utime(capture_file, &times) == -1)
+        g_error("Can't change the time of %s: %s", capture_file, g_strerror(errno));
+
+    wth = open_capture(TRUE);
+    seek_read_capture(wth, last_offset, &buf);
+    wtap_close(wth);
+    g_assert(index_inode() != inode);
+    ws_buffer_free(&buf);
+}
+
+/* Nothing is saved unless it was asked for, or if it's turned off */
+static void
+test_fast_seek_index_not_saved(void)
+{
+    wtap *wth;
+
+    remove_index();
+    wth = open_capture(FALSE);
+    read_capture(wth);
+    wtap_close(wth);
+    g_assert(find_index() == NULL);
+
+    g_setenv("WIRESHARK_NO_FAST_SEEK_INDEX", "1", TRUE);
+    wth = open_capture(TRUE);
+    read_capture(wth);
+    wtap_close(wth);
+    g_unsetenv("WIRESHARK_NO_FAST_SEEK_INDEX");
+    g_assert(find_index() == NULL);
+}
+
+/*
+ * An uncompressed file is read through a mapping if it's old enough.
+ * If it grows while it's open, the part that's added can be read,
+ * both sequentially and with random access, and the records in the
+ * part that was mapped first can still be read with random access,
+ * in any order.
+ */
+static void
+test_mapped_file_grows(void)
+{
+    wtap               *wth;
+    struct wtap_pkthdr *phdr;
+    int                 err;
+    gchar              *err_info = NULL;
+    gint64              data_offset;
+    GArray             *offsets;
+    GPtrArray          *records;
+    GByteArray         *record;
+    struct utimbuf      times;
+    FILE               *fp;
+    gint64              added;
+    Buffer              buf;
+    guint               i, count;
+
+    if (!g_file_set_contents(pcap_file, pcap_contents, pcap_length, NULL))
+        g_error("Can't create %s", pcap_file);
+    /* old enough to be mapped */
+    times.actime = times.modtime = 1000000000;
+    if (utime(pcap_file, &times) == -1)
+        g_error("Can't change the time of %s: %s", pcap_file, g_strerror(errno));
+
+    wth = wtap_open_offline(pcap_file, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    if (wth == NULL)
+        g_error("Can't open %s: %s", pcap_file, wtap_strerror(err));
+
+    offsets = g_array_new(FALSE, FALSE, sizeof (gint64));
+    records = g_ptr_array_new();
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        phdr = wtap_phdr(wth);
+        record = g_byte_array_new();
+        g_byte_array_append(record, wtap_buf_ptr(wth), phdr->caplen);
+        g_array_append_val(offsets, data_offset);
+        g_ptr_array_add(records, record);
+    }
+    g_assert(err == 0);
+    count = records->len;
+    g_assert(count != 0);
+
+    /* Map the file for random access too, while it's still old enough */
+    ws_buffer_init(&buf, 1500);
+    seek_read_capture(wth, g_array_index(offsets, gint64, count - 1), &buf);
+
+    /* Append the records again, without the file header */
+    added = (gint64)pcap_length - g_array_index(offsets, gint64, 0);
+    fp = ws_fopen(pcap_file, "ab");
+    if (fp == NULL ||
+        fwrite(pcap_contents + g_array_index(offsets, gint64, 0), (size_t)added, 1, fp) != 1 ||
+        fclose(fp) != 0)
+        g_error("Can't append to %s", pcap_file);
+
+    /* Carry on reading sequentially, as when tailing a file */
+    wtap_cleareof(wth);
+    i = 0;
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        g_assert(i < count);
+        record = (GByteArray *)g_ptr_array_index(records, i);
+        g_assert(data_offset == g_array_index(offsets, gint64, i) + added);
+        g_assert(wtap_phdr(wth)->caplen == record->len);
+        g_assert(memcmp(wtap_buf_ptr(wth), record->data, record->len) == 0);
+        i++;
+    }
+    g_assert(err == 0);
+    g_assert(i == count);
+
+    /* Backwards through both copies, with random access */
+    for (i = 2 * count; i-- != 0; ) {
+        record = (GByteArray *)g_ptr_array_index(records, i % count);
+        data_offset = g_array_index(offsets, gint64, i % count);
+        if (i >= count)
+            data_offset += added;
+        seek_read_capture(wth, data_offset, &buf);
+        g_assert(ws_buffer_length(&buf) == record->len);
+        g_assert(memcmp(ws_buffer_start_ptr(&buf), record->data, record->len) == 0);
+    }
+    ws_buffer_free(&buf);
+
+    wtap_close(wth);
+    for (i = 0; i < count; i++)
+        g_byte_array_free((GByteArray *)g_ptr_array_index(records, i), TRUE);
+    g_ptr_array_free(records, TRUE);
+    g_array_free(offsets, TRUE);
+}
+
+/*
+ * Reading a file with wtap_read_batch() gives the same records as
+ * reading it with wtap_read(), whether the file type reads batches
+ * itself (pcap) or not (pcapng), with batches that end in the middle
+ * of the file and at its end.
+ */
+static void
+test_read_batch(gconstpointer data)
+{
+    const gchar        *path = (const gchar *)data;
+    static const guint  batch_sizes[] = { 1, 3, 1000 };
+    wtap               *wth, *batch_wth;
+    wtap_batch         *batch;
+    wtap_batch_rec     *rec;
+    struct wtap_pkthdr *phdr;
+    int                 err, batch_err;
+    gchar              *err_info = NULL;
+    gint64              data_offset;
+    guint               i, j, n, count;
+
+    for (i = 0; i < G_N_ELEMENTS(batch_sizes); i++) {
+        wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+        if (wth == NULL)
+            g_error("Can't open %s: %s", path, wtap_strerror(err));
+        batch_wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+        if (batch_wth == NULL)
+            g_error("Can't open %s: %s", path, wtap_strerror(err));
+        batch = wtap_batch_new(batch_sizes[i]);
+
+        count = 0;
+        while ((n = wtap_read_batch(batch_wth, batch, &batch_err, &err_info)) != 0) {
+            g_assert(n == batch->count);
+            g_assert(n <= batch->size);
+            for (j = 0; j < n; j++) {
+                rec = &batch->recs[j];
+                if (!wtap_read(wth, &err, &err_info, &data_offset))
+                    g_error("%s ended early: %s", path, wtap_strerror(err));
+                phdr = wtap_phdr(wth);
+                g_assert(rec->data_offset == data_offset);
+                g_assert(rec->phdr.rec_type == phdr->rec_type);
+                g_assert(rec->phdr.presence_flags == phdr->presence_flags);
+                g_assert(rec->phdr.ts.secs == phdr->ts.secs);
+                g_assert(rec->phdr.ts.nsecs == phdr->ts.nsecs);
+                g_assert(rec->phdr.caplen == phdr->caplen);
+                g_assert(rec->phdr.len == phdr->len);
+                g_assert(rec->phdr.pkt_encap == phdr->pkt_encap);
+                g_assert(rec->phdr.pkt_tsprec == phdr->pkt_tsprec);
+                g_assert(rec->phdr.interface_id == phdr->interface_id);
+                g_assert(memcmp(ws_buffer_start_ptr(&rec->buf), wtap_buf_ptr(wth),
+                                phdr->caplen) == 0);
+                count++;
+            }
+            g_assert(batch_err == 0);
+        }
+        g_assert(batch_err == 0);
+        if (wtap_read(wth, &err, &err_info, &data_offset))
+            g_error("%s has more records than wtap_read_batch() returned", path);
+        g_assert(err == 0);
+        g_assert(count != 0);
+
+        wtap_batch_free(batch);
+        wtap_close(batch_wth);
+        wtap_close(wth);
+    }
+}
+
+static void
+cleanup(void)
+{
+    remove_index();
+    rmdir(index_dir);
+    g_free(index_dir);
+    index_dir = g_build_filename(tmp_dir, "wireshark", NULL);
+    rmdir(index_dir);
+    ws_unlink(capture_file);
+    ws_unlink(pcap_file);
+    rmdir(tmp_dir);
+}
+#endif /* _WIN32 */
+
+int
+main(int argc, char **argv)
+{
+#ifndef _WIN32
+    gchar  *contents;
+    gsize   length;
+    GError *error = NULL;
+    int     ret;
+
+    g_test_init(&argc, &argv, NULL);
+    if (argc != 4) {
+        fprintf(stderr, "Usage: wiretap_test [GTest options] <gzipped capture file> <pcap file> <pcapng file>\n");
+        return 1;
+    }
+
+    /* Keep the index files out of the user's own cache directory */
+    tmp_dir = g_build_filename(g_get_tmp_dir(), "wiretap_test-XXXXXX", NULL);
+    if (mkdtemp(tmp_dir) == NULL)
+        g_error("Can't create a temporary directory: %s", g_strerror(errno));
+    g_setenv("XDG_CACHE_HOME", tmp_dir, TRUE);
+    index_dir = g_build_filename(tmp_dir, "wireshark", "fast-seek", NULL);
+
+    if (!g_file_get_contents(argv[1], &contents, &length, &error))
+        g_error("%s", error->message);
+    capture_file = g_build_filename(tmp_dir, "capture.pcap.gz", NULL);
+    if (!g_file_set_contents(capture_file, contents, length, &error))
+        g_error("%s", error->message);
+    g_free(contents);
+
+    if (!g_file_get_contents(argv[2], &pcap_contents, &pcap_length, &error))
+        g_error("%s", error->message);
+    pcap_file = g_build_filename(tmp_dir, "mapped.pcap", NULL);
+
+    init_open_routines();
+
+    g_test_add_func("/wiretap/fast_seek_index/load", test_fast_seek_index_load);
+    g_test_add_func("/wiretap/fast_seek_index/stale", test_fast_seek_index_stale);
+    g_test_add_func("/wiretap/fast_seek_index/not_saved", test_fast_seek_index_not_saved);
+    g_test_add_func("/wiretap/mapped_file_grows", test_mapped_file_grows);
+    g_test_add_data_func("/wiretap/read_batch/gzipped_pcap", argv[1], test_read_batch);
+    g_test_add_data_func("/wiretap/read_batch/pcap", argv[2], test_read_batch);
+    g_test_add_data_func("/wiretap/read_batch/pcapng", argv[3], test_read_batch);
+
+    ret = g_test_run();
+    cleanup();
+    return ret;
+#else
+    g_test_init(&argc, &argv, NULL);
+    return g_test_run();
+#endif
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
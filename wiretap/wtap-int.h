@@ -40,6 +40,8 @@ typedef gboolean (*subtype_read_func)(struct wtap*, int*, char**, gint64*);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64,
                                            struct wtap_pkthdr *, Buffer *buf,
                                            int *, char **);
+typedef gboolean (*subtype_read_batch_func)(struct wtap*, wtap_batch *,
+                                            int *, char **);
 
 /**
  * Struct holding data of the currently read file.
@@ -60,6 +62,7 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_read_batch_func     subtype_read_batch;     /**< Reads records straight into a batch, or NULL */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -86,7 +89,7 @@ struct wtap {
 struct wtap_dumper;
 
 /*
- * This could either be a FILE * or a gzFile.
+ * This could either be a FILE *, a GZWFILE_T, or a FRAMEWFILE_T.
  */
 typedef void *WFILE_T;
 
@@ -101,7 +104,7 @@ struct wtap_dumper {
     int                     file_type_subtype;
     int                     snaplen;
     int                     encap;
-    gboolean                compressed;
+    wtap_compression_type   compression_type;
     gint64                  bytes_dumped;
 
     void                    *priv;          /* this one holds per-file state and is free'd automatically by wtap_dump_close() */
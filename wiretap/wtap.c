@@ -1206,6 +1206,13 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_save_fast_seek_index(wtap *wth, gboolean save)
+{
+	if (wth->random_fh != NULL)
+		file_set_save_fast_seek_index(wth->random_fh, save);
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -1267,6 +1274,106 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	return TRUE;	/* success */
 }
 
+wtap_batch *
+wtap_batch_new(guint size)
+{
+	wtap_batch *batch;
+	guint i;
+
+	batch = g_new(wtap_batch, 1);
+	batch->size = size;
+	batch->count = 0;
+	batch->recs = g_new(wtap_batch_rec, size);
+	for (i = 0; i < size; i++) {
+		batch->recs[i].data_offset = 0;
+		wtap_phdr_init(&batch->recs[i].phdr);
+		ws_buffer_init(&batch->recs[i].buf, 1500);
+	}
+	return batch;
+}
+
+void
+wtap_batch_free(wtap_batch *batch)
+{
+	guint i;
+
+	if (batch == NULL)
+		return;
+	for (i = 0; i < batch->size; i++) {
+		wtap_phdr_cleanup(&batch->recs[i].phdr);
+		ws_buffer_free(&batch->recs[i].buf);
+	}
+	g_free(batch->recs);
+	g_free(batch);
+}
+
+/*
+ * Swap the contents of two Buffers.  A Buffer owns nothing but its
+ * data, so this hands the data over without copying it.
+ */
+static void
+buffer_swap(Buffer *a, Buffer *b)
+{
+	Buffer tmp;
+
+	tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+guint
+wtap_read_batch(wtap *wth, wtap_batch *batch, int *err, gchar **err_info)
+{
+	wtap_batch_rec *rec;
+	Buffer ft_specific_data;
+	guint i;
+
+	*err = 0;
+	*err_info = NULL;
+	batch->count = 0;
+
+	if (wth->subtype_read_batch != NULL) {
+		/*
+		 * The file type reads records straight into the batch;
+		 * do what wtap_read() does around its read routine.
+		 */
+		if (!wth->subtype_read_batch(wth, batch, err, err_info)) {
+			/* See wtap_read() */
+			if (*err == 0)
+				*err = file_error(wth->fh, err_info);
+		}
+		for (i = 0; i < batch->count; i++) {
+			rec = &batch->recs[i];
+			if (rec->phdr.caplen > rec->phdr.len)
+				rec->phdr.caplen = rec->phdr.len;
+			g_assert(rec->phdr.pkt_encap != WTAP_ENCAP_PER_PACKET);
+		}
+		return batch->count;
+	}
+
+	while (batch->count < batch->size) {
+		rec = &batch->recs[batch->count];
+		if (!wtap_read(wth, err, err_info, &rec->data_offset))
+			break;
+
+		/*
+		 * Move the record out of the wtap into the batch.  Rather
+		 * than copying the data, swap buffers, so that the next
+		 * read goes into the buffer the previous batch used for
+		 * this slot; the file type's read routine overwrites the
+		 * buffer contents anyway.  The header is small, so copy
+		 * it, apart from its file-type-specific data, which is
+		 * swapped like the packet data.
+		 */
+		buffer_swap(wth->frame_buffer, &rec->buf);
+		ft_specific_data = rec->phdr.ft_specific_data;
+		rec->phdr = wth->phdr;
+		wth->phdr.ft_specific_data = ft_specific_data;
+		batch->count++;
+	}
+	return batch->count;
+}
+
 /*
  * Read a given number of bytes from a file.
  *
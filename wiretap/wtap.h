@@ -1342,6 +1342,25 @@ typedef struct wtap_dumper wtap_dumper;
 
 typedef struct wtap_reader *FILE_T;
 
+/**
+ * Types of compression for files being written.
+ *
+ * WTAP_UNCOMPRESSED and WTAP_GZIP_COMPRESSED have the values FALSE and
+ * TRUE, so that code that passes a "compressed" flag to wtap_dump_open()
+ * and friends keeps working.
+ *
+ * Zstandard and LZ4 files are written as a sequence of independent
+ * frames, each holding 1 MiB of uncompressed data, so that readers
+ * can seek to the start of any frame without decompressing what
+ * precedes it.
+ */
+typedef enum {
+    WTAP_UNCOMPRESSED = 0,
+    WTAP_GZIP_COMPRESSED = 1,
+    WTAP_ZSTD_COMPRESSED = 2,
+    WTAP_LZ4_COMPRESSED = 3
+} wtap_compression_type;
+
 /* Similar to the wtap_open_routine_info for open routines, the following
  * wtap_wslua_file_info struct is used by wslua code for Lua-based file writers.
  *
@@ -1519,6 +1538,27 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     gchar **err_info, gboolean do_random);
 
+/**
+ * Set whether wtap_open_offline() should arrange for compressed files to
+ * be decompressed, when read with wtap_read(), in a separate thread that
+ * reads ahead of the caller; the members of BGZF files, such as those
+ * written by bgzip, are also inflated in parallel by a pool of worker
+ * threads.  This is off by default.
+ */
+WS_DLL_PUBLIC
+void wtap_set_readahead(gboolean enable);
+
+/**
+ * Ask for the fast seek points of a compressed file opened for random
+ * access to be saved in the user's cache directory when it's closed, so
+ * that opening it again doesn't mean decompressing all of it to seek in
+ * it.  Only worth doing for files that are likely to be opened again,
+ * such as those opened in Wireshark; nothing is saved if the
+ * WIRESHARK_NO_FAST_SEEK_INDEX environment variable is set.
+ */
+WS_DLL_PUBLIC
+void wtap_set_save_fast_seek_index(wtap *wth, gboolean save);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1550,6 +1590,52 @@ WS_DLL_PUBLIC
 gboolean wtap_seek_read (wtap *wth, gint64 seek_off,
         struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
 
+/** A record read as part of a batch by wtap_read_batch(). */
+typedef struct wtap_batch_rec {
+    gint64             data_offset; /**< offset in the file of the record */
+    struct wtap_pkthdr phdr;        /**< record header */
+    Buffer             buf;         /**< record data */
+} wtap_batch_rec;
+
+/** A set of records read with one wtap_read_batch() call. */
+typedef struct wtap_batch {
+    guint           size;   /**< number of entries in recs */
+    guint           count;  /**< number of entries filled in by the last read */
+    wtap_batch_rec *recs;
+} wtap_batch;
+
+/** Allocate a batch that can hold up to size records.  The batch, and
+ * the buffers of its records, can be reused for any number of
+ * wtap_read_batch() calls, and must be freed with wtap_batch_free(). */
+WS_DLL_PUBLIC
+wtap_batch *wtap_batch_new(guint size);
+
+WS_DLL_PUBLIC
+void wtap_batch_free(wtap_batch *batch);
+
+/** Read up to batch->size records, in file order, into the batch.
+ * Returns the number of records read, which is also put into
+ * batch->count.  A return value of 0 with *err set to 0 means we're at
+ * the end of the file.  If a read fails after some records were read,
+ * those records are returned, with *err and *err_info set; the caller
+ * should process them and then stop reading.
+ *
+ * The records' headers and data stay valid until the next
+ * wtap_read_batch() call with the same batch, or until the batch is
+ * freed; a later call overwrites them, so copy anything that's needed
+ * for longer.  Records read with wtap_read_batch() don't go through
+ * the wtap's own record, so what wtap_phdr() and wtap_buf_ptr() return
+ * after a wtap_read_batch() call is undefined; only use them after
+ * wtap_read().  wtap_read() and wtap_read_batch() calls can otherwise
+ * be mixed; records come in file order either way.
+ *
+ * File types with their own batch read routine (currently pcap) read
+ * records straight into the batch; for the others, records are read
+ * one at a time, as with wtap_read(), and moved into the batch. */
+WS_DLL_PUBLIC
+guint wtap_read_batch(wtap *wth, wtap_batch *batch, int *err,
+    gchar **err_info);
+
 /*** get various information snippets about the current packet ***/
 WS_DLL_PUBLIC
 struct wtap_pkthdr *wtap_phdr(wtap *wth);
@@ -1731,6 +1817,13 @@ int wtap_dump_file_encap_type(const GArray *file_encaps);
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_compress(int filetype);
 
+/**
+ * Return TRUE if this build of Wiretap can write files compressed
+ * with this type of compression, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
 /**
  * Return TRUE if this capture file format supports storing name
  * resolution information in it, FALSE if not.
@@ -1747,7 +1840,7 @@ gboolean wtap_dump_supports_comment_types(int filetype, guint32 comment_types);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, int *err);
+    int snaplen, wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Opens a new capture file for writing.
@@ -1760,7 +1853,7 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1769,12 +1862,12 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-    int snaplen, gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+    int snaplen, wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     int *err);
 
 /**
@@ -1790,7 +1883,7 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1799,13 +1892,13 @@ wtap_dumper* wtap_dump_open_tempfile(char **filenamep, const char *pfx,
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_tempfile_ng(char **filenamep, const char *pfx,
-    int file_type_subtype, int encap, int snaplen, gboolean compressed,
+    int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
     GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for an existing file descriptor.
@@ -1818,7 +1911,7 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1827,12 +1920,12 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 /**
  * @brief Creates a dumper for the standard output.
@@ -1844,7 +1937,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  * @param file_type_subtype The WTAP_FILE_TYPE_SUBTYPE_XXX file type.
  * @param encap The WTAP_ENCAP_XXX encapsulation type (WTAP_ENCAP_PER_PACKET for multi)
  * @param snaplen The maximum packet capture length.
- * @param compressed True if file should be compressed.
+ * @param compression_type Type of compression to use, if any.
  * @param shb_hdrs The section header block(s) information, or NULL.
  * @param idb_inf The interface description information, or NULL.
  * @param nrb_hdrs The name resolution blocks(s) comment/custom_opts information, or NULL.
@@ -1853,7 +1946,7 @@ wtap_dumper* wtap_dump_open_stdout(int file_type_subtype, int encap, int snaplen
  */
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_stdout_ng(int file_type_subtype, int encap, int snaplen,
-                gboolean compressed, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
+                wtap_compression_type compression_type, GArray* shb_hdrs, wtapng_iface_descriptions_t *idb_inf,
                 GArray* nrb_hdrs, int *err);
 
 WS_DLL_PUBLIC
@@ -2120,6 +2120,67 @@ done:
     return FALSE;
 }
 
+typedef struct {
+    gchar  *path;
+    gint64  size;
+    gint64  mtime;
+} cache_file_t;
+
+static gint
+cache_file_compare(gconstpointer a, gconstpointer b)
+{
+    const cache_file_t *fa = *(const cache_file_t * const *)a;
+    const cache_file_t *fb = *(const cache_file_t * const *)b;
+
+    if (fa->mtime != fb->mtime)
+        return fa->mtime < fb->mtime ? -1 : 1;
+    return 0;
+}
+
+void
+trim_cache_dir(const char *dirname, const char *suffix, gint64 max_total)
+{
+    GDir         *dir;
+    const gchar  *name;
+    GPtrArray    *files;
+    cache_file_t *file;
+    ws_statb64    st;
+    gint64        total = 0;
+    guint         i;
+
+    dir = g_dir_open(dirname, 0, NULL);
+    if (dir == NULL)
+        return;
+    files = g_ptr_array_new();
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        if (!g_str_has_suffix(name, suffix))
+            continue;
+        file = g_new(cache_file_t, 1);
+        file->path = g_build_filename(dirname, name, NULL);
+        if (ws_stat64(file->path, &st) == -1) {
+            g_free(file->path);
+            g_free(file);
+            continue;
+        }
+        file->size = (gint64)st.st_size;
+        file->mtime = (gint64)st.st_mtime;
+        total += file->size;
+        g_ptr_array_add(files, file);
+    }
+    g_dir_close(dir);
+
+    /* Oldest first */
+    g_ptr_array_sort(files, cache_file_compare);
+    for (i = 0; i < files->len; i++) {
+        file = (cache_file_t *)files->pdata[i];
+        if (total > max_total && ws_unlink(file->path) == 0)
+            total -= file->size;
+        g_free(file->path);
+        g_free(file);
+    }
+    g_ptr_array_free(files, TRUE);
+}
+
 /*
  * Editor modelines
  *
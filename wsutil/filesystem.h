@@ -292,6 +292,16 @@ WS_DLL_PUBLIC gboolean files_identical(const char *fname1, const char *fname2);
 WS_DLL_PUBLIC gboolean copy_file_binary_mode(const char *from_filename,
     const char *to_filename);
 
+/*
+ * Remove the least recently modified of the files in a cache directory
+ * whose names end with the given suffix, until the ones that are left
+ * add up to no more than max_total bytes.  Callers that want this to
+ * be least recently *used* should update a file's modification time
+ * when they use it.
+ */
+WS_DLL_PUBLIC void trim_cache_dir(const char *dirname, const char *suffix,
+    gint64 max_total);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
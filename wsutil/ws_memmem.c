@@ -0,0 +1,83 @@
+/* ws_memmem.c
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+/* see ws_mempbrk.c */
+#ifdef __APPLE__
+#if defined(__clang__) && (__clang_major__ >= 6)
+#else
+#undef HAVE_SSE4_2
+#endif
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "ws_memmem.h"
+#include "ws_memmem_int.h"
+
+const guint8 *
+ws_memmem_portable(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+    const guint8 *begin = haystack;
+    const guint8 *const last_possible = haystack + haystack_len - needle_len;
+
+    /* Let memchr() find the candidates for the first byte */
+    while (begin <= last_possible) {
+        begin = (const guint8 *)memchr(begin, needle[0], last_possible - begin + 1);
+        if (begin == NULL)
+            return NULL;
+        if (memcmp(begin + 1, needle + 1, needle_len - 1) == 0)
+            return begin;
+        begin++;
+    }
+
+    return NULL;
+}
+
+WS_DLL_PUBLIC const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+    if (needle_len == 0 || needle_len > haystack_len)
+        return NULL;
+
+#ifdef HAVE_SSE4_2
+    if (haystack_len >= 16 && ws_memmem_sse42_supported())
+        return ws_memmem_sse42(haystack, haystack_len, needle, needle_len);
+#endif
+
+    return ws_memmem_portable(haystack, haystack_len, needle, needle_len);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,35 @@
+/* ws_memmem.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMMEM_H__
+#define __WS_MEMMEM_H__
+
+#include "ws_symbol_export.h"
+
+/** Find the first occurrence of needle in haystack, as memmem() does.
+ * Uses SSE4.2 string instructions where the CPU has them.
+ *
+ * @return A pointer to the start of the first match, or NULL if there
+ * is none or if needle_len is 0.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+
+#endif /* __WS_MEMMEM_H__ */
@@ -0,0 +1,32 @@
+/* ws_memmem_int.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMMEM_INT_H__
+#define __WS_MEMMEM_INT_H__
+
+const guint8 *ws_memmem_portable(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+
+#ifdef HAVE_SSE4_2
+gboolean ws_memmem_sse42_supported(void);
+const guint8 *ws_memmem_sse42(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+#endif
+
+#endif /* __WS_MEMMEM_INT_H__ */
@@ -0,0 +1,124 @@
+/* ws_memmem_sse42.c
+ * memmem() with SSE4.2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SSE4_2
+
+#include <glib.h>
+#include "ws_cpuid.h"
+
+#ifdef _WIN32
+  #include <tmmintrin.h>
+#endif
+
+#include <nmmintrin.h>
+#include <string.h>
+#include "ws_memmem.h"
+#include "ws_memmem_int.h"
+
+#define cast_128aligned__m128i(p) ((const __m128i *) (const void *) (p))
+
+/* We use
+        _SIDD_UBYTE_OPS
+        | _SIDD_CMP_EQUAL_ORDERED
+        | _SIDD_LEAST_SIGNIFICANT
+   on pcmpestri, which gives the offset of the first position in the
+   16 haystack bytes at which the (first 16 bytes of the) needle starts,
+   including a needle that is cut off by the end of the 16 bytes, or 16
+   if there is no such position.  Lengths are explicit, so NUL bytes in
+   the haystack or needle are no problem. */
+#define MEMMEM_MODE (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED | _SIDD_LEAST_SIGNIFICANT)
+
+gboolean
+ws_memmem_sse42_supported(void)
+{
+  static int supported = -1;
+
+  if (supported == -1)
+    supported = ws_cpuid_sse42() ? 1 : 0;
+
+  return supported;
+}
+
+const guint8 *
+ws_memmem_sse42(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+  guint8 buf[16];
+  __m128i n, h;
+  int nlen = needle_len < 16 ? (int) needle_len : 16;
+  int hlen, idx;
+  size_t pos = 0;
+
+  memset(buf, 0, sizeof buf);
+  memcpy(buf, needle, nlen);
+  n = _mm_loadu_si128(cast_128aligned__m128i(buf));
+
+  while (pos + needle_len <= haystack_len)
+    {
+      if (haystack_len - pos >= 16)
+        {
+          hlen = 16;
+          h = _mm_loadu_si128(cast_128aligned__m128i(haystack + pos));
+        }
+      else
+        {
+          /* Don't read past the end of the haystack */
+          hlen = (int) (haystack_len - pos);
+          memset(buf, 0, sizeof buf);
+          memcpy(buf, haystack + pos, hlen);
+          h = _mm_loadu_si128(cast_128aligned__m128i(buf));
+        }
+
+      idx = _mm_cmpestri(n, nlen, h, hlen, MEMMEM_MODE);
+      if (idx == 16)
+        {
+          pos += 16;
+          continue;
+        }
+
+      /* A candidate; check the whole needle, which may run past
+         these 16 bytes */
+      pos += idx;
+      if (pos + needle_len > haystack_len)
+        return NULL;
+      if (memcmp(haystack + pos, needle, needle_len) == 0)
+        return haystack + pos;
+      pos++;
+    }
+
+  return NULL;
+}
+
+#endif /* HAVE_SSE4_2 */
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
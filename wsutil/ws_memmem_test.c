@@ -0,0 +1,272 @@
+/* ws_memmem_test.c
+ * Tests for ws_memmem() and the implementations behind it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+/* see ws_mempbrk.c */
+#ifdef __APPLE__
+#if defined(__clang__) && (__clang_major__ >= 6)
+#else
+#undef HAVE_SSE4_2
+#endif
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_symbol_export.h"
+#include "ws_memmem.h"
+#include "ws_memmem_int.h"
+
+#define MAX_HAYSTACK_LEN    80
+#define MAX_NEEDLE_LEN      40
+
+typedef const guint8 *(*memmem_func)(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len);
+
+typedef struct {
+    const char  *name;
+    memmem_func  func;
+} memmem_impl;
+
+/* What every implementation has to agree with */
+static const guint8 *
+memmem_reference(const guint8 *haystack, size_t haystack_len, const guint8 *needle, size_t needle_len)
+{
+    size_t i;
+
+    if (needle_len == 0 || needle_len > haystack_len)
+        return NULL;
+
+    for (i = 0; i + needle_len <= haystack_len; i++) {
+        if (memcmp(haystack + i, needle, needle_len) == 0)
+            return haystack + i;
+    }
+    return NULL;
+}
+
+/* The implementations other than ws_memmem() itself assume that the
+ * needle isn't empty and isn't longer than the haystack. */
+static gboolean
+impl_usable(const memmem_impl *impl, size_t haystack_len, size_t needle_len)
+{
+    if (impl->func == ws_memmem)
+        return TRUE;
+    return needle_len != 0 && needle_len <= haystack_len;
+}
+
+static gboolean
+impl_supported(const memmem_impl *impl)
+{
+#ifdef HAVE_SSE4_2
+    if (impl->func == ws_memmem_sse42 && !ws_memmem_sse42_supported()) {
+        g_test_message("%s: not supported by this CPU", impl->name);
+        return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+/* Search a haystack copied into a buffer of exactly its size, so that
+ * tools like Valgrind notice reads past its end. */
+static void
+check(const memmem_impl *impl, const guint8 *haystack, size_t haystack_len,
+      const guint8 *needle, size_t needle_len)
+{
+    guint8       *copy;
+    const guint8 *expected, *found;
+
+    if (!impl_usable(impl, haystack_len, needle_len))
+        return;
+
+    copy = (guint8 *)g_memdup(haystack, (guint)haystack_len);
+    expected = memmem_reference(copy, haystack_len, needle, needle_len);
+    found = impl->func(copy, haystack_len, needle, needle_len);
+    if (found != expected) {
+        g_error("%s: haystack %u bytes, needle %u bytes: found at %d, expected at %d",
+                impl->name, (guint)haystack_len, (guint)needle_len,
+                found ? (int)(found - copy) : -1,
+                expected ? (int)(expected - copy) : -1);
+    }
+    g_free(copy);
+}
+
+/*
+ * Put the needle at every position of haystacks of every length, with
+ * the needle's first bytes and first byte repeated before it, so that
+ * there are candidates that fail after 1 byte and after the needle's
+ * last but one byte.  Needles from 1 to MAX_NEEDLE_LEN bytes cover the
+ * ones that fit in 16 bytes, and the ones that don't, at every offset
+ * from a 16 byte boundary.
+ */
+static void
+test_positions(gconstpointer data)
+{
+    const memmem_impl *impl = (const memmem_impl *)data;
+    guint8  haystack[MAX_HAYSTACK_LEN];
+    guint8  needle[MAX_NEEDLE_LEN];
+    size_t  haystack_len, needle_len, pos, i;
+
+    if (!impl_supported(impl))
+        return;
+
+    for (i = 0; i < MAX_NEEDLE_LEN; i++)
+        needle[i] = (guint8)('A' + i);
+
+    for (needle_len = 1; needle_len <= MAX_NEEDLE_LEN; needle_len++) {
+        for (haystack_len = 0; haystack_len <= MAX_HAYSTACK_LEN; haystack_len++) {
+            /* No match at all */
+            memset(haystack, 'a', sizeof haystack);
+            check(impl, haystack, haystack_len, needle, needle_len);
+
+            for (pos = 0; pos + needle_len <= haystack_len; pos++) {
+                memset(haystack, 'a', sizeof haystack);
+                /* A near miss, and a lone first byte, before the match */
+                if (pos >= needle_len + 1) {
+                    memcpy(haystack, needle, needle_len - 1);
+                    haystack[pos - 1] = needle[0];
+                }
+                memcpy(haystack + pos, needle, needle_len);
+                check(impl, haystack, haystack_len, needle, needle_len);
+
+                /* The needle cut off by the end of the haystack */
+                if (needle_len > 1 && pos + needle_len == haystack_len) {
+                    haystack[haystack_len - 1] = 'a';
+                    check(impl, haystack, haystack_len, needle, needle_len);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Needles longer than 16 bytes whose first 16 bytes match in several
+ * places before the whole needle does, so that the part of the needle
+ * past the first 16 bytes is what decides.
+ */
+static void
+test_long_needles(gconstpointer data)
+{
+    const memmem_impl *impl = (const memmem_impl *)data;
+    static const size_t needle_lens[] = { 16, 17, 31, 32, 33, 100 };
+    guint8  haystack[1024];
+    guint8  needle[100];
+    size_t  needle_len, haystack_len, pos, i, j;
+
+    if (!impl_supported(impl))
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS(needle_lens); i++) {
+        needle_len = needle_lens[i];
+        for (j = 0; j < needle_len; j++)
+            needle[j] = (guint8)(j % 16 == 15 ? 'z' : 'A' + j % 16);
+
+        memset(haystack, 'a', sizeof haystack);
+        /* Copies of the needle, each with a different last byte */
+        pos = 3;
+        for (j = 0; j < 4; j++) {
+            memcpy(haystack + pos, needle, needle_len);
+            haystack[pos + needle_len - 1] = '0';
+            pos += needle_len + j;
+        }
+        check(impl, haystack, pos, needle, needle_len);
+        memcpy(haystack + pos, needle, needle_len);
+        haystack_len = pos + needle_len;
+        check(impl, haystack, haystack_len, needle, needle_len);
+        check(impl, haystack, haystack_len + 5, needle, needle_len);
+    }
+}
+
+/* Bytes that are NUL or have the top bit set are no different */
+static void
+test_binary(gconstpointer data)
+{
+    const memmem_impl *impl = (const memmem_impl *)data;
+    static const guint8 needle[] = { 0x00, 0xff, 0x80, 0x00, 0x7f };
+    guint8  haystack[64];
+    size_t  pos;
+
+    if (!impl_supported(impl))
+        return;
+
+    for (pos = 0; pos + sizeof needle <= sizeof haystack; pos++) {
+        memset(haystack, 0, sizeof haystack);
+        memcpy(haystack + pos, needle, sizeof needle);
+        check(impl, haystack, sizeof haystack, needle, sizeof needle);
+        check(impl, haystack, sizeof haystack, needle, 1);
+        check(impl, haystack, sizeof haystack, needle + 1, sizeof needle - 1);
+    }
+}
+
+static void
+test_empty(void)
+{
+    static const guint8 haystack[] = "0123456789abcdefghij";
+
+    g_assert(ws_memmem(haystack, 20, haystack, 0) == NULL);
+    g_assert(ws_memmem(haystack, 0, haystack, 1) == NULL);
+    g_assert(ws_memmem(haystack, 19, haystack, 20) == NULL);
+    g_assert(ws_memmem(haystack, 20, haystack, 20) == haystack);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const memmem_impl impls[] = {
+        { "ws_memmem", ws_memmem },
+        { "portable", ws_memmem_portable },
+#ifdef HAVE_SSE4_2
+        { "sse42", ws_memmem_sse42 },
+#endif
+    };
+    size_t i;
+    gchar *path;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(impls); i++) {
+        path = g_strdup_printf("/ws_memmem/%s/positions", impls[i].name);
+        g_test_add_data_func(path, &impls[i], test_positions);
+        g_free(path);
+        path = g_strdup_printf("/ws_memmem/%s/long_needles", impls[i].name);
+        g_test_add_data_func(path, &impls[i], test_long_needles);
+        g_free(path);
+        path = g_strdup_printf("/ws_memmem/%s/binary", impls[i].name);
+        g_test_add_data_func(path, &impls[i], test_binary);
+        g_free(path);
+    }
+    g_test_add_func("/ws_memmem/empty", test_empty);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */